@@ -0,0 +1,327 @@
+#include "batch_engine.h"
+#include "platform.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BATCH_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+#endif
+
+static size_t round_up(size_t size) {
+    return (size + PLATFORM_CACHE_LINE - 1) & ~(size_t)(PLATFORM_CACHE_LINE - 1);
+}
+
+bool batch_init(GameBatch* batch, uint32_t count) {
+    memset(batch, 0, sizeof(*batch));
+    batch->count = count;
+    batch->capacity = (count + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+    if (batch->capacity == 0) {
+        batch->capacity = BATCH_LANES;
+    }
+
+    // Every array starts on a cache line, so the vector loads are aligned
+    size_t lanes = batch->capacity;
+    size_t states = round_up(lanes * sizeof(GameState));
+    size_t bytes = round_up(lanes);
+    size_t legal = round_up((size_t)BATCH_PAIRS * (lanes / BATCH_LANES) * sizeof(uint32_t));
+    batch->block_size = states + bytes * (3 * YUKON_COLUMNS + YUKON_FOUNDATIONS + 1) + legal;
+    batch->block = platform_alloc_large(batch->block_size, false, &batch->huge_pages);
+    if (batch->block == NULL) {
+        return false;
+    }
+
+    uint8_t* next = (uint8_t*)batch->block;
+    batch->states = (GameState*)next;
+    next += states;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        batch->top_rank[column] = next;
+        batch->top_suit[column] = next + bytes;
+        batch->length[column] = next + 2 * bytes;
+        next += 3 * bytes;
+        // Padding games are empty boards: no moves
+        memset(batch->top_rank[column], BATCH_EMPTY, lanes);
+        memset(batch->top_suit[column], BATCH_EMPTY, lanes);
+    }
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        batch->foundation[suit] = next;
+        next += bytes;
+    }
+    batch->legal_count = next;
+    next += bytes;
+    batch->legal = (uint32_t*)next;
+    return true;
+}
+
+void batch_free(GameBatch* batch) {
+    platform_free_large(batch->block, batch->block_size, batch->huge_pages);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void batch_refresh(GameBatch* batch, uint32_t game) {
+    const GameState* state = &batch->states[game];
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        uint8_t top = state_top_card(state, column);
+        batch->top_rank[column][game] = top == NO_CARD ? BATCH_EMPTY : (uint8_t)CARD_RANK(top);
+        batch->top_suit[column][game] = top == NO_CARD ? BATCH_EMPTY : (uint8_t)CARD_SUIT(top);
+        batch->length[column][game] = state->column_length[column];
+    }
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        batch->foundation[suit][game] = state->foundation[suit];
+    }
+}
+
+void batch_load(GameBatch* batch, uint32_t game, const GameState* state) {
+    batch->states[game] = *state;
+    batch_refresh(batch, game);
+}
+
+bool batch_kernel_supported(BatchKernel kernel) {
+#ifdef BATCH_X86
+    if (kernel == BatchAvx2) {
+        return platform_cpu_has_avx2();
+    }
+    return true;
+#else
+    return kernel == BatchScalar;
+#endif
+}
+
+BatchKernel batch_best_kernel(void) {
+    if (batch_kernel_supported(BatchAvx2)) {
+        return BatchAvx2;
+    }
+    return batch_kernel_supported(BatchSse2) ? BatchSse2 : BatchScalar;
+}
+
+const char* batch_kernel_name(BatchKernel kernel) {
+    switch (kernel) {
+    case BatchSse2: return "sse2";
+    case BatchAvx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+// The reference the vector kernels follow lane by lane
+static void find_moves_scalar(GameBatch* batch) {
+    uint32_t words = batch->capacity / BATCH_LANES;
+    memset(batch->legal, 0, (size_t)BATCH_PAIRS * words * sizeof(uint32_t));
+    for (uint32_t game = 0; game < batch->capacity; game++) {
+        uint32_t bit = 1u << (game % BATCH_LANES);
+        uint32_t word = game / BATCH_LANES;
+        int first_empty = -1;
+        for (int column = 0; column < YUKON_COLUMNS && first_empty < 0; column++) {
+            if (batch->length[column][game] == 0) {
+                first_empty = column;
+            }
+        }
+
+        uint8_t count = 0;
+        for (int from = 0; from < YUKON_COLUMNS; from++) {
+            if (batch->length[from][game] == 0) {
+                continue;
+            }
+            int rank = batch->top_rank[from][game];
+            int suit = batch->top_suit[from][game];
+            for (int to = 0; to < YUKON_COLUMNS; to++) {
+                bool legal;
+                if (to == from) {
+                    legal = false;
+                }
+                else if (batch->length[to][game] == 0) {
+                    legal = to == first_empty && rank == YUKON_RANKS - 1 && batch->length[from][game] > 1;
+                }
+                else {
+                    legal = rank + 1 == batch->top_rank[to][game] && ((suit ^ batch->top_suit[to][game]) & 2) != 0;
+                }
+                if (legal) {
+                    batch->legal[BATCH_PAIR(from, to) * words + word] |= bit;
+                    count++;
+                }
+            }
+            if (rank == batch->foundation[suit][game]) {
+                batch->legal[BATCH_PAIR(from, YUKON_COLUMNS) * words + word] |= bit;
+                count++;
+            }
+        }
+        batch->legal_count[game] = count;
+    }
+}
+
+#ifdef BATCH_X86
+
+// 16 games at a time. Masks are 0xFF per game where the condition holds; subtracting a
+// mask from the count adds one.
+TARGET_SSE2 static void find_moves_sse2(GameBatch* batch) {
+    uint32_t words = batch->capacity / BATCH_LANES;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i colour = _mm_set1_epi8(2); // Suit bit 1 is set for the black suits
+    const __m128i king = _mm_set1_epi8(YUKON_RANKS - 1);
+
+    for (uint32_t word = 0; word < words; word++) {
+        uint32_t planes[BATCH_PAIRS] = { 0 };
+        for (int half = 0; half < 2; half++) {
+            size_t game = (size_t)word * BATCH_LANES + (size_t)half * 16;
+            __m128i rank[YUKON_COLUMNS], suit[YUKON_COLUMNS], length[YUKON_COLUMNS];
+            __m128i filled[YUKON_COLUMNS], first_empty[YUKON_COLUMNS], foundation[YUKON_FOUNDATIONS];
+            __m128i seen_empty = zero;
+            for (int column = 0; column < YUKON_COLUMNS; column++) {
+                rank[column] = _mm_load_si128((const __m128i*)(batch->top_rank[column] + game));
+                suit[column] = _mm_load_si128((const __m128i*)(batch->top_suit[column] + game));
+                length[column] = _mm_load_si128((const __m128i*)(batch->length[column] + game));
+                __m128i empty = _mm_cmpeq_epi8(length[column], zero);
+                filled[column] = _mm_xor_si128(empty, _mm_set1_epi8(-1));
+                first_empty[column] = _mm_andnot_si128(seen_empty, empty);
+                seen_empty = _mm_or_si128(seen_empty, empty);
+            }
+            for (int s = 0; s < YUKON_FOUNDATIONS; s++) {
+                foundation[s] = _mm_load_si128((const __m128i*)(batch->foundation[s] + game));
+            }
+
+            __m128i count = zero;
+            for (int from = 0; from < YUKON_COLUMNS; from++) {
+                __m128i next_rank = _mm_add_epi8(rank[from], one);
+                __m128i movable_king = _mm_and_si128(_mm_cmpeq_epi8(rank[from], king),
+                                                     _mm_cmpgt_epi8(length[from], one));
+                for (int to = 0; to < YUKON_COLUMNS; to++) {
+                    if (to == from) {
+                        continue;
+                    }
+                    __m128i fits = _mm_and_si128(_mm_cmpeq_epi8(next_rank, rank[to]),
+                                                 _mm_cmpeq_epi8(_mm_and_si128(_mm_xor_si128(suit[from], suit[to]), colour), colour));
+                    fits = _mm_and_si128(fits, _mm_and_si128(filled[from], filled[to]));
+                    __m128i legal = _mm_or_si128(fits, _mm_and_si128(first_empty[to], movable_king));
+                    planes[BATCH_PAIR(from, to)] |= (uint32_t)_mm_movemask_epi8(legal) << (half * 16);
+                    count = _mm_sub_epi8(count, legal);
+                }
+
+                // Pick the foundation height of the card's suit
+                __m128i height = zero;
+                for (int s = 0; s < YUKON_FOUNDATIONS; s++) {
+                    height = _mm_or_si128(height, _mm_and_si128(_mm_cmpeq_epi8(suit[from], _mm_set1_epi8((char)s)), foundation[s]));
+                }
+                __m128i legal = _mm_and_si128(_mm_cmpeq_epi8(rank[from], height), filled[from]);
+                planes[BATCH_PAIR(from, YUKON_COLUMNS)] |= (uint32_t)_mm_movemask_epi8(legal) << (half * 16);
+                count = _mm_sub_epi8(count, legal);
+            }
+            _mm_store_si128((__m128i*)(batch->legal_count + game), count);
+        }
+        for (int pair = 0; pair < BATCH_PAIRS; pair++) {
+            batch->legal[pair * words + word] = planes[pair];
+        }
+    }
+}
+
+// Same as the SSE2 kernel with 32 games per register, one bit plane word per step
+TARGET_AVX2 static void find_moves_avx2(GameBatch* batch) {
+    uint32_t words = batch->capacity / BATCH_LANES;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i colour = _mm256_set1_epi8(2);
+    const __m256i king = _mm256_set1_epi8(YUKON_RANKS - 1);
+
+    for (uint32_t word = 0; word < words; word++) {
+        size_t game = (size_t)word * BATCH_LANES;
+        __m256i rank[YUKON_COLUMNS], suit[YUKON_COLUMNS], length[YUKON_COLUMNS];
+        __m256i filled[YUKON_COLUMNS], first_empty[YUKON_COLUMNS], foundation[YUKON_FOUNDATIONS];
+        __m256i seen_empty = zero;
+        for (int column = 0; column < YUKON_COLUMNS; column++) {
+            rank[column] = _mm256_load_si256((const __m256i*)(batch->top_rank[column] + game));
+            suit[column] = _mm256_load_si256((const __m256i*)(batch->top_suit[column] + game));
+            length[column] = _mm256_load_si256((const __m256i*)(batch->length[column] + game));
+            __m256i empty = _mm256_cmpeq_epi8(length[column], zero);
+            filled[column] = _mm256_xor_si256(empty, _mm256_set1_epi8(-1));
+            first_empty[column] = _mm256_andnot_si256(seen_empty, empty);
+            seen_empty = _mm256_or_si256(seen_empty, empty);
+        }
+        for (int s = 0; s < YUKON_FOUNDATIONS; s++) {
+            foundation[s] = _mm256_load_si256((const __m256i*)(batch->foundation[s] + game));
+        }
+
+        __m256i count = zero;
+        for (int from = 0; from < YUKON_COLUMNS; from++) {
+            __m256i next_rank = _mm256_add_epi8(rank[from], one);
+            __m256i movable_king = _mm256_and_si256(_mm256_cmpeq_epi8(rank[from], king),
+                                                    _mm256_cmpgt_epi8(length[from], one));
+            for (int to = 0; to < YUKON_COLUMNS; to++) {
+                if (to == from) {
+                    batch->legal[BATCH_PAIR(from, to) * words + word] = 0;
+                    continue;
+                }
+                __m256i fits = _mm256_and_si256(_mm256_cmpeq_epi8(next_rank, rank[to]),
+                                                _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_xor_si256(suit[from], suit[to]), colour), colour));
+                fits = _mm256_and_si256(fits, _mm256_and_si256(filled[from], filled[to]));
+                __m256i legal = _mm256_or_si256(fits, _mm256_and_si256(first_empty[to], movable_king));
+                batch->legal[BATCH_PAIR(from, to) * words + word] = (uint32_t)_mm256_movemask_epi8(legal);
+                count = _mm256_sub_epi8(count, legal);
+            }
+
+            __m256i height = zero;
+            for (int s = 0; s < YUKON_FOUNDATIONS; s++) {
+                height = _mm256_or_si256(height, _mm256_and_si256(_mm256_cmpeq_epi8(suit[from], _mm256_set1_epi8((char)s)), foundation[s]));
+            }
+            __m256i legal = _mm256_and_si256(_mm256_cmpeq_epi8(rank[from], height), filled[from]);
+            batch->legal[BATCH_PAIR(from, YUKON_COLUMNS) * words + word] = (uint32_t)_mm256_movemask_epi8(legal);
+            count = _mm256_sub_epi8(count, legal);
+        }
+        _mm256_store_si256((__m256i*)(batch->legal_count + game), count);
+    }
+}
+
+#endif
+
+void batch_find_moves(GameBatch* batch, BatchKernel kernel) {
+#ifdef BATCH_X86
+    if (kernel == BatchAvx2 && batch_kernel_supported(BatchAvx2)) {
+        find_moves_avx2(batch);
+        return;
+    }
+    if (kernel != BatchScalar) {
+        find_moves_sse2(batch);
+        return;
+    }
+#else
+    (void)kernel;
+#endif
+    find_moves_scalar(batch);
+}
+
+Move batch_move(const GameBatch* batch, uint32_t game, int from, int to) {
+    if (to == YUKON_COLUMNS) {
+        return MOVE_MAKE(from, PILE_FOUNDATION + batch->top_suit[from][game], 1);
+    }
+    return MOVE_MAKE(from, to, 1);
+}
+
+uint32_t batch_step(GameBatch* batch, BatchKernel kernel, uint64_t* rng) {
+    batch_find_moves(batch, kernel);
+    uint32_t moved = 0;
+    for (uint32_t game = 0; game < batch->count; game++) {
+        int count = batch->legal_count[game];
+        if (count == 0) {
+            continue;
+        }
+        int chosen = -1;
+        for (int from = 0; from < YUKON_COLUMNS && chosen < 0; from++) {
+            if (batch_is_legal(batch, game, from, YUKON_COLUMNS)) {
+                chosen = BATCH_PAIR(from, YUKON_COLUMNS);
+            }
+        }
+        for (int pair = 0, skip = (int)rng_below(rng, (uint32_t)count); pair < BATCH_PAIRS && chosen < 0; pair++) {
+            if (batch_is_legal(batch, game, pair / BATCH_TARGETS, pair % BATCH_TARGETS) && skip-- == 0) {
+                chosen = pair;
+            }
+        }
+        state_apply_move(&batch->states[game], batch_move(batch, game, chosen / BATCH_TARGETS, chosen % BATCH_TARGETS));
+        batch_refresh(batch, game);
+        moved++;
+    }
+    return moved;
+}
@@ -0,0 +1,81 @@
+#ifndef BATCH_ENGINE_H
+#define BATCH_ENGINE_H
+
+// Many independent games advanced in lockstep, for policy evaluation and playouts.
+//
+// The full states stay in an array of GameState, which is what moves are applied to. Next
+// to it the batch keeps the fields the rule checks read as structure of arrays: one byte
+// per game for each column's top card rank and suit, each column's length and each
+// foundation's height. batch_find_moves then runs the front ends' rule checks (rank + 1
+// and opposite colour onto a column, same suit and next rank onto a foundation, kings
+// only into the first empty column) for 16 or 32 games per instruction with SSE2 or AVX2,
+// and falls back to plain loops elsewhere.
+//
+// The checks cover moves of the top card of a column, which is what a playout policy
+// needs; moving a stack from inside a column still goes through state_generate_moves.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+
+#define BATCH_LANES 32                      // Games per bit plane word, and the padding of every array
+#define BATCH_EMPTY 0xFF                    // Rank and suit of an empty column's top
+#define BATCH_TARGETS 8                     // Columns 0-6, then 7 for the foundation of the card's suit
+#define BATCH_PAIRS (YUKON_COLUMNS * BATCH_TARGETS)
+#define BATCH_PAIR(from, to) ((from) * BATCH_TARGETS + (to))
+
+typedef enum {
+    BatchScalar,
+    BatchSse2,
+    BatchAvx2
+} BatchKernel;
+
+typedef struct GameBatch {
+    uint32_t count;
+    uint32_t capacity;                      // count rounded up to BATCH_LANES
+    GameState* states;
+
+    uint8_t* top_rank[YUKON_COLUMNS];
+    uint8_t* top_suit[YUKON_COLUMNS];
+    uint8_t* length[YUKON_COLUMNS];
+    uint8_t* foundation[YUKON_FOUNDATIONS];
+
+    // Results of batch_find_moves. legal holds one bit plane per (from, to) pair: bit
+    // game % 32 of word pair * (capacity / 32) + game / 32.
+    uint32_t* legal;
+    uint8_t* legal_count;
+
+    void* block;                            // One allocation behind all the arrays above
+    size_t block_size;
+    bool huge_pages;
+} GameBatch;
+
+bool batch_init(GameBatch* batch, uint32_t count);
+void batch_free(GameBatch* batch);
+
+// Sets a game and its structure of arrays entries; call batch_refresh after changing
+// batch->states[game] directly
+void batch_load(GameBatch* batch, uint32_t game, const GameState* state);
+void batch_refresh(GameBatch* batch, uint32_t game);
+
+// Fastest kernel this CPU runs
+BatchKernel batch_best_kernel(void);
+bool batch_kernel_supported(BatchKernel kernel);
+const char* batch_kernel_name(BatchKernel kernel);
+
+void batch_find_moves(GameBatch* batch, BatchKernel kernel);
+
+static inline bool batch_is_legal(const GameBatch* batch, uint32_t game, int from, int to) {
+    uint32_t words = batch->capacity / BATCH_LANES;
+    return (batch->legal[BATCH_PAIR(from, to) * words + game / BATCH_LANES] >> (game % BATCH_LANES)) & 1;
+}
+
+// Engine move for a legal pair of a game
+Move batch_move(const GameBatch* batch, uint32_t game, int from, int to);
+
+// One move for every game that has one: a foundation move when there is one, otherwise a
+// random legal top card move. Returns the number of games that moved.
+uint32_t batch_step(GameBatch* batch, BatchKernel kernel, uint64_t* rng);
+
+#endif
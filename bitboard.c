@@ -0,0 +1,174 @@
+#include "bitboard.h"
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define SUIT_ACES (BITBOARD_CARD(0) | BITBOARD_CARD(13) | BITBOARD_CARD(26) | BITBOARD_CARD(39))
+#define KINGS (SUIT_ACES << (YUKON_RANKS - 1))
+#define RED_ACES (BITBOARD_CARD(0) | BITBOARD_CARD(13))
+#define BLACK_ACES (BITBOARD_CARD(26) | BITBOARD_CARD(39))
+
+static int lowest_card(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// The two cards that go on a top card: one rank lower, other colour
+static uint64_t fits_under(int top) {
+    int rank = CARD_RANK(top);
+    if (rank == 0) {
+        return 0;
+    }
+    return (CARD_IS_RED(top) ? BLACK_ACES : RED_ACES) << (rank - 1);
+}
+
+static void refresh_column(BitboardState* board, int column) {
+    const GameState* state = &board->state;
+    int start = state_column_start(state, column);
+    int length = state->column_length[column];
+    uint64_t face_up = 0;
+
+    board->tops &= ~board->face_up[column];
+    for (int i = 0; i < length; i++) {
+        uint8_t card = state->cards[start + i];
+        board->column_of[card] = (uint8_t)column;
+        board->position_of[card] = (uint8_t)i;
+        if (i >= state->hidden_count[column]) {
+            face_up |= BITBOARD_CARD(card);
+        }
+    }
+    board->face_up[column] = face_up;
+    if (length > 0) {
+        board->tops |= BITBOARD_CARD(state->cards[start + length - 1]);
+    }
+}
+
+void bitboard_from_state(BitboardState* board, const GameState* state) {
+    memset(board, 0, sizeof(*board));
+    board->state = *state;
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        board->foundation |= ((1ull << state->foundation[suit]) - 1) << (suit * YUKON_RANKS);
+    }
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        refresh_column(board, column);
+    }
+}
+
+void bitboard_deal(BitboardState* board, uint32_t deal_number) {
+    GameState state;
+    state_deal(&state, deal_number);
+    bitboard_from_state(board, &state);
+}
+
+uint64_t bitboard_foundation_next(const BitboardState* board) {
+    // Shifting a suit's prefix up by one gives its next card; a finished suit's king
+    // shifts onto the next suit's ace, which SUIT_ACES covers anyway
+    return ((board->foundation << 1) | SUIT_ACES) & ~board->foundation & BITBOARD_ALL_CARDS;
+}
+
+bool bitboard_is_move_legal(const BitboardState* board, Move move) {
+    const GameState* state = &board->state;
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+
+    if (from >= YUKON_COLUMNS || to >= YUKON_PILES || from == to || count == 0) {
+        return false;
+    }
+    int length = state->column_length[from];
+    if (count > length - state->hidden_count[from]) {
+        return false;
+    }
+    uint8_t card = state->cards[state_column_start(state, from) + length - count];
+
+    if (PILE_IS_FOUNDATION(to)) {
+        return count == 1 && CARD_SUIT(card) == to - PILE_FOUNDATION &&
+               (bitboard_foundation_next(board) & BITBOARD_CARD(card)) != 0;
+    }
+    uint64_t top = board->tops & board->face_up[to];
+    if (top == 0) {
+        return CARD_RANK(card) == YUKON_RANKS - 1;
+    }
+    return (fits_under(lowest_card(top)) & BITBOARD_CARD(card)) != 0;
+}
+
+int bitboard_generate_moves(const BitboardState* board, Move moves[YUKON_MAX_MOVES]) {
+    const GameState* state = &board->state;
+    int count = 0;
+
+    for (uint64_t ready = board->tops & bitboard_foundation_next(board); ready != 0; ready &= ready - 1) {
+        int card = lowest_card(ready);
+        moves[count++] = MOVE_MAKE(board->column_of[card], PILE_FOUNDATION + CARD_SUIT(card), 1);
+    }
+
+    uint64_t face_up = 0;
+    int empty_column = -1;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        face_up |= board->face_up[column];
+        if (state->column_length[column] == 0 && empty_column < 0) {
+            empty_column = column;
+        }
+    }
+
+    for (int to = 0; to < YUKON_COLUMNS; to++) {
+        uint64_t top = board->tops & board->face_up[to];
+        if (top == 0) {
+            continue;
+        }
+        for (uint64_t movable = fits_under(lowest_card(top)) & face_up & ~board->face_up[to]; movable != 0; movable &= movable - 1) {
+            int card = lowest_card(movable);
+            int from = board->column_of[card];
+            moves[count++] = MOVE_MAKE(from, to, state->column_length[from] - board->position_of[card]);
+        }
+    }
+
+    // A king already at the bottom of its column gains nothing from an empty one
+    if (empty_column >= 0) {
+        for (uint64_t kings = face_up & KINGS; kings != 0; kings &= kings - 1) {
+            int card = lowest_card(kings);
+            int from = board->column_of[card];
+            if (board->position_of[card] > 0) {
+                moves[count++] = MOVE_MAKE(from, empty_column, state->column_length[from] - board->position_of[card]);
+            }
+        }
+    }
+    return count;
+}
+
+Move bitboard_apply_move(BitboardState* board, Move move) {
+    move = state_apply_move(&board->state, move);
+    int to = MOVE_TO(move);
+
+    // The column the cards left first: its old face up mask still holds the moved top card
+    refresh_column(board, MOVE_FROM(move));
+    if (PILE_IS_FOUNDATION(to)) {
+        int suit = to - PILE_FOUNDATION;
+        int card = suit * YUKON_RANKS + board->state.foundation[suit] - 1;
+        board->foundation |= BITBOARD_CARD(card);
+        board->column_of[card] = 0;
+        board->position_of[card] = 0;
+    }
+    else {
+        refresh_column(board, to);
+    }
+    return move;
+}
+
+void bitboard_undo_move(BitboardState* board, Move move) {
+    int to = MOVE_TO(move);
+    if (PILE_IS_FOUNDATION(to)) {
+        int suit = to - PILE_FOUNDATION;
+        board->foundation &= ~BITBOARD_CARD(suit * YUKON_RANKS + board->state.foundation[suit] - 1);
+    }
+    state_undo_move(&board->state, move);
+    if (!PILE_IS_FOUNDATION(to)) {
+        refresh_column(board, to);
+    }
+    refresh_column(board, MOVE_FROM(move));
+}
@@ -0,0 +1,51 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+// Bitboard form of a game state.
+//
+// Next to the card order of a GameState, which applying a move needs, a BitboardState
+// keeps 52 bit masks indexed by card code (suit * 13 + rank, so each suit is a 13 bit
+// group): the cards on the foundations, the face up cards of every column and the
+// column tops. Finding the legal moves is then a few ANDs per column instead of a walk
+// over every face up card: the cards that fit on a top are two bits, the next foundation
+// card of every suit is one shift, and a stack's size comes from the moved card's
+// position.
+//
+// The functions mirror the GameState ones and take and return the same Move values, so a
+// search can use either form. Generated moves are the same set as state_generate_moves,
+// with foundation moves first, in a different order after that.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+
+#define BITBOARD_ALL_CARDS ((1ull << YUKON_CARDS) - 1)
+#define BITBOARD_CARD(card) (1ull << (card))
+
+typedef struct BitboardState {
+    GameState state;                        // Card order, hidden counts and hash
+    uint64_t foundation;                    // Cards on the foundations: a prefix of each suit's 13 bits
+    uint64_t face_up[YUKON_COLUMNS];        // Face up cards of each column
+    uint64_t tops;                          // Top cards of the non-empty columns
+    uint8_t column_of[YUKON_CARDS];         // Column of every tableau card
+    uint8_t position_of[YUKON_CARDS];       // Index from the bottom of its column
+} BitboardState;
+
+void bitboard_from_state(BitboardState* board, const GameState* state);
+void bitboard_deal(BitboardState* board, uint32_t deal_number);
+
+static inline bool bitboard_is_won(const BitboardState* board) {
+    return board->foundation == BITBOARD_ALL_CARDS;
+}
+
+// Next card every foundation takes, one bit per suit (none for a finished suit)
+uint64_t bitboard_foundation_next(const BitboardState* board);
+
+bool bitboard_is_move_legal(const BitboardState* board, Move move);
+int bitboard_generate_moves(const BitboardState* board, Move moves[YUKON_MAX_MOVES]);
+
+// Same contract as state_apply_move / state_undo_move
+Move bitboard_apply_move(BitboardState* board, Move move);
+void bitboard_undo_move(BitboardState* board, Move move);
+
+#endif
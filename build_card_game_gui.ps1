@@ -4,6 +4,9 @@
 $SDL_INCLUDE = "SDL3-devel\SDL3-3.2.10\include"
 $SDL_LIB = "SDL3-devel\SDL3-3.2.10\lib\x64"
 
+# Shared engine sources linked into the GUI
+$ENGINE_SOURCES = @("game_state.c", "move_journal.c", "replay.c", "platform.c", "deal_database.c", "snapshot.c", "solver.c", "packed_state.c", "visited_filter.c", "deadlock.c", "transposition_table.c", "hint_engine.c", "determinize.c", "tablebase.c", "trace.c", "frame_profiler.c")
+
 # Create output directory if it doesn't exist
 if (-not (Test-Path "output")) {
     New-Item -ItemType Directory -Path "output" | Out-Null
@@ -13,13 +16,13 @@ if (-not (Test-Path "output")) {
 $gcc_exists = $null -ne (Get-Command "gcc" -ErrorAction SilentlyContinue)
 if ($gcc_exists) {
     Write-Host "Using GCC compiler..."
-    gcc -o output\card_game_gui.exe card_game_gui.c -I"$SDL_INCLUDE" -L"$SDL_LIB" -lSDL3
+    gcc -std=c11 -o output\card_game_gui.exe card_game_gui.c $ENGINE_SOURCES -I"$SDL_INCLUDE" -L"$SDL_LIB" -lSDL3
 }
 else {
     Write-Host "GCC not found, trying Visual Studio compiler..."
     $cl_exists = $null -ne (Get-Command "cl" -ErrorAction SilentlyContinue)
     if ($cl_exists) {
-        cl /nologo /W3 /EHsc /MD /I"$SDL_INCLUDE" /Feoutput\card_game_gui.exe card_game_gui.c /link /LIBPATH:"$SDL_LIB" SDL3.lib
+        cl /nologo /W3 /EHsc /MD /std:c11 /experimental:c11atomics /I"$SDL_INCLUDE" /Feoutput\card_game_gui.exe card_game_gui.c $ENGINE_SOURCES /link /LIBPATH:"$SDL_LIB" SDL3.lib
     }
     else {
         Write-Host "No compiler found. Please install GCC (MinGW) or Visual Studio."
@@ -0,0 +1,35 @@
+# PowerShell script to build the Yukon terminal game
+
+# Shared engine sources linked into the terminal game
+$ENGINE_SOURCES = @("game_state.c", "move_journal.c", "replay.c", "platform.c", "deal_database.c", "snapshot.c", "solver.c", "packed_state.c", "visited_filter.c", "deadlock.c", "transposition_table.c", "determinize.c", "tablebase.c", "trace.c")
+
+# Create output directory if it doesn't exist
+if (-not (Test-Path "output")) {
+    New-Item -ItemType Directory -Path "output" | Out-Null
+}
+
+# Try to compile with gcc (MinGW)
+$gcc_exists = $null -ne (Get-Command "gcc" -ErrorAction SilentlyContinue)
+if ($gcc_exists) {
+    Write-Host "Using GCC compiler..."
+    gcc -std=c11 -o output\yukon_terminal.exe yukon_terminal.c $ENGINE_SOURCES
+}
+else {
+    Write-Host "GCC not found, trying Visual Studio compiler..."
+    $cl_exists = $null -ne (Get-Command "cl" -ErrorAction SilentlyContinue)
+    if ($cl_exists) {
+        cl /nologo /W3 /EHsc /MD /std:c11 /experimental:c11atomics /Feoutput\yukon_terminal.exe yukon_terminal.c $ENGINE_SOURCES
+    }
+    else {
+        Write-Host "No compiler found. Please install GCC (MinGW) or Visual Studio."
+        exit 1
+    }
+}
+
+Write-Host ""
+if ($LASTEXITCODE -eq 0) {
+    Write-Host "Build successful! Run 'output\yukon_terminal.exe' to start the game."
+}
+else {
+    Write-Host "Build failed with error code $LASTEXITCODE."
+}
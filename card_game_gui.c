@@ -5,6 +5,15 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include "game_state.h"
+#include "move_journal.h"
+#include "replay.h"
+#include "deal_database.h"
+#include "snapshot.h"
+#include "hint_engine.h"
+#include "solver.h"
+#include "frame_profiler.h"
+#include "trace.h"
 
 
 // Window dimensions
@@ -21,6 +30,7 @@
 typedef struct Card {
     int value; // 1-13 (Ace, 2, 3..., Jack, Queen, King)
     int suit; // (1-4, Hearts, Diamonds, Clubs, Spades)
+    bool is_hidden; // Face down, the last card of a column is turned up when it is uncovered
     struct Card* next;
 } Card;
 
@@ -39,6 +49,7 @@ typedef enum {
 } GetCardType;
 
 // Game state variables
+uint32_t deal_number = 0;
 Card* deck = NULL;
 Card* seven_rows[7] = { NULL };
 Card* four_pockets[4] = { NULL };
@@ -54,23 +65,86 @@ bool is_dragging = false;
 char command_buffer[20] = "";
 int command_buffer_index = 0;
 
+// Undo/redo history, the U and R commands walk through it
+Move journal_storage[JOURNAL_DEFAULT_CAPACITY];
+MoveJournal journal;
+
+// Optional replay recording (--record FILE)
+ReplayWriter recorder;
+bool recording = false;
+
+// Hints are searched on a background thread, H turns the highlight on and off. They are
+// fair: while cards are face down the engine only looks at the face up ones.
+#define HINT_NODE_LIMIT 300000
+#define HINT_TT_MB 16
+HintEngine* hints = NULL;
+uint32_t hint_generation = 0;
+bool show_hints = true;
+
+// A solves from the current position with a beam search of fixed width, which answers in
+// about 100 ms whatever the position, and plays the line it found one move at a time. The
+// search runs on the hint worker, so the window never waits for it. Like every solver it
+// sees the face down cards. Any input stops the search or the playback.
+#define SOLVE_BEAM_WIDTH 512
+#define SOLVE_NODE_LIMIT 400000
+#define SOLVE_TT_MB 4
+#define SOLVE_STEP_MS 300
+bool line_solver_ready = false;
+uint32_t solve_generation = 0; // Line request the hint worker is solving, 0 for none
+SolveResult solve_result;
+uint32_t solve_next = 0;     // The line is playing while this is below solve_result.length
+uint64_t solve_step_at = 0;  // SDL_GetTicks time of the next move
+
+// Optional endgame tablebase for the hint searches (--tablebase FILE)
+Tablebase tablebase;
+bool tablebase_loaded = false;
+
+// Save game used by the S and L commands, --save FILE also saves after every move
+const char* save_path = "yukon.sav";
+bool autosave = false;
+
+// Frame time profiler: P shows the overlay, the frames are written to profile_path on exit
+FrameProfiler profiler;
+bool profiler_ready = false;
+bool show_profiler = false;
+const char* profile_path = "yukon_frames.csv";
+
+// --trace FILE records a timeline of the game, T writes it to FILE (and so does exiting)
+const char* trace_path = NULL;
+
 // Function prototypes
 void cleanup_and_exit(SDL_Window* window, SDL_Renderer* renderer, int exit_code);
 void draw_card(SDL_Renderer* renderer, float x, float y, int value, int suit);
+void draw_card_back(SDL_Renderer* renderer, float x, float y);
 void draw_game_board(SDL_Renderer* renderer);
 void process_mouse_down(int x, int y);
 void process_mouse_up(int x, int y);
 void process_mouse_motion(int x, int y);
 void process_key(SDL_Keycode key);
 void process_command(const char* command);
+bool play_move_command(const char* command);
 void initialize_game();
 void cleanup_game();
 void load_textures(SDL_Renderer* renderer);
 void free_textures();
+void undo_move();
+void redo_move();
+void record_move(Move move);
+bool save_game();
+bool load_game();
+void request_hint();
+void draw_hint(SDL_Renderer* renderer);
+void solve_from_here();
+void play_solution_step();
+void stop_solution();
+int pocket_for_suit(int suit);
+void draw_profiler(SDL_Renderer* renderer);
+void write_trace();
 
 // Card game logic functions from udemy.c
 LocationTranslator* translate_command(const char* command);
 Card* create_deck();
+Card* create_deck_for_deal(uint32_t deal_number);
 void shuffle_card(Card** deck);
 void deal_cards(Card** deck, Card** seven_rows);
 Card* get_card_by_index(Card* deck, int deckIndex);
@@ -82,10 +156,74 @@ void free_card_list(Card* list);
 void cleanup_location_translator(LocationTranslator* lt);
 bool is_seven_rows_empty(Card* seven_rows[7]);
 char convert_to_char(int value);
+int count_cards(Card* list);
+Card* get_last_card(Card* list);
+void append_cards(Card** pile, Card* cards);
+Card* detach_last_cards(Card** pile, int count);
+Card** get_pile(int pile);
+void move_pile_cards(int from, int to, int count);
+bool reveal_top_card(int column);
+Move to_engine_move(Move move);
+void board_to_state(GameState* state, uint8_t pocket_suit[4]);
+void state_to_board(const GameState* state, const uint8_t pocket_suit[4]);
 
 int main(int argc, char* argv[]) {
     // Initialize random seed
     srand(time(NULL));
+    deal_number = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    const char* record_path = NULL;
+    const char* db_path = NULL;
+    DealDifficulty difficulty = DealAnyWinnable;
+    bool deal_chosen = false;
+    bool resume = false;
+
+    // --deal N plays a given deal, --record FILE appends the game to a replay file
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--deal") == 0 && i + 1 < argc) {
+            deal_number = (uint32_t)strtoul(argv[++i], NULL, 10);
+            deal_chosen = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+            tablebase_loaded = tablebase_open(&tablebase, argv[++i]);
+            if (!tablebase_loaded) {
+                printf("Could not open tablebase %s\n", argv[i]);
+            }
+        }
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+            autosave = true;
+        }
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+            resume = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+            trace_enable(true);
+            trace_thread_name("main");
+        }
+        else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            if (!deal_difficulty_from_string(argv[++i], &difficulty)) {
+                printf("Unknown difficulty %s, use any, easy, medium or hard\n", argv[i]);
+            }
+        }
+    }
+
+    // --db FILE deals only winnable games from a deal database, graded by --difficulty
+    if (db_path != NULL && !deal_chosen) {
+        if (!deal_db_choose(db_path, difficulty, ((uint64_t)time(NULL) << 20) ^ deal_number, &deal_number)) {
+            printf("Could not pick a deal from %s, playing a random deal\n", db_path);
+        }
+    }
     
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -114,9 +252,29 @@ int main(int argc, char* argv[]) {
 
     // Initialize game
     initialize_game();
+    if (resume && !load_game()) {
+        printf("Could not load %s, starting a new game\n", save_path);
+        resume = false;
+    }
+
+    if (record_path != NULL && resume) {
+        printf("A loaded game can not be recorded, it does not start from the deal\n");
+    }
+    else if (record_path != NULL) {
+        recording = replay_writer_open(&recorder, record_path, true);
+        if (recording) {
+            replay_writer_begin_game(&recorder, deal_number);
+        }
+        else {
+            printf("Could not open %s for recording\n", record_path);
+        }
+    }
     
-    // Load textures
+    // Load textures, the first frame's record includes the time this takes
+    profiler_ready = frame_profiler_init(&profiler);
+    frame_profiler_begin(&profiler, ProfileAssets);
     load_textures(renderer);
+    frame_profiler_end(&profiler, ProfileAssets);
 
     // Main loop flag
     bool quit = false;
@@ -127,6 +285,7 @@ int main(int argc, char* argv[]) {
     // Main loop
     while (!quit) {
         // Handle events on queue
+        frame_profiler_begin(&profiler, ProfileEvents);
         while (SDL_PollEvent(&e) != 0) {
             // User requests quit
             if (e.type == SDL_EVENT_QUIT) {
@@ -157,17 +316,32 @@ int main(int argc, char* argv[]) {
                 process_mouse_motion(e.motion.x, e.motion.y);
             }
         }
+        play_solution_step();
+        frame_profiler_end(&profiler, ProfileEvents);
 
         // Clear screen
+        frame_profiler_begin(&profiler, ProfileDraw);
         SDL_SetRenderDrawColor(renderer, 0, 128, 0, 255); // Dark green background
         SDL_RenderClear(renderer);
 
         // Draw game board
         draw_game_board(renderer);
+        frame_profiler_end(&profiler, ProfileDraw);
 
-        // Update screen
+        // Update screen, with vsync this also waits for the next refresh
+        frame_profiler_begin(&profiler, ProfilePresent);
         SDL_RenderPresent(renderer);
+        frame_profiler_end(&profiler, ProfilePresent);
+        frame_profiler_end_frame(&profiler);
+    }
+
+    if (profiler_ready) {
+        if (!frame_profiler_write_csv(&profiler, profile_path)) {
+            printf("Could not write the frame times to %s\n", profile_path);
+        }
+        frame_profiler_free(&profiler);
     }
+    write_trace();
 
     // Clean up and exit
     cleanup_game();
@@ -400,6 +574,23 @@ void draw_card(SDL_Renderer* renderer, float x, float y, int value, int suit) {
     SDL_RenderDebugText(renderer, x + CARD_WIDTH - 25, y + CARD_HEIGHT - 15, card_text);
 }
 
+void draw_card_back(SDL_Renderer* renderer, float x, float y) {
+    SDL_FRect card_rect = {x, y, CARD_WIDTH, CARD_HEIGHT};
+    if (card_back_texture) {
+        SDL_RenderTexture(renderer, card_back_texture, NULL, &card_rect);
+        return;
+    }
+
+    // Fallback: blue back with a white frame
+    SDL_SetRenderDrawColor(renderer, 30, 60, 150, 255);
+    SDL_RenderFillRect(renderer, &card_rect);
+    SDL_FRect inner_rect = {x + 5, y + 5, CARD_WIDTH - 10, CARD_HEIGHT - 10};
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderRect(renderer, &inner_rect);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderRect(renderer, &card_rect);
+}
+
 void draw_game_board(SDL_Renderer* renderer) {
     // Draw background if available
     if (background_texture) {
@@ -440,9 +631,9 @@ void draw_game_board(SDL_Renderer* renderer) {
         SDL_SetRenderDrawColor(renderer, 218, 165, 32, 255); // Gold color
         SDL_RenderRect(renderer, &foundation_rect);
         
-        // Draw cards in foundation piles
+        // Draw the top card of the foundation pile
         if (four_pockets[i] != NULL) {
-            Card* current = four_pockets[i];
+            Card* current = get_last_card(four_pockets[i]);
             draw_card(renderer, foundation_x, foundation_y, 
                      current->value, current->suit);
         }
@@ -466,8 +657,12 @@ void draw_game_board(SDL_Renderer* renderer) {
             
             // Draw cards with cascading effect
             float overlap = CARD_OVERLAP;
-            draw_card(renderer, x, y + card_index * overlap, 
-                     current->value, current->suit);
+            if (current->is_hidden) {
+                draw_card_back(renderer, x, y + card_index * overlap);
+            } else {
+                draw_card(renderer, x, y + card_index * overlap, 
+                         current->value, current->suit);
+            }
             
             current = current->next;
             card_index++;
@@ -480,6 +675,14 @@ void draw_game_board(SDL_Renderer* renderer) {
                  selected_card->value, selected_card->suit);
     }
     
+    if (show_hints) {
+        draw_hint(renderer);
+    }
+
+    if (show_profiler) {
+        draw_profiler(renderer);
+    }
+
     // Draw command input
     SDL_FRect cmd_rect = {10, WINDOW_HEIGHT - 40, WINDOW_WIDTH - 20, 30};
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
@@ -493,6 +696,7 @@ void draw_game_board(SDL_Renderer* renderer) {
 }
 
 void process_mouse_down(int x, int y) {
+    stop_solution();
     int start_x = 50;
     int start_y = 50;
     
@@ -595,55 +799,221 @@ void process_key(SDL_Keycode key) {
                (key >= SDLK_0 && key <= SDLK_9) ||
                key == SDLK_SPACE || key == SDLK_GREATER || 
                key == SDLK_LESS || key == SDLK_MINUS || key == SDLK_COLON) {
-        // Add the character to the buffer
+        // Add the character to the buffer, commands are upper case (C1->F1)
         if (command_buffer_index < sizeof(command_buffer) - 1) {
-            command_buffer[command_buffer_index++] = (char)key;
+            command_buffer[command_buffer_index++] = (char)toupper((int)key);
             command_buffer[command_buffer_index] = '\0';
         }
     }
 }
 
 void process_command(const char* command) {
+    stop_solution();
+    if (strcmp(command, "A") == 0) {
+        solve_from_here();
+        return;
+    }
+    if (strcmp(command, "U") == 0) {
+        undo_move();
+        return;
+    }
+    if (strcmp(command, "R") == 0) {
+        redo_move();
+        return;
+    }
+    if (strcmp(command, "H") == 0) {
+        show_hints = !show_hints;
+        return;
+    }
+    if (strcmp(command, "T") == 0) {
+        write_trace();
+        return;
+    }
+    if (strcmp(command, "P") == 0) {
+        show_profiler = !show_profiler;
+        return;
+    }
+    if (strcmp(command, "S") == 0) {
+        if (!save_game()) {
+            printf("Could not save to %s\n", save_path);
+        }
+        return;
+    }
+    if (strcmp(command, "L") == 0) {
+        if (!load_game()) {
+            printf("Could not load %s\n", save_path);
+        }
+        return;
+    }
+
+    play_move_command(command);
+}
+
+// Makes a move command such as C1:KH->C3 or C2->F1 if the rules allow it, returns whether it did
+bool play_move_command(const char* command) {
+    uint64_t trace_start = trace_begin();
     LocationTranslator* lt = translate_command(command);
+    trace_end("parse", "input", trace_start);
+    bool moved = false;
     
     if (lt->from_tab == 'C' && lt->to_tab == 'C') {
         // Move from column to column
         Card* card_to_move = get_card(lt, seven_rows, CardToMove, false);
         Card* card_new_location = get_card(lt, seven_rows, CardNewLocation, false);
         
-        if (card_new_location != NULL) {
+        if (card_to_move != NULL && !card_to_move->is_hidden && card_new_location != NULL) {
             bool rules_passed = is_move_allowed_to_seven_rows(card_to_move, card_new_location);
             if (rules_passed) {
                 card_to_move = get_card(lt, seven_rows, CardToMove, true); // set prev to null if rule passed
                 card_new_location->next = card_to_move;
+                record_move(MOVE_MAKE(lt->from_index - 1, lt->to_index - 1, count_cards(card_to_move)));
+                moved = true;
             }
         }
-    } else if (lt->from_tab == 'C' && lt->to_tab == 'F') {
-        // Move from column to foundation
+        else if (card_to_move != NULL && !card_to_move->is_hidden && lt->to_index >= 1 && lt->to_index <= 7 &&
+                 lt->to_index != lt->from_index && seven_rows[lt->to_index - 1] == NULL) {
+            // The column is empty: only a King goes there, with the cards on it
+            if (card_to_move->value == 13) {
+                card_to_move = get_card(lt, seven_rows, CardToMove, true);
+                seven_rows[lt->to_index - 1] = card_to_move;
+                record_move(MOVE_MAKE(lt->from_index - 1, lt->to_index - 1, count_cards(card_to_move)));
+                moved = true;
+            }
+        }
+    } else if (lt->from_tab == 'C' && lt->to_tab == 'F' && lt->to_index >= 1 && lt->to_index <= 4) {
+        // Move from column to foundation, only the last card of a column can go
         Card* card_to_move = get_card(lt, seven_rows, CardToMove, false);
         
-        if (card_to_move != NULL) {
-            bool rules_passed = is_move_allowed_to_four_pockets(card_to_move, four_pockets[lt->to_index - 1]);
+        if (card_to_move != NULL && card_to_move->next == NULL) {
+            bool rules_passed = is_move_allowed_to_four_pockets(card_to_move, get_last_card(four_pockets[lt->to_index - 1]));
             if (rules_passed) {
                 card_to_move = get_card(lt, seven_rows, CardToMove, true); // set prev to null if rule passed
-                four_pockets[lt->to_index - 1] = card_to_move;
+                append_cards(&four_pockets[lt->to_index - 1], card_to_move);
+                record_move(MOVE_MAKE(lt->from_index - 1, PILE_FOUNDATION + lt->to_index - 1, 1));
+                moved = true;
             }
         }
     }
     
     cleanup_location_translator(lt);
+    return moved;
+}
+
+void undo_move() {
+    Move move = journal_undo(&journal);
+    if (move != MOVE_NONE) {
+        if (move & MOVE_REVEAL) {
+            get_last_card(seven_rows[MOVE_FROM(move)])->is_hidden = true;
+        }
+        move_pile_cards(MOVE_TO(move), MOVE_FROM(move), MOVE_COUNT(move));
+        if (recording) {
+            replay_writer_add_undo(&recorder);
+        }
+        if (autosave) {
+            save_game();
+        }
+        request_hint();
+    }
+}
+
+void redo_move() {
+    Move move = journal_redo(&journal);
+    if (move != MOVE_NONE) {
+        move_pile_cards(MOVE_FROM(move), MOVE_TO(move), MOVE_COUNT(move));
+        reveal_top_card(MOVE_FROM(move));
+        if (recording) {
+            replay_writer_add_move(&recorder, to_engine_move(move));
+        }
+        if (autosave) {
+            save_game();
+        }
+        request_hint();
+    }
+}
+
+// Called after a move was made on the board, turns up the card it uncovered
+void record_move(Move move) {
+    uint64_t trace_start = trace_begin();
+    if (reveal_top_card(MOVE_FROM(move))) {
+        move |= MOVE_REVEAL;
+    }
+    journal_record(&journal, move);
+    if (recording) {
+        replay_writer_add_move(&recorder, to_engine_move(move));
+    }
+    if (autosave) {
+        save_game();
+    }
+    request_hint();
+    trace_end_value("move", "game", trace_start, move);
+}
+
+bool save_game() {
+    GameState state;
+    uint8_t pocket_suit[4];
+    Snapshot snapshot;
+    board_to_state(&state, pocket_suit);
+    snapshot_capture(&snapshot, &state, deal_number, journal_depth(&journal), pocket_suit);
+    return snapshot_save(&snapshot, save_path);
+}
+
+bool load_game() {
+    GameState state;
+    Snapshot snapshot;
+    if (!snapshot_load(&snapshot, save_path) || !snapshot_restore(&snapshot, &state)) {
+        return false;
+    }
+    state_to_board(&state, snapshot.pocket_suit);
+    deal_number = snapshot.deal_number;
+    journal_clear(&journal);
+    request_hint();
+    if (recording) {
+        // The loaded position does not follow from the recorded moves
+        replay_writer_close(&recorder);
+        recording = false;
+    }
+    return true;
 }
 
 void initialize_game() {
-    // Create and shuffle the deck
-    deck = create_deck();
-    shuffle_card(&deck);
+    // Create the deck shuffled for this deal number
+    uint64_t trace_start = trace_begin();
+    deck = create_deck_for_deal(deal_number);
     
     // Deal cards to the seven rows
     deal_cards(&deck, seven_rows);
+    trace_end_value("deal", "game", trace_start, deal_number);
+
+    journal_init(&journal, journal_storage, JOURNAL_DEFAULT_CAPACITY);
+
+    hints = hint_engine_create(HINT_NODE_LIMIT, HINT_TT_MB, true, tablebase_loaded ? &tablebase : NULL);
+    request_hint();
+
+    SolverConfig config;
+    solver_default_config(&config);
+    config.algorithm = SolverBeam;
+    config.beam_width = SOLVE_BEAM_WIDTH;
+    config.node_limit = SOLVE_NODE_LIMIT;
+    config.tt_mb = SOLVE_TT_MB;
+    config.tablebase = tablebase_loaded ? &tablebase : NULL;
+    line_solver_ready = hints != NULL && hint_engine_set_line_solver(hints, &config);
 }
 
 void cleanup_game() {
+    hint_engine_destroy(hints);
+    hints = NULL;
+    line_solver_ready = false;
+    if (tablebase_loaded) {
+        tablebase_close(&tablebase);
+        tablebase_loaded = false;
+    }
+
+    if (recording) {
+        replay_writer_end_game(&recorder, is_seven_rows_empty(seven_rows));
+        replay_writer_close(&recorder);
+        recording = false;
+    }
+
     // Free the deck
     free_card_list(deck);
     
@@ -687,6 +1057,7 @@ Card* create_deck() {
             new_card = (Card*)malloc(sizeof(Card)); // malloc is used to allocate memory dynamically.
             new_card->value = newValue;
             new_card->suit = suit;
+            new_card->is_hidden = false;
             new_card->next = deck;
             deck = new_card;
         }
@@ -694,6 +1065,24 @@ Card* create_deck() {
     return deck;
 }
 
+// Builds the deck in the order the engine shuffles it for this deal number, so a deal
+// number always gives the same game (replays rely on that)
+Card* create_deck_for_deal(uint32_t deal_number) {
+    uint8_t order[YUKON_CARDS];
+    deal_order(deal_number, order);
+
+    Card* deck = NULL;
+    for (int i = YUKON_CARDS - 1; i >= 0; i--) {
+        Card* new_card = (Card*)malloc(sizeof(Card));
+        new_card->value = CARD_VALUE(order[i]);
+        new_card->suit = CARD_SUIT_NUMBER(order[i]);
+        new_card->is_hidden = false;
+        new_card->next = deck;
+        deck = new_card;
+    }
+    return deck;
+}
+
 Card* get_card_by_index(Card* deck, int deckIndex) {
     if (deckIndex < 0) {
         return NULL;
@@ -802,6 +1191,15 @@ void deal_cards(Card** deck, Card** seven_rows) {
             card_counter++;
         }
     }
+
+    // Column i starts with i cards face down
+    for (int i = 1; i < 7; i++) {
+        Card* card = seven_rows[i];
+        for (int ii = 0; ii < i && card != NULL; ii++) {
+            card->is_hidden = true;
+            card = card->next;
+        }
+    }
 }
 
 char convert_to_char(int value) {
@@ -817,6 +1215,9 @@ char convert_to_char(int value) {
     else if (value == 13) {
         return 'K';
     }
+    else if (value == 10) {
+        return 'T';
+    }
     else {
         return value <= 9 ? (value + '0') : 0;
     }
@@ -896,8 +1297,21 @@ Card* get_card(LocationTranslator* lt, Card* seven_rows[7], GetCardType type, bo
                 }
             }
         }
-        // If card_str is empty, return the top card of the row, 
+        // If card_str is empty, take the last card of the row (the one that can be played)
         else {
+            Card* prevCard = NULL;
+            while (current_row != NULL && current_row->next != NULL) {
+                prevCard = current_row;
+                current_row = current_row->next;
+            }
+            if (set_prev_to_null && current_row != NULL) {
+                if (prevCard != NULL) {
+                    prevCard->next = NULL;
+                }
+                else {
+                    seven_rows[index - 1] = NULL;
+                }
+            }
             return current_row;
         }
     }
@@ -911,15 +1325,18 @@ bool is_move_allowed_to_seven_rows(Card* from, Card* to) {
     else {
         is_allowed = false;
     }
+    // Red (0 Hearts, 1 Diamonds) must go on black (2 Clubs, 3 Spades) and the other way round
+    int from_suit = from->suit - 1;
+    int to_suit = to->suit - 1;
     if (
-        (from->suit == 0 && to->suit == 2) ||
-        (from->suit == 0 && to->suit == 3) ||
-        (from->suit == 1 && to->suit == 2) ||
-        (from->suit == 1 && to->suit == 3) ||
-        (from->suit == 2 && to->suit == 0) ||
-        (from->suit == 2 && to->suit == 1) ||
-        (from->suit == 3 && to->suit == 0) ||
-        (from->suit == 3 && to->suit == 1)
+        (from_suit == 0 && to_suit == 2) ||
+        (from_suit == 0 && to_suit == 3) ||
+        (from_suit == 1 && to_suit == 2) ||
+        (from_suit == 1 && to_suit == 3) ||
+        (from_suit == 2 && to_suit == 0) ||
+        (from_suit == 2 && to_suit == 1) ||
+        (from_suit == 3 && to_suit == 0) ||
+        (from_suit == 3 && to_suit == 1)
         ) {
     }
     else {
@@ -935,7 +1352,8 @@ bool is_move_allowed_to_four_pockets(Card* from, Card* to) {
     }
     else {
         if (to != NULL) {
-            if ((from->value + 1) != to->value) {
+            // Foundations are built up in the same suit
+            if (from->value != (to->value + 1)) {
                 is_allowed = false;
             }
             if (from->suit != to->suit) {
@@ -971,3 +1389,306 @@ bool is_seven_rows_empty(Card* seven_rows[7]) {
     }
     return is_empty;
 }
+
+int count_cards(Card* list) {
+    int count = 0;
+    while (list != NULL) {
+        count++;
+        list = list->next;
+    }
+    return count;
+}
+
+Card* get_last_card(Card* list) {
+    while (list != NULL && list->next != NULL) {
+        list = list->next;
+    }
+    return list;
+}
+
+void append_cards(Card** pile, Card* cards) {
+    if (*pile == NULL) {
+        *pile = cards;
+    }
+    else {
+        get_last_card(*pile)->next = cards;
+    }
+}
+
+// Unlinks the last count cards of a pile and returns them
+Card* detach_last_cards(Card** pile, int count) {
+    int keep = count_cards(*pile) - count;
+    if (keep <= 0) {
+        Card* cards = *pile;
+        *pile = NULL;
+        return cards;
+    }
+    Card* last_kept = get_card_by_index(*pile, keep - 1);
+    Card* cards = last_kept->next;
+    last_kept->next = NULL;
+    return cards;
+}
+
+// Piles are numbered like in the move journal: 0-6 the seven rows, 7-10 the four pockets
+Card** get_pile(int pile) {
+    if (PILE_IS_FOUNDATION(pile)) {
+        return &four_pockets[pile - PILE_FOUNDATION];
+    }
+    return &seven_rows[pile];
+}
+
+void move_pile_cards(int from, int to, int count) {
+    Card* cards = detach_last_cards(get_pile(from), count);
+    append_cards(get_pile(to), cards);
+}
+
+// Turns the last card of a column face up once the cards on top of it are gone
+bool reveal_top_card(int column) {
+    Card* top = get_last_card(seven_rows[column]);
+    if (top != NULL && top->is_hidden) {
+        top->is_hidden = false;
+        return true;
+    }
+    return false;
+}
+
+// Replays use the engine pile numbers, where a foundation belongs to a suit instead of a pocket.
+// Call it after the move was made.
+Move to_engine_move(Move move) {
+    int to = MOVE_TO(move);
+    if (PILE_IS_FOUNDATION(to)) {
+        Card* pocket = four_pockets[to - PILE_FOUNDATION];
+        return MOVE_MAKE(MOVE_FROM(move), PILE_FOUNDATION + pocket->suit - 1, 1);
+    }
+    return MOVE_WITHOUT_FLAGS(move);
+}
+
+// Flat engine copy of the board. pocket_suit tells which suit each pocket holds,
+// since a pocket takes whatever suit is put there first.
+void board_to_state(GameState* state, uint8_t pocket_suit[4]) {
+    memset(state, 0, sizeof(*state));
+    int position = 0;
+    for (int column = 0; column < 7; column++) {
+        bool hidden_prefix = true;
+        for (Card* card = seven_rows[column]; card != NULL; card = card->next) {
+            state->cards[position++] = CARD_CODE(card->value, card->suit);
+            state->column_length[column]++;
+            hidden_prefix = hidden_prefix && card->is_hidden;
+            if (hidden_prefix) {
+                state->hidden_count[column]++;
+            }
+        }
+    }
+    for (int pocket = 0; pocket < 4; pocket++) {
+        pocket_suit[pocket] = SNAPSHOT_NO_SUIT;
+        if (four_pockets[pocket] != NULL) {
+            pocket_suit[pocket] = (uint8_t)(four_pockets[pocket]->suit - 1);
+            state->foundation[pocket_suit[pocket]] = (uint8_t)count_cards(four_pockets[pocket]);
+        }
+    }
+    state_rehash(state);
+}
+
+Card* make_card(uint8_t code, bool is_hidden) {
+    Card* card = (Card*)malloc(sizeof(Card));
+    card->value = CARD_VALUE(code);
+    card->suit = CARD_SUIT_NUMBER(code);
+    card->is_hidden = is_hidden;
+    card->next = NULL;
+    return card;
+}
+
+// Replaces the board with the given state
+void state_to_board(const GameState* state, const uint8_t pocket_suit[4]) {
+    int position = 0;
+    selected_card = NULL;
+    is_dragging = false;
+    for (int column = 0; column < 7; column++) {
+        free_card_list(seven_rows[column]);
+        seven_rows[column] = NULL;
+        for (int i = 0; i < state->column_length[column]; i++) {
+            append_cards(&seven_rows[column], make_card(state->cards[position++], i < state->hidden_count[column]));
+        }
+    }
+    for (int pocket = 0; pocket < 4; pocket++) {
+        free_card_list(four_pockets[pocket]);
+        four_pockets[pocket] = NULL;
+        if (pocket_suit[pocket] == SNAPSHOT_NO_SUIT) {
+            continue;
+        }
+        for (int rank = 0; rank < state->foundation[pocket_suit[pocket]]; rank++) {
+            append_cards(&four_pockets[pocket], make_card((uint8_t)(pocket_suit[pocket] * YUKON_RANKS + rank), false));
+        }
+    }
+}
+
+// Hands the current board to the hint engine, which drops whatever it was searching
+void request_hint() {
+    if (hints != NULL) {
+        GameState state;
+        uint8_t pocket_suit[4];
+        board_to_state(&state, pocket_suit);
+        hint_generation = hint_engine_request(hints, &state);
+    }
+}
+
+// Outlines the cards of the hinted move and where they go. Green for a move from a
+// winning line, yellow for a guess while the search is still running, red when the
+// game can no longer be won.
+void draw_hint(SDL_Renderer* renderer) {
+    if (hints == NULL) {
+        return;
+    }
+    Hint hint = hint_engine_peek(hints);
+    if (hint.generation != hint_generation || hint.move == MOVE_NONE) {
+        return;
+    }
+    int start_x = 50;
+    int start_y = 50;
+    int from = MOVE_FROM(hint.move);
+    int to = MOVE_TO(hint.move);
+    int length = count_cards(seven_rows[from]);
+    int first = length - MOVE_COUNT(hint.move);
+    if (first < 0) {
+        return;
+    }
+
+    if (hint.kind == HintWinning) {
+        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    } else if (hint.kind == HintNoWin) {
+        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    } else {
+        SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    }
+
+    SDL_FRect from_rect = {
+        start_x + from * (CARD_WIDTH + CARD_SPACING) - 2,
+        start_y + first * CARD_OVERLAP - 2,
+        CARD_WIDTH + 4,
+        (length - 1 - first) * CARD_OVERLAP + CARD_HEIGHT + 4
+    };
+    SDL_RenderRect(renderer, &from_rect);
+
+    SDL_FRect to_rect = { 0, 0, CARD_WIDTH + 4, CARD_HEIGHT + 4 };
+    if (PILE_IS_FOUNDATION(to)) {
+        int pocket = pocket_for_suit(to - PILE_FOUNDATION + 1);
+        if (pocket < 0) {
+            return;
+        }
+        to_rect.x = start_x + 7 * (CARD_WIDTH + CARD_SPACING) + 20 - 2;
+        to_rect.y = start_y + pocket * (CARD_HEIGHT + 20) - 2;
+    } else {
+        int target_length = count_cards(seven_rows[to]);
+        to_rect.x = start_x + to * (CARD_WIDTH + CARD_SPACING) - 2;
+        to_rect.y = start_y + (target_length > 0 ? target_length - 1 : 0) * CARD_OVERLAP - 2;
+    }
+    SDL_RenderRect(renderer, &to_rect);
+}
+
+// The engine has one foundation per suit, the board has pockets: a suit (1-4) goes to the
+// pocket that already holds it, or the first empty one. -1 if there is none.
+int pocket_for_suit(int suit) {
+    for (int i = 0; i < 4; i++) {
+        if (four_pockets[i] != NULL && four_pockets[i]->suit == suit) {
+            return i;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        if (four_pockets[i] == NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Beam search from the board as it is, on the hint worker; play_solution_step picks up the
+// line once it is found, and the hint shows its first move
+void solve_from_here() {
+    if (!line_solver_ready) {
+        return;
+    }
+    GameState state;
+    uint8_t pocket_suit[4];
+    board_to_state(&state, pocket_suit);
+    solve_generation = hint_engine_request_line(hints, &state);
+    hint_generation = solve_generation;
+}
+
+// Starts playing a line the worker found, then makes its next move once its time has come
+// as the command a player would type, so it goes through the same rule checks
+void play_solution_step() {
+    if (solve_generation != 0 && hint_engine_take_line(hints, solve_generation, &solve_result)) {
+        solve_generation = 0;
+        solve_next = 0;
+        solve_step_at = SDL_GetTicks();
+        if (solve_result.status != SolveWon) {
+            printf(solve_result.status == SolveUnsolvable ? "This game can not be won any more\n" : "No winning line found\n");
+            solve_result.length = 0;
+        }
+    }
+    if (solve_next >= solve_result.length || SDL_GetTicks() < solve_step_at) {
+        return;
+    }
+    Move move = MOVE_WITHOUT_FLAGS(solve_result.line[solve_next++]);
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    Card* card = get_card_by_index(seven_rows[from], count_cards(seven_rows[from]) - MOVE_COUNT(move));
+    char command[20];
+    if (card == NULL) {
+        sprintf(command, "C%d->C%d", from + 1, to + 1);
+    } else if (PILE_IS_FOUNDATION(to)) {
+        sprintf(command, "C%d->F%d", from + 1, pocket_for_suit(to - PILE_FOUNDATION + 1) + 1);
+    } else {
+        sprintf(command, "C%d:%c%c->C%d", from + 1, convert_to_char(card->value), "HDCS"[card->suit - 1], to + 1);
+    }
+    if (card == NULL || !play_move_command(command)) {
+        printf("The solver's move %s is not allowed here, stopping\n", command);
+        stop_solution();
+        return;
+    }
+    solve_step_at += SOLVE_STEP_MS;
+}
+
+void stop_solution() {
+    solve_generation = 0;
+    solve_result.length = 0;
+    solve_next = 0;
+}
+
+// Frame time percentiles over the last frames and the average time of each part of a
+// frame, in a box above the right end of the command input
+void draw_profiler(SDL_Renderer* renderer) {
+    FrameStats stats;
+    frame_profiler_stats(&profiler, &stats);
+
+    SDL_FRect box = {WINDOW_WIDTH - 330, WINDOW_HEIGHT - 110, 320, 64};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderFillRect(renderer, &box);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderRect(renderer, &box);
+
+    char line[64];
+    sprintf(line, "Frame ms over %u frames", stats.frames);
+    SDL_RenderDebugText(renderer, box.x + 8, box.y + 8, line);
+    sprintf(line, "p50 %.2f p95 %.2f p99 %.2f", stats.p50_ms, stats.p95_ms, stats.p99_ms);
+    SDL_RenderDebugText(renderer, box.x + 8, box.y + 22, line);
+    sprintf(line, "max %.2f events %.2f", stats.max_ms, stats.section_ms[ProfileEvents]);
+    SDL_RenderDebugText(renderer, box.x + 8, box.y + 36, line);
+    sprintf(line, "draw %.2f present %.2f", stats.section_ms[ProfileDraw], stats.section_ms[ProfilePresent]);
+    SDL_RenderDebugText(renderer, box.x + 8, box.y + 50, line);
+}
+
+void write_trace() {
+    if (trace_path == NULL) {
+        return;
+    }
+    uint64_t events;
+    uint64_t dropped;
+    if (trace_write_json(trace_path, &events, &dropped)) {
+        printf("Wrote %llu trace events to %s (%llu dropped)\n", (unsigned long long)events, trace_path,
+               (unsigned long long)dropped);
+    }
+    else {
+        printf("Could not write the trace to %s\n", trace_path);
+    }
+}
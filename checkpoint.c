@@ -0,0 +1,427 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "checkpoint.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRONTIER_BYTES (1u << 20)
+
+// PATH.table: this header, the hash of every chunk, then the chunks
+typedef struct TableHeader {
+    char magic[4];          // "YKCT"
+    uint32_t version;
+    uint64_t run;
+    uint64_t table_bytes;
+    uint32_t chunk_bytes;
+    uint32_t chunk_count;
+} TableHeader;
+
+struct CheckpointWriter {
+    char* path;
+    char* temp_path;
+    char* table_path;
+    TranspositionTable* table;  // NULL when only the progress is saved
+    FILE* table_file;
+    uint64_t run;
+    uint32_t saves_before;
+    uint64_t elapsed_before;
+    uint64_t started;
+
+    // Table chunks: the hash last written for each, until then unknown
+    uint32_t chunk_bytes;
+    uint32_t chunk_count;
+    uint64_t* chunk_hash;
+    bool* chunk_known;
+    uint8_t* chunk;
+
+    // The checkpoint handed over by the search, frontier is only touched while nothing is pending
+    PlatformMutex mutex;
+    PlatformCondition condition;
+    PlatformThread thread;
+    bool running;
+    bool pending;
+    bool busy;
+    bool quit;
+    SolverProgress job;
+    uint8_t* frontier;
+    CheckpointStats stats;
+};
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Word at a time, a chunk is hashed on every checkpoint whether it changed or not
+static uint64_t chunk_hash(const uint8_t* chunk, size_t size) {
+    uint64_t hash = 0x59554B4F4E434B50ull; // "YUKONCKP"
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        memcpy(&word, chunk + i, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+static char* path_with(const char* path, const char* suffix) {
+    size_t length = strlen(path);
+    char* out = (char*)malloc(length + strlen(suffix) + 1);
+    if (out) {
+        memcpy(out, path, length);
+        strcpy(out + length, suffix);
+    }
+    return out;
+}
+
+static uint32_t table_chunk_bytes(uint64_t table_bytes) {
+    return table_bytes < CHECKPOINT_CHUNK_BYTES ? (uint32_t)table_bytes : CHECKPOINT_CHUNK_BYTES;
+}
+
+// Drops what the search stored after the checkpoint was taken
+static bool stored_by_then(const TTEntry* entry, void* context) {
+    return entry->value <= *(const int32_t*)context;
+}
+
+static bool load_table(const char* path, const CheckpointHeader* header, TranspositionTable* table,
+                       uint32_t* chunks_dropped) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    TableHeader table_header;
+    bool ok = fread(&table_header, sizeof(table_header), 1, file) == 1 && memcmp(table_header.magic, "YKCT", 4) == 0 &&
+              table_header.version == CHECKPOINT_VERSION && table_header.run == header->run &&
+              table_header.table_bytes == header->table_bytes && table_header.table_bytes == tt_image_size(table) &&
+              table_header.chunk_bytes == table_chunk_bytes(table_header.table_bytes) &&
+              (uint64_t)table_header.chunk_count * table_header.chunk_bytes == table_header.table_bytes;
+    uint64_t* hashes = NULL;
+    uint8_t* chunk = NULL;
+    if (ok) {
+        hashes = (uint64_t*)malloc(sizeof(uint64_t) * table_header.chunk_count);
+        chunk = (uint8_t*)malloc(table_header.chunk_bytes);
+        ok = hashes && chunk && fread(hashes, sizeof(uint64_t), table_header.chunk_count, file) == table_header.chunk_count;
+    }
+    if (ok) {
+        // A chunk torn by a crash does not match its hash and stays empty
+        tt_clear(table);
+        for (uint32_t i = 0; i < table_header.chunk_count && ok; i++) {
+            ok = fread(chunk, 1, table_header.chunk_bytes, file) == table_header.chunk_bytes;
+            if (ok && chunk_hash(chunk, table_header.chunk_bytes) == hashes[i]) {
+                tt_write_image(table, (size_t)i * table_header.chunk_bytes, chunk, table_header.chunk_bytes);
+            }
+            else {
+                (*chunks_dropped)++;
+            }
+        }
+        tt_retain(table, stored_by_then, (void*)&header->last_id);
+        if (!ok) {
+            tt_clear(table);
+        }
+    }
+    free(hashes);
+    free(chunk);
+    fclose(file);
+    return ok;
+}
+
+bool checkpoint_load(const char* path, TranspositionTable* table, Checkpoint* checkpoint) {
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    CheckpointHeader* header = &checkpoint->header;
+    uint32_t checksum = 0;
+    bool ok = fread(header, sizeof(*header), 1, file) == 1 && memcmp(header->magic, "YKCP", 4) == 0 &&
+              header->version == CHECKPOINT_VERSION && header->rules_version == YUKON_RULES_VERSION &&
+              header->frontier_size <= MAX_FRONTIER_BYTES;
+    if (ok) {
+        checkpoint->frontier = (uint8_t*)malloc(header->frontier_size + 1);
+        ok = checkpoint->frontier != NULL &&
+             fread(checkpoint->frontier, 1, header->frontier_size, file) == header->frontier_size &&
+             fread(&checksum, sizeof(checksum), 1, file) == 1 &&
+             checksum == fnv1a(fnv1a(2166136261u, header, sizeof(*header)), checkpoint->frontier, header->frontier_size);
+    }
+    fclose(file);
+    if (!ok) {
+        checkpoint_free(checkpoint);
+        return false;
+    }
+
+    SolverProgress* progress = &checkpoint->progress;
+    progress->start_hash = header->start_hash;
+    progress->nodes = header->nodes;
+    progress->first_id = header->first_id;
+    progress->last_id = header->last_id;
+    progress->truncated = header->truncated != 0;
+    progress->stopping = false;
+    progress->frontier = checkpoint->frontier;
+    progress->frontier_size = header->frontier_size;
+
+    if (table != NULL && header->table_bytes != 0) {
+        char* table_path = path_with(path, ".table");
+        if (table_path) {
+            uint64_t trace_start = trace_begin();
+            checkpoint->table_loaded = load_table(table_path, header, table, &checkpoint->chunks_dropped);
+            trace_end_value("load checkpoint table", "checkpoint", trace_start, (int64_t)header->table_bytes);
+            free(table_path);
+        }
+    }
+    return true;
+}
+
+void checkpoint_free(Checkpoint* checkpoint) {
+    free(checkpoint->frontier);
+    checkpoint->frontier = NULL;
+    checkpoint->progress.frontier = NULL;
+}
+
+void checkpoint_remove(const char* path) {
+    char* table_path = path_with(path, ".table");
+    remove(path);
+    if (table_path) {
+        remove(table_path);
+        free(table_path);
+    }
+}
+
+CheckpointWriter* checkpoint_writer_create(const char* path) {
+    CheckpointWriter* writer = (CheckpointWriter*)calloc(1, sizeof(CheckpointWriter));
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->path = path_with(path, "");
+    writer->temp_path = path_with(path, ".tmp");
+    writer->table_path = path_with(path, ".table");
+    writer->frontier = (uint8_t*)malloc(MAX_FRONTIER_BYTES);
+    bool mutex = platform_mutex_init(&writer->mutex);
+    bool condition = platform_condition_init(&writer->condition);
+    if (!writer->path || !writer->temp_path || !writer->table_path || !writer->frontier || !mutex || !condition) {
+        if (mutex) {
+            platform_mutex_destroy(&writer->mutex);
+        }
+        if (condition) {
+            platform_condition_destroy(&writer->condition);
+        }
+        free(writer->path);
+        free(writer->temp_path);
+        free(writer->table_path);
+        free(writer->frontier);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+// A new table file gets its header and no valid chunk; a resumed one keeps its chunks, but
+// they are all written again on the first checkpoint, the table having changed since.
+static bool open_table_file(CheckpointWriter* writer, bool resumed) {
+    writer->chunk_hash = (uint64_t*)calloc(writer->chunk_count, sizeof(uint64_t));
+    writer->chunk_known = (bool*)calloc(writer->chunk_count, sizeof(bool));
+    writer->chunk = (uint8_t*)malloc(writer->chunk_bytes);
+    if (!writer->chunk_hash || !writer->chunk_known || !writer->chunk) {
+        return false;
+    }
+    if (resumed) {
+        writer->table_file = fopen(writer->table_path, "r+b");
+        if (writer->table_file) {
+            return true;
+        }
+    }
+    writer->table_file = fopen(writer->table_path, "w+b");
+    if (writer->table_file == NULL) {
+        return false;
+    }
+    TableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "YKCT", 4);
+    header.version = CHECKPOINT_VERSION;
+    header.run = writer->run;
+    header.table_bytes = tt_image_size(writer->table);
+    header.chunk_bytes = writer->chunk_bytes;
+    header.chunk_count = writer->chunk_count;
+    return fwrite(&header, sizeof(header), 1, writer->table_file) == 1 &&
+           fwrite(writer->chunk_hash, sizeof(uint64_t), writer->chunk_count, writer->table_file) == writer->chunk_count;
+}
+
+// Every changed chunk goes to its place, then the hashes, so a chunk is never taken for
+// valid before it is fully written
+static bool write_table(CheckpointWriter* writer, uint64_t* written) {
+    uint64_t data_offset = sizeof(TableHeader) + sizeof(uint64_t) * (uint64_t)writer->chunk_count;
+    for (uint32_t i = 0; i < writer->chunk_count; i++) {
+        tt_read_image(writer->table, (size_t)i * writer->chunk_bytes, writer->chunk, writer->chunk_bytes);
+        uint64_t hash = chunk_hash(writer->chunk, writer->chunk_bytes);
+        if (writer->chunk_known[i] && writer->chunk_hash[i] == hash) {
+            continue;
+        }
+        if (!platform_seek(writer->table_file, data_offset + (uint64_t)i * writer->chunk_bytes) ||
+            fwrite(writer->chunk, 1, writer->chunk_bytes, writer->table_file) != writer->chunk_bytes) {
+            return false;
+        }
+        writer->chunk_hash[i] = hash;
+        writer->chunk_known[i] = true;
+        *written += writer->chunk_bytes;
+    }
+    return platform_seek(writer->table_file, sizeof(TableHeader)) &&
+           fwrite(writer->chunk_hash, sizeof(uint64_t), writer->chunk_count, writer->table_file) == writer->chunk_count &&
+           fflush(writer->table_file) == 0;
+}
+
+static bool write_progress(CheckpointWriter* writer, const SolverProgress* progress, uint32_t saves, uint64_t now) {
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "YKCP", 4);
+    header.version = CHECKPOINT_VERSION;
+    header.rules_version = YUKON_RULES_VERSION;
+    header.saves = saves;
+    header.run = writer->run;
+    header.start_hash = progress->start_hash;
+    header.nodes = progress->nodes;
+    header.elapsed_ns = writer->elapsed_before + (now - writer->started);
+    header.first_id = progress->first_id;
+    header.last_id = progress->last_id;
+    header.table_bytes = writer->table ? tt_image_size(writer->table) : 0;
+    header.truncated = progress->truncated;
+    header.frontier_size = (uint32_t)progress->frontier_size;
+    uint32_t checksum = fnv1a(fnv1a(2166136261u, &header, sizeof(header)), progress->frontier, progress->frontier_size);
+
+    FILE* file = fopen(writer->temp_path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(progress->frontier, 1, progress->frontier_size, file) == progress->frontier_size &&
+              fwrite(&checksum, sizeof(checksum), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    return ok && platform_replace_file(writer->temp_path, writer->path);
+}
+
+// The table is read after the progress was taken, so it may hold later entries; loading
+// drops them. Runs unlocked, the statistics are added up by the caller.
+static bool write_checkpoint(CheckpointWriter* writer, const SolverProgress* progress, uint32_t saves, uint64_t* written) {
+    uint64_t trace_start = trace_begin();
+    bool ok = writer->table == NULL || write_table(writer, written);
+    ok = ok && write_progress(writer, progress, saves, platform_time_ns());
+    trace_end_value("checkpoint", "checkpoint", trace_start, (int64_t)progress->nodes);
+    return ok;
+}
+
+static void writer_thread(void* argument) {
+    CheckpointWriter* writer = (CheckpointWriter*)argument;
+    trace_thread_name("checkpoint");
+    platform_mutex_lock(&writer->mutex);
+    for (;;) {
+        while (!writer->pending && !writer->quit) {
+            platform_condition_wait(&writer->condition, &writer->mutex);
+        }
+        if (!writer->pending) {
+            break;
+        }
+        SolverProgress job = writer->job;
+        uint32_t saves = writer->saves_before + writer->stats.saves + 1;
+        writer->pending = false;
+        writer->busy = true;
+        platform_mutex_unlock(&writer->mutex);
+
+        uint64_t start = platform_time_ns();
+        uint64_t written = 0;
+        bool ok = write_checkpoint(writer, &job, saves, &written);
+
+        platform_mutex_lock(&writer->mutex);
+        writer->stats.saves += ok;
+        writer->stats.failures += !ok;
+        writer->stats.table_bytes_written += written;
+        writer->stats.write_ns += platform_time_ns() - start;
+        writer->busy = false;
+        platform_condition_broadcast(&writer->condition);
+    }
+    platform_mutex_unlock(&writer->mutex);
+    trace_thread_release();
+}
+
+bool checkpoint_writer_start(CheckpointWriter* writer, TranspositionTable* table, const Checkpoint* resumed) {
+    writer->started = platform_time_ns();
+    // A table loaded with the checkpoint carries its run on; any other table starts a new one,
+    // so the old image never passes for the new table's
+    bool same_run = resumed && (table == NULL || resumed->table_loaded);
+    writer->run = same_run ? resumed->header.run : (writer->started ^ (uint64_t)(uintptr_t)writer) * 0x9E3779B97F4A7C15ull;
+    if (resumed) {
+        writer->saves_before = resumed->header.saves;
+        writer->elapsed_before = resumed->header.elapsed_ns;
+    }
+    if (table != NULL) {
+        writer->table = table;
+        writer->chunk_bytes = table_chunk_bytes(tt_image_size(table));
+        writer->chunk_count = (uint32_t)(tt_image_size(table) / writer->chunk_bytes);
+        if (!open_table_file(writer, same_run)) {
+            return false;
+        }
+    }
+    writer->running = platform_thread_start(&writer->thread, writer_thread, writer);
+    return writer->running;
+}
+
+void checkpoint_save(const SolverProgress* progress, void* context) {
+    CheckpointWriter* writer = (CheckpointWriter*)context;
+    if (!writer->running || progress->frontier_size > MAX_FRONTIER_BYTES) {
+        return;
+    }
+    platform_mutex_lock(&writer->mutex);
+    if (progress->stopping) {
+        while (writer->pending || writer->busy) {
+            platform_condition_wait(&writer->condition, &writer->mutex);
+        }
+    }
+    if (writer->pending || writer->busy) {
+        writer->stats.skipped++;
+    }
+    else {
+        memcpy(writer->frontier, progress->frontier, progress->frontier_size);
+        writer->job = *progress;
+        writer->job.frontier = writer->frontier;
+        writer->pending = true;
+        platform_condition_broadcast(&writer->condition);
+    }
+    platform_mutex_unlock(&writer->mutex);
+}
+
+void checkpoint_writer_stats(CheckpointWriter* writer, CheckpointStats* out) {
+    platform_mutex_lock(&writer->mutex);
+    while (writer->running && (writer->pending || writer->busy)) {
+        platform_condition_wait(&writer->condition, &writer->mutex);
+    }
+    *out = writer->stats;
+    platform_mutex_unlock(&writer->mutex);
+}
+
+void checkpoint_writer_destroy(CheckpointWriter* writer) {
+    if (writer == NULL) {
+        return;
+    }
+    if (writer->running) {
+        platform_mutex_lock(&writer->mutex);
+        writer->quit = true;
+        platform_condition_broadcast(&writer->condition);
+        platform_mutex_unlock(&writer->mutex);
+        platform_thread_join(&writer->thread);
+    }
+    if (writer->table_file) {
+        fclose(writer->table_file);
+    }
+    platform_mutex_destroy(&writer->mutex);
+    platform_condition_destroy(&writer->condition);
+    free(writer->chunk_hash);
+    free(writer->chunk_known);
+    free(writer->chunk);
+    free(writer->frontier);
+    free(writer->path);
+    free(writer->temp_path);
+    free(writer->table_path);
+    free(writer);
+}
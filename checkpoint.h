@@ -0,0 +1,87 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// On-disk checkpoints of a long depth first solve, so a solve stopped or killed after hours
+// goes on from where it was instead of starting over.
+//
+// A checkpoint is two files. PATH holds the solver's progress (SolverProgress): a fixed
+// header with the nodes and time so far, then the encoded search path, a few kilobytes. It
+// is written whole to PATH.tmp and moved over PATH, so a crash leaves the last complete one.
+// PATH.table holds an image of the transposition table, when it is saved. The table is read
+// in 1 MB chunks while the search goes on and only the chunks that changed since the last
+// checkpoint are written again, each with a hash, so a chunk torn by a crash is dropped on
+// loading. Entries the search stored after its progress was taken carry a later id and are
+// dropped on loading too, which keeps the table in step with the path it is loaded with.
+//
+// The writing runs on a thread of its own: the search only copies its path, and when the
+// last checkpoint is still being written it skips this one (but never the last one before
+// it gives up). Fields are little endian, like snapshot.h.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "solver.h"
+#include "transposition_table.h"
+
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_CHUNK_BYTES (1u << 20)
+
+typedef struct CheckpointHeader {
+    char magic[4];          // "YKCP"
+    uint32_t version;
+    uint32_t rules_version;
+    uint32_t saves;         // Checkpoints taken by the solve so far, this one included
+    uint64_t run;           // Tells the table saved with this checkpoint from older ones
+    uint64_t start_hash;
+    uint64_t nodes;
+    uint64_t elapsed_ns;    // Search time so far, over every run of the solve
+    int32_t first_id;
+    int32_t last_id;
+    uint64_t table_bytes;   // Size of the table image in PATH.table, 0 when none was saved
+    uint32_t truncated;
+    uint32_t frontier_size; // Encoded path, followed by the FNV-1a of everything before it
+} CheckpointHeader;
+
+_Static_assert(sizeof(CheckpointHeader) == 72, "CheckpointHeader is written as is");
+
+typedef struct Checkpoint {
+    CheckpointHeader header;
+    SolverProgress progress; // Ready for solver_resume, frontier points into frontier below
+    bool table_loaded;       // The table image was valid and is in the table now
+    uint32_t chunks_dropped; // Table chunks whose hash did not match, lost to a crash
+    uint8_t* frontier;
+} Checkpoint;
+
+// Loads the checkpoint at path, and the table image saved with it into table unless table is
+// NULL. Returns false when there is no valid checkpoint.
+bool checkpoint_load(const char* path, TranspositionTable* table, Checkpoint* checkpoint);
+void checkpoint_free(Checkpoint* checkpoint);
+
+// Deletes both files, once the solve has its answer
+void checkpoint_remove(const char* path);
+
+typedef struct CheckpointStats {
+    uint32_t saves;
+    uint32_t skipped;       // Still writing the one before
+    uint32_t failures;      // Could not write the files
+    uint64_t table_bytes_written;
+    uint64_t write_ns;      // Time the writer thread spent, none of it in the search
+} CheckpointStats;
+
+typedef struct CheckpointWriter CheckpointWriter;
+
+// A writer does nothing until it is started, so it can go in the config of the solver whose
+// table it saves: create it, pass checkpoint_save with the writer to solver_create, then
+// start it with the solver's table (solver_table) or NULL to save only the progress.
+// resumed is the checkpoint the solve goes on from, NULL for a new solve.
+CheckpointWriter* checkpoint_writer_create(const char* path);
+bool checkpoint_writer_start(CheckpointWriter* writer, TranspositionTable* table, const Checkpoint* resumed);
+// Finishes the checkpoint being written first
+void checkpoint_writer_destroy(CheckpointWriter* writer);
+// Waits for the checkpoint being written, if any
+void checkpoint_writer_stats(CheckpointWriter* writer, CheckpointStats* out);
+
+// A SolverCheckpointFunction, with the writer as its context
+void checkpoint_save(const SolverProgress* progress, void* writer);
+
+#endif
@@ -0,0 +1,130 @@
+#include "deadlock.h"
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CARD_BIT(card) (1ull << (card))
+
+static uint8_t lowest_card(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint8_t)index;
+#else
+    return (uint8_t)__builtin_ctzll(mask);
+#endif
+}
+
+typedef struct Layout {
+    uint8_t column_of[YUKON_CARDS];     // NO_CARD for foundation cards
+    uint8_t index_of[YUKON_CARDS];      // From the bottom of the column
+    uint8_t above[YUKON_CARDS];         // Card lying directly on it, NO_CARD for a top card
+    int start[YUKON_COLUMNS];
+    uint64_t tableau;
+} Layout;
+
+static void build_layout(const GameState* state, Layout* layout) {
+    memset(layout->column_of, NO_CARD, sizeof(layout->column_of));
+    layout->tableau = 0;
+    for (int column = 0, position = 0; column < YUKON_COLUMNS; column++) {
+        layout->start[column] = position;
+        for (int i = 0; i < state->column_length[column]; i++, position++) {
+            uint8_t card = state->cards[position];
+            layout->column_of[card] = (uint8_t)column;
+            layout->index_of[card] = (uint8_t)i;
+            layout->above[card] = i + 1 < state->column_length[column] ? state->cards[position + 1] : NO_CARD;
+            layout->tableau |= CARD_BIT(card);
+        }
+    }
+}
+
+static bool covered_by(const Layout* layout, uint8_t card, uint64_t locked) {
+    return layout->above[card] != NO_CARD && (locked & CARD_BIT(layout->above[card])) != 0;
+}
+
+// The card can never be the base of a moved stack while the other locked cards stay put
+static bool stays_locked(const GameState* state, const Layout* layout, uint8_t card, uint64_t locked) {
+    int column = layout->column_of[card];
+    int index = layout->index_of[card];
+    if (index < state->hidden_count[column] && covered_by(layout, card, locked)) {
+        return true; // Cannot turn face up before the card on it leaves
+    }
+    int rank = CARD_RANK(card);
+    if (rank == YUKON_RANKS - 1) {
+        return false; // Kings can always hope for an empty column
+    }
+    int other = CARD_IS_RED(card) ? 2 : 0;
+    for (int suit = other; suit < other + 2; suit++) {
+        uint8_t target = (uint8_t)(suit * YUKON_RANKS + rank + 1);
+        if (layout->column_of[target] == NO_CARD) {
+            continue; // On its foundation for good
+        }
+        if (layout->column_of[target] != column || layout->index_of[target] > index) {
+            return false;
+        }
+        // Any unlocked card in between could carry this one away from the target
+        const uint8_t* cards = &state->cards[layout->start[column]];
+        for (int i = layout->index_of[target] + 1; i < index; i++) {
+            if ((locked & CARD_BIT(cards[i])) == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint64_t locked_set(const GameState* state, const Layout* layout) {
+    uint64_t locked = layout->tableau;
+    bool changed = true;
+    while (changed && locked != 0) {
+        changed = false;
+        for (uint64_t rest = locked; rest != 0; rest &= rest - 1) {
+            uint8_t card = lowest_card(rest);
+            if (!stays_locked(state, layout, card, locked)) {
+                locked &= ~CARD_BIT(card);
+                changed = true;
+            }
+        }
+    }
+    return locked;
+}
+
+// Whether the card could be the first locked card to reach its foundation
+static bool can_leave_first(const GameState* state, const Layout* layout, uint8_t card, uint64_t locked) {
+    if (covered_by(layout, card, locked)) {
+        return false;
+    }
+    int suit = CARD_SUIT(card);
+    for (int rank = state->foundation[suit]; rank < CARD_RANK(card); rank++) {
+        uint8_t lower = (uint8_t)(suit * YUKON_RANKS + rank);
+        if ((locked & CARD_BIT(lower)) != 0 || covered_by(layout, lower, locked)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool deadlock_find(const GameState* state, uint64_t* locked_cards) {
+    if (locked_cards != NULL) {
+        *locked_cards = 0;
+    }
+    if (state_is_won(state)) {
+        return false;
+    }
+    Layout layout;
+    build_layout(state, &layout);
+    uint64_t locked = locked_set(state, &layout);
+    bool dead = locked != 0;
+    for (uint64_t rest = locked; rest != 0 && dead; rest &= rest - 1) {
+        dead = !can_leave_first(state, &layout, lowest_card(rest), locked);
+    }
+    if (dead) {
+        if (locked_cards != NULL) {
+            *locked_cards = locked;
+        }
+        return true;
+    }
+    Move moves[YUKON_MAX_MOVES];
+    return state_generate_moves(state, moves) == 0;
+}
@@ -0,0 +1,289 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "deal_database.h"
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, (uint16_t)value);
+    put_u16(out + 2, (uint16_t)(value >> 16));
+}
+
+static void put_u64(uint8_t* out, uint64_t value) {
+    put_u32(out, (uint32_t)value);
+    put_u32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t get_u16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return (uint32_t)get_u16(in) | ((uint32_t)get_u16(in + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    return (uint64_t)get_u32(in) | ((uint64_t)get_u32(in + 4) << 32);
+}
+
+bool deal_db_open(DealDatabase* db, const char* path) {
+    memset(db, 0, sizeof(*db));
+    if (!platform_map_file(path, &db->file)) {
+        return false;
+    }
+    const uint8_t* data = db->file.data;
+    size_t size = db->file.size;
+    if (size < DEAL_DB_HEADER_SIZE || memcmp(data, "YKDB", 4) != 0 || get_u16(data + 4) != DEAL_DB_FORMAT_VERSION) {
+        deal_db_close(db);
+        return false;
+    }
+    db->rules_version = get_u16(data + 6);
+    db->first_deal = get_u32(data + 8);
+    db->deal_count = get_u32(data + 12);
+    db->won_count = get_u32(data + 16);
+    db->node_limit = get_u64(data + 24);
+
+    uint64_t records = get_u64(data + 32);
+    uint64_t by_length = get_u64(data + 40);
+    uint64_t lines = get_u64(data + 48);
+    db->lines_size = get_u64(data + 56);
+
+    // Reject files whose sections do not fit, e.g. a build that was interrupted
+    if (records + (uint64_t)db->deal_count * DEAL_DB_RECORD_SIZE > size ||
+        by_length + (uint64_t)db->won_count * 4 > size || lines + db->lines_size > size ||
+        db->won_count > db->deal_count) {
+        deal_db_close(db);
+        return false;
+    }
+    db->records = data + records;
+    db->by_length = data + by_length;
+    db->lines = data + lines;
+    return true;
+}
+
+void deal_db_close(DealDatabase* db) {
+    platform_unmap_file(&db->file);
+    memset(db, 0, sizeof(*db));
+}
+
+static void read_record(const DealDatabase* db, uint32_t index, DealInfo* info) {
+    const uint8_t* record = db->records + (size_t)index * DEAL_DB_RECORD_SIZE;
+    uint64_t line_offset = get_u64(record + 8);
+    info->deal_number = db->first_deal + index;
+    info->status = (SolveStatus)record[0];
+    info->length = get_u16(record + 2);
+    info->nodes = get_u32(record + 4);
+    info->line = line_offset < db->lines_size ? db->lines + line_offset : NULL;
+}
+
+bool deal_db_lookup(const DealDatabase* db, uint32_t deal_number, DealInfo* info) {
+    uint32_t index = deal_number - db->first_deal;
+    if (deal_number < db->first_deal || index >= db->deal_count) {
+        return false;
+    }
+    read_record(db, index, info);
+    return true;
+}
+
+bool deal_db_won_by_rank(const DealDatabase* db, uint32_t rank, DealInfo* info) {
+    if (rank >= db->won_count) {
+        return false;
+    }
+    uint32_t index = get_u32(db->by_length + (size_t)rank * 4);
+    if (index >= db->deal_count) {
+        return false;
+    }
+    read_record(db, index, info);
+    return true;
+}
+
+bool deal_db_pick(const DealDatabase* db, DealDifficulty difficulty, uint64_t* rng, uint32_t* deal_number) {
+    uint32_t begin = 0;
+    uint32_t end = db->won_count;
+    DealInfo info;
+
+    if (difficulty != DealAnyWinnable) {
+        // Thirds of the winnable deals ordered by solution length
+        uint32_t third = db->won_count / 3;
+        begin = (uint32_t)(difficulty - DealEasy) * third;
+        end = difficulty == DealHard ? db->won_count : begin + third;
+    }
+    if (end <= begin || !deal_db_won_by_rank(db, begin + rng_below(rng, end - begin), &info)) {
+        return false;
+    }
+    *deal_number = info.deal_number;
+    return true;
+}
+
+uint32_t deal_db_line(const DealDatabase* db, const DealInfo* info, Move* moves, uint32_t max_moves) {
+    if (info->line == NULL) {
+        return 0;
+    }
+    ReplayGame game;
+    ReplayCursor cursor;
+    memset(&game, 0, sizeof(game));
+    game.moves = info->line;
+    game.length = (uint32_t)(db->lines + db->lines_size - info->line);
+
+    uint32_t count = 0;
+    replay_cursor_init(&cursor, &game);
+    while (count < info->length && count < max_moves && replay_cursor_next(&cursor, &moves[count])) {
+        count++;
+    }
+    return count;
+}
+
+bool deal_difficulty_from_string(const char* text, DealDifficulty* difficulty) {
+    static const char* names[] = { "any", "easy", "medium", "hard" };
+    for (int i = 0; i < 4; i++) {
+        const char* a = text;
+        const char* b = names[i];
+        while (*a && tolower((unsigned char)*a) == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            *difficulty = (DealDifficulty)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool deal_db_choose(const char* path, DealDifficulty difficulty, uint64_t seed, uint32_t* deal_number) {
+    DealDatabase db;
+    if (!deal_db_open(&db, path)) {
+        return false;
+    }
+    bool found = deal_db_pick(&db, difficulty, &seed, deal_number);
+    deal_db_close(&db);
+    return found;
+}
+
+bool deal_db_builder_init(DealDbBuilder* builder, uint32_t first_deal, uint32_t deal_count, uint64_t node_limit) {
+    builder->first_deal = first_deal;
+    builder->deal_count = deal_count;
+    builder->node_limit = node_limit;
+    builder->records = (DealDbBuilderRecord*)calloc(deal_count ? deal_count : 1, sizeof(DealDbBuilderRecord));
+    return builder->records != NULL;
+}
+
+bool deal_db_builder_add(DealDbBuilder* builder, uint32_t deal_number, const SolveResult* result) {
+    uint32_t index = deal_number - builder->first_deal;
+    if (deal_number < builder->first_deal || index >= builder->deal_count) {
+        return false;
+    }
+    DealDbBuilderRecord* record = &builder->records[index];
+    record->status = (uint8_t)result->status;
+    record->length = (uint16_t)result->length;
+    record->nodes = result->nodes > UINT32_MAX ? UINT32_MAX : (uint32_t)result->nodes;
+
+    if (result->status == SolveWon && result->length > 0) {
+        uint8_t packed[SOLVER_MAX_LINE * 2];
+        uint32_t bytes = 0;
+        for (uint32_t i = 0; i < result->length; i++) {
+            bytes += (uint32_t)replay_pack_move(result->line[i], packed + bytes);
+        }
+        record->line = (uint8_t*)malloc(bytes);
+        if (record->line == NULL) {
+            return false;
+        }
+        memcpy(record->line, packed, bytes);
+        record->line_bytes = bytes;
+    }
+    return true;
+}
+
+static const DealDbBuilderRecord* sort_records;
+
+static int compare_by_length(const void* a, const void* b) {
+    uint32_t left = *(const uint32_t*)a;
+    uint32_t right = *(const uint32_t*)b;
+    if (sort_records[left].length != sort_records[right].length) {
+        return sort_records[left].length < sort_records[right].length ? -1 : 1;
+    }
+    return left < right ? -1 : (left > right);
+}
+
+bool deal_db_builder_write(const DealDbBuilder* builder, const char* path) {
+    uint32_t* by_length = (uint32_t*)malloc(sizeof(uint32_t) * (builder->deal_count ? builder->deal_count : 1));
+    if (by_length == NULL) {
+        return false;
+    }
+    uint32_t won_count = 0;
+    uint64_t lines_size = 0;
+    for (uint32_t i = 0; i < builder->deal_count; i++) {
+        if (builder->records[i].status == SolveWon) {
+            by_length[won_count++] = i;
+        }
+        lines_size += builder->records[i].line_bytes;
+    }
+    sort_records = builder->records;
+    qsort(by_length, won_count, sizeof(uint32_t), compare_by_length);
+
+    uint64_t records_offset = DEAL_DB_HEADER_SIZE;
+    uint64_t by_length_offset = records_offset + (uint64_t)builder->deal_count * DEAL_DB_RECORD_SIZE;
+    uint64_t lines_offset = by_length_offset + (uint64_t)won_count * 4;
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        free(by_length);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    uint8_t header[DEAL_DB_HEADER_SIZE] = { 'Y', 'K', 'D', 'B' };
+    put_u16(header + 4, DEAL_DB_FORMAT_VERSION);
+    put_u16(header + 6, YUKON_RULES_VERSION);
+    put_u32(header + 8, builder->first_deal);
+    put_u32(header + 12, builder->deal_count);
+    put_u32(header + 16, won_count);
+    put_u64(header + 24, builder->node_limit);
+    put_u64(header + 32, records_offset);
+    put_u64(header + 40, by_length_offset);
+    put_u64(header + 48, lines_offset);
+    put_u64(header + 56, lines_size);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint64_t line_offset = 0;
+    for (uint32_t i = 0; i < builder->deal_count && ok; i++) {
+        const DealDbBuilderRecord* source = &builder->records[i];
+        uint8_t record[DEAL_DB_RECORD_SIZE] = { 0 };
+        record[0] = source->status;
+        put_u16(record + 2, source->length);
+        put_u32(record + 4, source->nodes);
+        put_u64(record + 8, source->line ? line_offset : UINT64_MAX);
+        line_offset += source->line_bytes;
+        ok = fwrite(record, 1, sizeof(record), file) == sizeof(record);
+    }
+    for (uint32_t i = 0; i < won_count && ok; i++) {
+        uint8_t index[4];
+        put_u32(index, by_length[i]);
+        ok = fwrite(index, 1, sizeof(index), file) == sizeof(index);
+    }
+    for (uint32_t i = 0; i < builder->deal_count && ok; i++) {
+        const DealDbBuilderRecord* source = &builder->records[i];
+        if (source->line_bytes > 0) {
+            ok = fwrite(source->line, 1, source->line_bytes, file) == source->line_bytes;
+        }
+    }
+    free(by_length);
+    return fclose(file) == 0 && ok;
+}
+
+void deal_db_builder_free(DealDbBuilder* builder) {
+    if (builder->records) {
+        for (uint32_t i = 0; i < builder->deal_count; i++) {
+            free(builder->records[i].line);
+        }
+        free(builder->records);
+    }
+    memset(builder, 0, sizeof(*builder));
+}
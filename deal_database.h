@@ -0,0 +1,92 @@
+#ifndef DEAL_DATABASE_H
+#define DEAL_DATABASE_H
+
+// Precomputed deal results, built offline by yukon_deals and memory mapped for lookups.
+//
+// File:    64 byte header | deal records | won deals sorted by line length | solution lines
+// Header:  "YKDB" | format (u16) | rules version (u16) | first deal (u32) | deal count (u32)
+//          | won count (u32) | reserved (u32) | node limit (u64) | section offsets (4 x u64)
+// Record:  status (u8) | reserved (u8) | line length (u16) | nodes searched (u32) | line offset (u64)
+// All integers are little endian. Lines use the replay move packing (1-2 bytes per move).
+//
+// Looking up a deal is one multiplication away from its record, so no parsing is needed
+// when a front end opens the file.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+#include "platform.h"
+#include "solver.h"
+
+#define DEAL_DB_FORMAT_VERSION 1
+#define DEAL_DB_HEADER_SIZE 64
+#define DEAL_DB_RECORD_SIZE 16
+
+typedef enum {
+    DealAnyWinnable,
+    DealEasy,   // Shortest third of the winnable deals
+    DealMedium,
+    DealHard    // Longest third
+} DealDifficulty;
+
+typedef struct DealInfo {
+    uint32_t deal_number;
+    SolveStatus status;
+    uint32_t length;       // Moves in the solution line
+    uint32_t nodes;        // Positions searched, saturates at UINT32_MAX
+    const uint8_t* line;   // Packed moves, points into the mapped file
+} DealInfo;
+
+typedef struct DealDatabase {
+    PlatformMappedFile file;
+    uint32_t first_deal;
+    uint32_t deal_count;
+    uint32_t won_count;
+    uint16_t rules_version;
+    uint64_t node_limit;   // Budget per deal, deals marked unknown ran out of it
+    const uint8_t* records;
+    const uint8_t* by_length;
+    const uint8_t* lines;
+    uint64_t lines_size;
+} DealDatabase;
+
+bool deal_db_open(DealDatabase* db, const char* path);
+void deal_db_close(DealDatabase* db);
+
+bool deal_db_lookup(const DealDatabase* db, uint32_t deal_number, DealInfo* info);
+// rank 0 is the winnable deal with the shortest solution
+bool deal_db_won_by_rank(const DealDatabase* db, uint32_t rank, DealInfo* info);
+bool deal_db_pick(const DealDatabase* db, DealDifficulty difficulty, uint64_t* rng, uint32_t* deal_number);
+
+// Decodes up to max_moves moves of the line, returns the number decoded
+uint32_t deal_db_line(const DealDatabase* db, const DealInfo* info, Move* moves, uint32_t max_moves);
+
+bool deal_difficulty_from_string(const char* text, DealDifficulty* difficulty);
+
+// Opens the file, picks a deal and closes it again, for the front ends
+bool deal_db_choose(const char* path, DealDifficulty difficulty, uint64_t seed, uint32_t* deal_number);
+
+// Building a database: results can be added from several threads as long as each deal
+// is only added once.
+typedef struct DealDbBuilderRecord {
+    uint8_t status;
+    uint16_t length;
+    uint32_t nodes;
+    uint8_t* line;
+    uint32_t line_bytes;
+} DealDbBuilderRecord;
+
+typedef struct DealDbBuilder {
+    uint32_t first_deal;
+    uint32_t deal_count;
+    uint64_t node_limit;
+    DealDbBuilderRecord* records;
+} DealDbBuilder;
+
+bool deal_db_builder_init(DealDbBuilder* builder, uint32_t first_deal, uint32_t deal_count, uint64_t node_limit);
+bool deal_db_builder_add(DealDbBuilder* builder, uint32_t deal_number, const SolveResult* result);
+bool deal_db_builder_write(const DealDbBuilder* builder, const char* path);
+void deal_db_builder_free(DealDbBuilder* builder);
+
+#endif
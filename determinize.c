@@ -0,0 +1,220 @@
+#include "determinize.h"
+#include "solver.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+void determinize_sample(const GameState* observed, uint64_t* rng, GameState* out) {
+    bool known[YUKON_CARDS] = { false };
+    uint8_t unknown[YUKON_CARDS];
+    int unknown_count = 0;
+
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        for (int rank = 0; rank < observed->foundation[suit]; rank++) {
+            known[suit * YUKON_RANKS + rank] = true;
+        }
+    }
+    for (int column = 0, start = 0; column < YUKON_COLUMNS; column++) {
+        for (int i = observed->hidden_count[column]; i < observed->column_length[column]; i++) {
+            known[observed->cards[start + i]] = true;
+        }
+        start += observed->column_length[column];
+    }
+    for (int card = 0; card < YUKON_CARDS; card++) {
+        if (!known[card]) {
+            unknown[unknown_count++] = (uint8_t)card;
+        }
+    }
+    for (int i = unknown_count - 1; i > 0; i--) {
+        int swap = (int)rng_below(rng, (uint32_t)i + 1);
+        uint8_t temp = unknown[i];
+        unknown[i] = unknown[swap];
+        unknown[swap] = temp;
+    }
+
+    *out = *observed;
+    int next = 0;
+    for (int column = 0, start = 0; column < YUKON_COLUMNS; column++) {
+        for (int i = 0; i < observed->hidden_count[column] && next < unknown_count; i++) {
+            out->cards[start + i] = unknown[next++];
+        }
+        start += observed->column_length[column];
+    }
+    state_rehash(out);
+}
+
+typedef struct FairWorker {
+    struct FairHinter* hinter;
+    Solver* solver;
+    SolveResult* result;
+} FairWorker;
+
+struct FairHinter {
+    FairHintConfig config;
+    int thread_count;
+    FairWorker* workers;
+    uint64_t run;                      // Varies the samples from one hint to the next
+
+    // State of the current run
+    GameState observed;
+    Move moves[YUKON_MAX_MOVES];
+    int move_count;
+    _Atomic int next_sample;
+    _Atomic uint32_t score[YUKON_MAX_MOVES]; // Two points per win, one per unknown
+    _Atomic uint32_t samples_done;
+    _Atomic uint64_t nodes;
+};
+
+void fair_hint_default_config(FairHintConfig* config) {
+    config->samples = 16;
+    config->threads = 0;
+    config->node_limit = 5000;
+    config->tt_mb = 4;
+    config->seed = 0x4641495248494E54ull; // "FAIRHINT"
+    config->stop = NULL;
+    config->tablebase = NULL;
+}
+
+FairHinter* fair_hinter_create(const FairHintConfig* config) {
+    FairHinter* hinter = (FairHinter*)calloc(1, sizeof(FairHinter));
+    if (hinter == NULL) {
+        return NULL;
+    }
+    hinter->config = *config;
+    hinter->thread_count = config->threads > 0 ? config->threads : platform_cpu_count();
+    if (hinter->thread_count > FAIR_HINT_MAX_THREADS) {
+        hinter->thread_count = FAIR_HINT_MAX_THREADS;
+    }
+    hinter->workers = (FairWorker*)calloc((size_t)hinter->thread_count, sizeof(FairWorker));
+    if (hinter->workers == NULL) {
+        free(hinter);
+        return NULL;
+    }
+
+    SolverConfig solver_config;
+    solver_default_config(&solver_config);
+    solver_config.node_limit = config->node_limit;
+    solver_config.tt_mb = config->tt_mb;
+    solver_config.stop = config->stop;
+    solver_config.tablebase = config->tablebase;
+    for (int i = 0; i < hinter->thread_count; i++) {
+        FairWorker* worker = &hinter->workers[i];
+        worker->hinter = hinter;
+        worker->solver = solver_create(&solver_config);
+        worker->result = (SolveResult*)malloc(sizeof(SolveResult));
+        if (worker->solver == NULL || worker->result == NULL) {
+            fair_hinter_destroy(hinter);
+            return NULL;
+        }
+    }
+    return hinter;
+}
+
+void fair_hinter_destroy(FairHinter* hinter) {
+    if (hinter == NULL) {
+        return;
+    }
+    for (int i = 0; i < hinter->thread_count; i++) {
+        solver_destroy(hinter->workers[i].solver);
+        free(hinter->workers[i].result);
+    }
+    free(hinter->workers);
+    free(hinter);
+}
+
+static bool stopped(const FairHinter* hinter) {
+    return hinter->config.stop && atomic_load_explicit(hinter->config.stop, memory_order_relaxed);
+}
+
+static void fair_worker(void* argument) {
+    FairWorker* worker = (FairWorker*)argument;
+    FairHinter* hinter = worker->hinter;
+    bool own_thread = worker != &hinter->workers[0];
+    if (own_thread) {
+        trace_thread_name("fair hint worker");
+    }
+
+    for (;;) {
+        int sample = atomic_fetch_add(&hinter->next_sample, 1);
+        if (sample >= hinter->config.samples || stopped(hinter)) {
+            break;
+        }
+        uint64_t trace_start = trace_begin();
+        uint64_t rng = hinter->config.seed ^ (hinter->run << 32) ^ ((uint64_t)sample * 0x9E3779B97F4A7C15ull);
+        GameState world;
+        determinize_sample(&hinter->observed, &rng, &world);
+
+        // The legal moves only depend on face up cards, so they are the same in every sample
+        for (int i = 0; i < hinter->move_count; i++) {
+            GameState after = world;
+            state_apply_move(&after, hinter->moves[i]);
+            SolveStatus status = solver_solve(worker->solver, &after, worker->result);
+            atomic_fetch_add(&hinter->nodes, worker->result->nodes);
+            if (status == SolveWon) {
+                atomic_fetch_add(&hinter->score[i], 2);
+            }
+            else if (status == SolveUnknown) {
+                atomic_fetch_add(&hinter->score[i], 1);
+            }
+        }
+        if (!stopped(hinter)) {
+            atomic_fetch_add(&hinter->samples_done, 1);
+        }
+        trace_end_value("fair sample", "hint", trace_start, sample);
+    }
+    if (own_thread) {
+        trace_thread_release();
+    }
+}
+
+bool fair_hinter_run(FairHinter* hinter, const GameState* observed, FairHint* hint) {
+    memset(hint, 0, sizeof(*hint));
+    hinter->observed = *observed;
+    hinter->run++;
+    hinter->move_count = solver_ordered_moves(observed, hinter->moves);
+    atomic_store(&hinter->next_sample, 0);
+    atomic_store(&hinter->samples_done, 0);
+    atomic_store(&hinter->nodes, 0);
+    for (int i = 0; i < hinter->move_count; i++) {
+        atomic_store(&hinter->score[i], 0);
+    }
+    if (hinter->move_count == 0) {
+        return true;
+    }
+
+    // Workers 1.. run on their own threads, worker 0 on this one
+    PlatformThread threads[FAIR_HINT_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < hinter->thread_count; i++) {
+        if (platform_thread_start(&threads[started], fair_worker, &hinter->workers[i])) {
+            started++;
+        }
+    }
+    fair_worker(&hinter->workers[0]);
+    for (int i = 0; i < started; i++) {
+        platform_thread_join(&threads[i]);
+    }
+    if (stopped(hinter)) {
+        return false;
+    }
+
+    uint32_t samples = atomic_load(&hinter->samples_done);
+    hint->samples = samples;
+    hint->nodes = atomic_load(&hinter->nodes);
+    hint->move_count = hinter->move_count;
+    hint->move = hinter->moves[0];
+    uint32_t best = 0;
+    for (int i = 0; i < hinter->move_count; i++) {
+        uint32_t score = atomic_load(&hinter->score[i]);
+        hint->moves[i] = hinter->moves[i];
+        hint->move_win_rate[i] = samples ? (float)score / (2.0f * (float)samples) : 0.0f;
+        // Ties keep the solver's move order
+        if (score > best) {
+            best = score;
+            hint->move = hinter->moves[i];
+        }
+    }
+    hint->win_rate = samples ? (float)best / (2.0f * (float)samples) : 0.0f;
+    return true;
+}
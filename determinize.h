@@ -0,0 +1,54 @@
+#ifndef DETERMINIZE_H
+#define DETERMINIZE_H
+
+// Fair hints for positions with face down cards.
+//
+// A player only knows the face up cards, so the hidden ones could be any arrangement of
+// the cards that are not visible. determinize_sample deals such an arrangement from the
+// visible information alone. The fair hinter solves every legal move on many samples in
+// parallel and picks the move that wins in the most of them, so the hint never depends
+// on where the hidden cards really are.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "game_state.h"
+#include "tablebase.h"
+
+// Replaces the hidden cards of observed by a random arrangement of the cards that are
+// neither face up nor on a foundation. The real hidden cards are never read.
+void determinize_sample(const GameState* observed, uint64_t* rng, GameState* out);
+
+#define FAIR_HINT_MAX_THREADS 64
+
+typedef struct FairHintConfig {
+    int samples;           // Arrangements of the hidden cards per hint
+    int threads;           // Worker threads, 0 for one per core
+    uint64_t node_limit;   // Per move and sample
+    size_t tt_mb;          // Per worker
+    uint64_t seed;
+    _Atomic bool* stop;    // Optional, cancels the run
+    const Tablebase* tablebase; // Optional, shared by the workers' solvers
+} FairHintConfig;
+
+typedef struct FairHint {
+    Move move;             // Best move, MOVE_NONE if there is no legal move
+    float win_rate;        // Share of samples the best move wins (unknown counts half)
+    int move_count;
+    Move moves[YUKON_MAX_MOVES];
+    float move_win_rate[YUKON_MAX_MOVES];
+    uint32_t samples;
+    uint64_t nodes;
+} FairHint;
+
+typedef struct FairHinter FairHinter;
+
+void fair_hint_default_config(FairHintConfig* config);
+FairHinter* fair_hinter_create(const FairHintConfig* config);
+void fair_hinter_destroy(FairHinter* hinter);
+
+// Returns false if the run was cancelled
+bool fair_hinter_run(FairHinter* hinter, const GameState* observed, FairHint* hint);
+
+#endif
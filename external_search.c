@@ -0,0 +1,645 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "external_search.h"
+#include "deadlock.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD EXTERNAL_RECORD_BYTES
+#define IO_BUFFER (1 << 20)   // Per open file, so reads and writes go to the disk in big blocks
+#define FAN_IN 32             // Runs merged at once, and earlier layers checked at once
+#define MAX_PATH_LENGTH 1024
+
+// Every layer and run file: this header, then the records front coded, each as the number
+// of leading bytes it shares with the record before and the rest of its bytes
+typedef struct RunHeader {
+    char magic[4];            // "YKXR"
+    uint32_t record_bytes;
+    uint64_t count;
+} RunHeader;
+
+typedef struct RunWriter {
+    FILE* file;
+    uint8_t last[RECORD];
+    uint64_t count;
+} RunWriter;
+
+typedef struct RunReader {
+    FILE* file;
+    uint8_t record[RECORD];
+    uint64_t left;
+    bool valid;               // record holds the current record
+} RunReader;
+
+typedef struct Search {
+    const ExternalSearchConfig* config;
+    ExternalSearchStats* stats;
+    uint8_t* buffer;          // Successors of the layer being expanded, not sorted yet
+    size_t capacity;          // In records
+    size_t used;
+    uint64_t buffered;        // Successors put in the buffer over the whole search
+    char** runs;
+    int run_count;
+    int run_capacity;
+    uint32_t next_file;
+} Search;
+
+// Columns compare by length, then hidden count, then cards, which gives the canonical order
+static int compare_columns(const GameState* state, const int start[YUKON_COLUMNS], int a, int b) {
+    if (state->column_length[a] != state->column_length[b]) {
+        return state->column_length[a] < state->column_length[b] ? -1 : 1;
+    }
+    if (state->hidden_count[a] != state->hidden_count[b]) {
+        return state->hidden_count[a] < state->hidden_count[b] ? -1 : 1;
+    }
+    return memcmp(state->cards + start[a], state->cards + start[b], state->column_length[a]);
+}
+
+bool external_pack(const GameState* state, uint8_t out[EXTERNAL_RECORD_BYTES]) {
+    int start[YUKON_COLUMNS];
+    int order[YUKON_COLUMNS];
+    int position = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        start[column] = position;
+        position += state->column_length[column];
+        order[column] = column;
+    }
+    for (int i = 1; i < YUKON_COLUMNS; i++) {
+        int column = order[i];
+        int j = i;
+        while (j > 0 && compare_columns(state, start, order[j - 1], column) > 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = column;
+    }
+
+    GameState canonical;
+    int used = 0;
+    for (int i = 0; i < YUKON_COLUMNS; i++) {
+        int column = order[i];
+        canonical.hidden_count[i] = state->hidden_count[column];
+        canonical.column_length[i] = state->column_length[column];
+        memcpy(canonical.cards + used, state->cards + start[column], state->column_length[column]);
+        used += state->column_length[column];
+    }
+    memcpy(canonical.foundation, state->foundation, sizeof(canonical.foundation));
+    PackedState packed;
+    if (!packed_state_encode(&canonical, &packed)) {
+        return false;
+    }
+    memcpy(out, packed.bytes, EXTERNAL_RECORD_BYTES);
+    return true;
+}
+
+bool external_unpack(const uint8_t record[EXTERNAL_RECORD_BYTES], GameState* state) {
+    PackedState packed;
+    memcpy(packed.bytes, record, EXTERNAL_RECORD_BYTES);
+    return packed_state_decode(&packed, state);
+}
+
+void external_search_default_config(ExternalSearchConfig* config) {
+    config->directory = ".";
+    config->memory_mb = 256;
+    config->state_limit = 0;
+    config->pruning = true;
+    config->keep_files = false;
+    config->stop = NULL;
+    config->on_layer = NULL;
+    config->context = NULL;
+}
+
+static void layer_path(const Search* search, uint32_t layer, char path[MAX_PATH_LENGTH]) {
+    snprintf(path, MAX_PATH_LENGTH, "%s/layer_%03u.ykx", search->config->directory, layer);
+}
+
+static char* new_file_path(Search* search) {
+    char* path = (char*)malloc(MAX_PATH_LENGTH);
+    if (path) {
+        snprintf(path, MAX_PATH_LENGTH, "%s/run_%06u.ykx", search->config->directory, search->next_file++);
+    }
+    return path;
+}
+
+static bool writer_open(Search* search, RunWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        search->stats->failed = true;
+        return false;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, IO_BUFFER);
+    RunHeader header = { { 'Y', 'K', 'X', 'R' }, RECORD, 0 };
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        search->stats->failed = true;
+    }
+    return true;
+}
+
+static void writer_put(Search* search, RunWriter* writer, const uint8_t* record) {
+    int shared = 0;
+    if (writer->count > 0) {
+        while (shared < RECORD && record[shared] == writer->last[shared]) {
+            shared++;
+        }
+    }
+    uint8_t prefix = (uint8_t)shared;
+    if (fwrite(&prefix, 1, 1, writer->file) != 1 ||
+        fwrite(record + shared, 1, (size_t)(RECORD - shared), writer->file) != (size_t)(RECORD - shared)) {
+        search->stats->failed = true;
+    }
+    memcpy(writer->last, record, RECORD);
+    writer->count++;
+    search->stats->bytes_written += 1 + (uint64_t)(RECORD - shared);
+    search->stats->record_bytes += RECORD;
+}
+
+// The count goes in the header once it is known
+static void writer_close(Search* search, RunWriter* writer) {
+    RunHeader header = { { 'Y', 'K', 'X', 'R' }, RECORD, writer->count };
+    if (!platform_seek(writer->file, 0) || fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        search->stats->failed = true;
+    }
+    if (fclose(writer->file) != 0) {
+        search->stats->failed = true;
+    }
+    search->stats->bytes_written += sizeof(header);
+    writer->file = NULL;
+}
+
+static void reader_next(Search* search, RunReader* reader) {
+    if (reader->left == 0) {
+        reader->valid = false;
+        return;
+    }
+    uint8_t prefix;
+    if (fread(&prefix, 1, 1, reader->file) != 1 || prefix > RECORD ||
+        fread(reader->record + prefix, 1, (size_t)(RECORD - prefix), reader->file) != (size_t)(RECORD - prefix)) {
+        search->stats->failed = true;
+        reader->valid = false;
+        return;
+    }
+    search->stats->bytes_read += 1 + (uint64_t)(RECORD - prefix);
+    reader->left--;
+    reader->valid = true;
+}
+
+static bool reader_open(Search* search, RunReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file != NULL) {
+        setvbuf(reader->file, NULL, _IOFBF, IO_BUFFER);
+    }
+    RunHeader header;
+    if (reader->file == NULL || fread(&header, sizeof(header), 1, reader->file) != 1 ||
+        memcmp(header.magic, "YKXR", 4) != 0 || header.record_bytes != RECORD) {
+        if (reader->file) {
+            fclose(reader->file);
+            reader->file = NULL;
+        }
+        search->stats->failed = true;
+        return false;
+    }
+    search->stats->bytes_read += sizeof(header);
+    reader->left = header.count;
+    reader_next(search, reader);
+    return true;
+}
+
+static void reader_close(RunReader* reader) {
+    if (reader->file) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+static int compare_records(const void* a, const void* b) {
+    return memcmp(a, b, RECORD);
+}
+
+// Sorts the buffer, drops its duplicates and writes it out as a run
+static void flush_run(Search* search) {
+    if (search->used == 0) {
+        return;
+    }
+    uint64_t trace_start = trace_begin();
+    qsort(search->buffer, search->used, RECORD, compare_records);
+    if (search->run_count == search->run_capacity) {
+        int capacity = search->run_capacity ? search->run_capacity * 2 : 64;
+        char** runs = (char**)realloc(search->runs, sizeof(char*) * (size_t)capacity);
+        if (runs == NULL) {
+            search->stats->failed = true;
+            return;
+        }
+        search->runs = runs;
+        search->run_capacity = capacity;
+    }
+    char* path = new_file_path(search);
+    RunWriter writer;
+    if (path == NULL || !writer_open(search, &writer, path)) {
+        search->stats->failed = true;
+        free(path);
+        return;
+    }
+    for (size_t i = 0; i < search->used; i++) {
+        const uint8_t* record = search->buffer + i * RECORD;
+        if (i > 0 && memcmp(record, record - RECORD, RECORD) == 0) {
+            search->stats->run_duplicates++;
+            continue;
+        }
+        writer_put(search, &writer, record);
+    }
+    writer_close(search, &writer);
+    search->runs[search->run_count++] = path;
+    search->stats->runs++;
+    search->used = 0;
+    trace_end_value("write run", "external", trace_start, (int64_t)writer.count);
+}
+
+// Min-heap of reader indices ordered by their current record
+static void heap_down(RunReader* readers, int* heap, int size, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && memcmp(readers[heap[left]].record, readers[heap[smallest]].record, RECORD) < 0) {
+            smallest = left;
+        }
+        if (right < size && memcmp(readers[heap[right]].record, readers[heap[smallest]].record, RECORD) < 0) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        int swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// Writes the sorted union of inputs to output, each record once, leaving out the records of
+// the subtract files. Every file is read once, front to back.
+static uint64_t merge(Search* search, char** inputs, int input_count, char** subtract, int subtract_count,
+                      const char* output) {
+    RunReader readers[FAN_IN];
+    RunReader removed[FAN_IN];
+    int heap[FAN_IN];
+    int size = 0;
+    for (int i = 0; i < input_count; i++) {
+        if (reader_open(search, &readers[i], inputs[i]) && readers[i].valid) {
+            heap[size++] = i;
+        }
+    }
+    for (int i = 0; i < subtract_count; i++) {
+        reader_open(search, &removed[i], subtract[i]);
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        heap_down(readers, heap, size, i);
+    }
+
+    RunWriter writer;
+    bool open = writer_open(search, &writer, output);
+    uint8_t candidate[RECORD];
+    while (size > 0 && open && !search->stats->failed) {
+        memcpy(candidate, readers[heap[0]].record, RECORD);
+        // Take the candidate off every input that holds it
+        while (size > 0 && memcmp(readers[heap[0]].record, candidate, RECORD) == 0) {
+            RunReader* reader = &readers[heap[0]];
+            reader_next(search, reader);
+            if (!reader->valid) {
+                heap[0] = heap[--size];
+            }
+            heap_down(readers, heap, size, 0);
+        }
+        bool known = false;
+        for (int i = 0; i < subtract_count; i++) {
+            RunReader* reader = &removed[i];
+            while (reader->valid && memcmp(reader->record, candidate, RECORD) < 0) {
+                reader_next(search, reader);
+            }
+            known = known || (reader->valid && memcmp(reader->record, candidate, RECORD) == 0);
+        }
+        if (!known) {
+            writer_put(search, &writer, candidate);
+        }
+    }
+    uint64_t count = writer.count;
+    if (open) {
+        writer_close(search, &writer);
+    }
+    for (int i = 0; i < input_count; i++) {
+        reader_close(&readers[i]);
+    }
+    for (int i = 0; i < subtract_count; i++) {
+        reader_close(&removed[i]);
+    }
+    return count;
+}
+
+static void remove_runs(Search* search) {
+    for (int i = 0; i < search->run_count; i++) {
+        remove(search->runs[i]);
+        free(search->runs[i]);
+    }
+    search->run_count = 0;
+}
+
+// Merges the runs into layer `layer`, without the positions of any earlier layer: first
+// the runs FAN_IN at a time until FAN_IN are left, then those together with the latest
+// layers, where most repeats are, then the result against older layers in groups.
+static uint64_t merge_layer(Search* search, uint32_t layer) {
+    uint64_t trace_start = trace_begin();
+    while (search->run_count > FAN_IN && !search->stats->failed) {
+        char* merged = new_file_path(search);
+        if (merged == NULL) {
+            search->stats->failed = true;
+            break;
+        }
+        merge(search, search->runs, FAN_IN, NULL, 0, merged);
+        for (int i = 0; i < FAN_IN; i++) {
+            remove(search->runs[i]);
+            free(search->runs[i]);
+        }
+        memmove(search->runs, search->runs + FAN_IN, sizeof(char*) * (size_t)(search->run_count - FAN_IN));
+        search->run_count -= FAN_IN;
+        search->runs[search->run_count++] = merged;
+    }
+
+    char* earlier[FAN_IN];
+    char* current = NULL;
+    uint64_t count = 0;
+    for (int32_t newest = (int32_t)layer - 1; newest >= 0 && !search->stats->failed; newest -= FAN_IN) {
+        int group = 0;
+        for (int32_t l = newest; l >= 0 && group < FAN_IN; l--) {
+            earlier[group] = (char*)malloc(MAX_PATH_LENGTH);
+            if (earlier[group] == NULL) {
+                search->stats->failed = true;
+                break;
+            }
+            layer_path(search, (uint32_t)l, earlier[group++]);
+        }
+        char* output = new_file_path(search);
+        if (output == NULL) {
+            search->stats->failed = true;
+        }
+        else if (current == NULL) {
+            count = merge(search, search->runs, search->run_count, earlier, group, output);
+            remove_runs(search);
+        }
+        else {
+            count = merge(search, &current, 1, earlier, group, output);
+            remove(current);
+            free(current);
+        }
+        current = output;
+        for (int i = 0; i < group; i++) {
+            free(earlier[i]);
+        }
+    }
+    if (current != NULL) {
+        char path[MAX_PATH_LENGTH];
+        layer_path(search, layer, path);
+        if (!search->stats->failed && !platform_replace_file(current, path)) {
+            search->stats->failed = true;
+        }
+        free(current);
+    }
+    trace_end_value("merge layer", "external", trace_start, (int64_t)count);
+    return count;
+}
+
+static bool stopped(const Search* search) {
+    return search->config->stop && atomic_load_explicit(search->config->stop, memory_order_relaxed);
+}
+
+static int successors(const Search* search, const GameState* state, Move moves[YUKON_MAX_MOVES]) {
+    return search->config->pruning ? solver_ordered_moves(state, moves) : state_generate_moves(state, moves);
+}
+
+// Streams a layer into runs of its successors. Returns true when a successor is won, with
+// the position it was reached from in parent.
+static bool expand_layer(Search* search, uint32_t layer, uint8_t parent[RECORD]) {
+    uint64_t trace_start = trace_begin();
+    char path[MAX_PATH_LENGTH];
+    layer_path(search, layer, path);
+    RunReader reader;
+    if (!reader_open(search, &reader, path)) {
+        return false;
+    }
+    bool won = false;
+    for (uint64_t n = 0; reader.valid && !won && !search->stats->failed; n++) {
+        if ((n & 4095) == 0 && stopped(search)) {
+            break;
+        }
+        GameState state;
+        if (!external_unpack(reader.record, &state)) {
+            search->stats->failed = true;
+            break;
+        }
+        Move moves[YUKON_MAX_MOVES];
+        int count = successors(search, &state, moves);
+        for (int i = 0; i < count; i++) {
+            Move applied = state_apply_move(&state, moves[i]);
+            search->stats->generated++;
+            if (state_is_won(&state)) {
+                memcpy(parent, reader.record, RECORD);
+                won = true;
+                break;
+            }
+            if (!search->config->pruning || !deadlock_find(&state, NULL)) {
+                if (search->used == search->capacity) {
+                    flush_run(search);
+                }
+                external_pack(&state, search->buffer + search->used++ * RECORD);
+                search->buffered++;
+            }
+            state_undo_move(&state, applied);
+        }
+        reader_next(search, &reader);
+    }
+    reader_close(&reader);
+    if (!won) {
+        flush_run(search);
+    }
+    trace_end_value("expand layer", "external", trace_start, (int64_t)layer);
+    return won;
+}
+
+// Walks back from the position a win was found from, one scan per layer: in every layer
+// some position has a move to the one found in the layer after. Then replays the line from
+// start, picking the move that reaches each position, as start has its own column order.
+static bool rebuild_line(Search* search, const GameState* start, uint32_t last, const uint8_t parent[RECORD],
+                         SolveResult* result) {
+    uint8_t* chain = (uint8_t*)malloc((size_t)(last + 1) * RECORD);
+    if (chain == NULL) {
+        return false;
+    }
+    memcpy(chain + (size_t)last * RECORD, parent, RECORD);
+    for (int32_t layer = (int32_t)last - 1; layer >= 0; layer--) {
+        char path[MAX_PATH_LENGTH];
+        layer_path(search, (uint32_t)layer, path);
+        RunReader reader;
+        bool found = false;
+        if (!reader_open(search, &reader, path)) {
+            break;
+        }
+        while (reader.valid && !found) {
+            GameState state;
+            if (!external_unpack(reader.record, &state)) {
+                break;
+            }
+            Move moves[YUKON_MAX_MOVES];
+            int count = successors(search, &state, moves);
+            for (int i = 0; i < count && !found; i++) {
+                Move applied = state_apply_move(&state, moves[i]);
+                uint8_t record[RECORD];
+                external_pack(&state, record);
+                if (memcmp(record, chain + (size_t)(layer + 1) * RECORD, RECORD) == 0) {
+                    memcpy(chain + (size_t)layer * RECORD, reader.record, RECORD);
+                    found = true;
+                }
+                state_undo_move(&state, applied);
+            }
+            reader_next(search, &reader);
+        }
+        reader_close(&reader);
+        if (!found) {
+            free(chain);
+            return false;
+        }
+    }
+
+    GameState state = *start;
+    result->length = 0;
+    for (uint32_t step = 1; step <= last + 1; step++) {
+        Move moves[YUKON_MAX_MOVES];
+        int count = state_generate_moves(&state, moves);
+        bool found = false;
+        for (int i = 0; i < count && !found; i++) {
+            Move applied = state_apply_move(&state, moves[i]);
+            uint8_t record[RECORD];
+            if (step <= last) {
+                external_pack(&state, record);
+                found = memcmp(record, chain + (size_t)step * RECORD, RECORD) == 0;
+            }
+            else {
+                found = state_is_won(&state);
+            }
+            if (found) {
+                result->line[result->length++] = applied;
+            }
+            else {
+                state_undo_move(&state, applied);
+            }
+        }
+        if (!found) {
+            free(chain);
+            return false;
+        }
+    }
+    free(chain);
+    return true;
+}
+
+static void remove_layers(Search* search, uint32_t count) {
+    char path[MAX_PATH_LENGTH];
+    for (uint32_t layer = 0; layer < count; layer++) {
+        layer_path(search, layer, path);
+        remove(path);
+    }
+}
+
+SolveStatus external_search(const ExternalSearchConfig* config, const GameState* start, SolveResult* result,
+                            ExternalSearchStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    result->status = SolveUnknown;
+    result->nodes = 0;
+    result->length = 0;
+    if (state_is_won(start)) {
+        result->status = SolveWon;
+        return SolveWon;
+    }
+
+    // Positions from a deal always pack, and moves never add face down cards
+    uint8_t record[RECORD];
+    if (!external_pack(start, record)) {
+        stats->failed = true;
+        return SolveUnknown;
+    }
+
+    Search search;
+    memset(&search, 0, sizeof(search));
+    search.config = config;
+    search.stats = stats;
+    search.capacity = (config->memory_mb << 20) / RECORD;
+    search.buffer = (uint8_t*)malloc(search.capacity * RECORD);
+    if (search.buffer == NULL || search.capacity == 0) {
+        free(search.buffer);
+        stats->failed = true;
+        return SolveUnknown;
+    }
+
+    // Layer 0 is the start position alone
+    char path[MAX_PATH_LENGTH];
+    layer_path(&search, 0, path);
+    RunWriter writer;
+    if (writer_open(&search, &writer, path)) {
+        writer_put(&search, &writer, record);
+        writer_close(&search, &writer);
+    }
+    stats->layers = 1;
+    stats->states = 1;
+    stats->last_layer = 1;
+
+    SolveStatus status = SolveUnknown;
+    while (!stats->failed && !stopped(&search)) {
+        uint32_t layer = stats->layers - 1;
+        if (layer + 1 >= SOLVER_MAX_LINE) {
+            break;
+        }
+        uint8_t parent[RECORD];
+        if (expand_layer(&search, layer, parent)) {
+            if (rebuild_line(&search, start, layer, parent, result)) {
+                status = SolveWon;
+            }
+            else {
+                stats->failed = true;
+            }
+            break;
+        }
+        if (stats->failed || stopped(&search)) {
+            break;
+        }
+        uint64_t count = merge_layer(&search, layer + 1);
+        if (stats->failed) {
+            break;
+        }
+        stats->layers++;
+        stats->states += count;
+        stats->last_layer = count;
+        stats->merge_duplicates = search.buffered - stats->run_duplicates - (stats->states - 1);
+        if (config->on_layer) {
+            config->on_layer(stats, config->context);
+        }
+        if (count == 0) {
+            status = SolveUnsolvable;
+            break;
+        }
+        if (config->state_limit != 0 && stats->states >= config->state_limit) {
+            break;
+        }
+    }
+
+    remove_runs(&search);
+    free(search.runs);
+    free(search.buffer);
+    if (!config->keep_files) {
+        remove_layers(&search, stats->layers + 1);
+    }
+    result->status = status;
+    result->nodes = stats->generated;
+    return status;
+}
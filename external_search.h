@@ -0,0 +1,67 @@
+#ifndef EXTERNAL_SEARCH_H
+#define EXTERNAL_SEARCH_H
+
+// Breadth first search with the visited set on disk, for exhaustive analysis of deals whose
+// positions do not fit in memory.
+//
+// Every layer (the positions first reached after n moves) is a file of packed positions
+// (packed_state.h), sorted and front coded: each record only stores the bytes that differ from the one before.
+// Columns are packed in a canonical order, so positions that only differ by the order of
+// their columns are one record. Expanding a layer streams it and collects the successors in
+// a memory buffer; whenever that fills, it is sorted, its duplicates dropped and written out
+// as a run. Duplicate detection is delayed until the layer is complete: one streaming merge
+// of the runs drops what repeats between them and what is in any earlier layer, and what is
+// left becomes the next layer. All of it is large sequential reads and writes.
+//
+// A won position ends the search with a shortest line, rebuilt by one scan of every layer
+// from the last back to the first. A layer coming out empty proves the deal unsolvable.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "game_state.h"
+#include "solver.h"
+#include "packed_state.h"
+
+// A PackedState of the position with its columns in canonical order
+#define EXTERNAL_RECORD_BYTES PACKED_STATE_BYTES
+
+typedef struct ExternalSearchStats {
+    uint32_t layers;            // Complete layers, the start position's included
+    uint64_t states;            // Distinct positions over all layers
+    uint64_t last_layer;        // Positions in the last layer
+    uint64_t generated;         // Successors, duplicates included
+    uint64_t run_duplicates;    // Dropped while sorting a run
+    uint64_t merge_duplicates;  // Dropped while merging, already in another run or an earlier layer
+    uint32_t runs;
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint64_t record_bytes;      // Records written times EXTERNAL_RECORD_BYTES, before front coding
+    bool failed;                // A file could not be written or read
+} ExternalSearchStats;
+
+typedef void (*ExternalLayerFunction)(const ExternalSearchStats* stats, void* context);
+
+typedef struct ExternalSearchConfig {
+    const char* directory;      // Layer and run files go here, it must exist
+    size_t memory_mb;           // Sort buffer, one run per time it fills
+    uint64_t state_limit;       // Gives up with SolveUnknown past this many positions, 0 for none
+    bool pruning;               // Safe foundation moves alone and no dead positions, as in the solver
+    bool keep_files;            // Leave the layer files behind
+    _Atomic bool* stop;         // Optional, checked between runs
+    ExternalLayerFunction on_layer; // Optional, called after every layer
+    void* context;
+} ExternalSearchConfig;
+
+void external_search_default_config(ExternalSearchConfig* config);
+
+SolveStatus external_search(const ExternalSearchConfig* config, const GameState* start, SolveResult* result,
+                            ExternalSearchStats* stats);
+
+// Packs state with its columns in canonical order; equal records are the same position up
+// to the order of the columns. Both return false where packed_state_encode/decode do.
+bool external_pack(const GameState* state, uint8_t out[EXTERNAL_RECORD_BYTES]);
+bool external_unpack(const uint8_t record[EXTERNAL_RECORD_BYTES], GameState* state);
+
+#endif
@@ -0,0 +1,128 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "frame_profiler.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool frame_profiler_init(FrameProfiler* profiler) {
+    memset(profiler, 0, sizeof(*profiler));
+    profiler->origin_ns = platform_time_ns();
+    profiler->frame_start_ns = profiler->origin_ns;
+    profiler->trace = (FrameRecord*)malloc(PROFILER_TRACE_FRAMES * sizeof(FrameRecord));
+    return profiler->trace != NULL;
+}
+
+void frame_profiler_free(FrameProfiler* profiler) {
+    free(profiler->trace);
+    profiler->trace = NULL;
+}
+
+void frame_profiler_begin(FrameProfiler* profiler, ProfileSection section) {
+    profiler->section_start_ns[section] = platform_time_ns();
+}
+
+void frame_profiler_end(FrameProfiler* profiler, ProfileSection section) {
+    profiler->section_ns[section] += platform_time_ns() - profiler->section_start_ns[section];
+    // The sections double as the GUI's render passes on the trace timeline
+    if (trace_is_enabled()) {
+        trace_end(frame_profiler_section_name(section), "frame", profiler->section_start_ns[section]);
+    }
+}
+
+static uint32_t to_us(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+void frame_profiler_end_frame(FrameProfiler* profiler) {
+    uint64_t now = platform_time_ns();
+    if (profiler->trace != NULL) {
+        FrameRecord* record = &profiler->trace[profiler->frame_count % PROFILER_TRACE_FRAMES];
+        record->start_us = (profiler->frame_start_ns - profiler->origin_ns) / 1000;
+        record->frame_us = to_us(now - profiler->frame_start_ns);
+        for (int section = 0; section < PROFILE_SECTIONS; section++) {
+            record->section_us[section] = to_us(profiler->section_ns[section]);
+        }
+    }
+    memset(profiler->section_ns, 0, sizeof(profiler->section_ns));
+    profiler->frame_start_ns = now;
+    profiler->frame_count++;
+}
+
+static int compare_us(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest rank percentile of a sorted window
+static float percentile_ms(const uint32_t* sorted, uint32_t count, uint32_t percent) {
+    uint32_t rank = (count * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0] / 1000.0f;
+}
+
+void frame_profiler_stats(const FrameProfiler* profiler, FrameStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (profiler->trace == NULL || profiler->frame_count == 0) {
+        return;
+    }
+    uint32_t window[PROFILER_WINDOW];
+    uint64_t section_us[PROFILE_SECTIONS] = { 0 };
+    uint32_t count = profiler->frame_count < PROFILER_WINDOW ? (uint32_t)profiler->frame_count : PROFILER_WINDOW;
+    for (uint32_t i = 0; i < count; i++) {
+        const FrameRecord* record = &profiler->trace[(profiler->frame_count - 1 - i) % PROFILER_TRACE_FRAMES];
+        window[i] = record->frame_us;
+        for (int section = 0; section < PROFILE_SECTIONS; section++) {
+            section_us[section] += record->section_us[section];
+        }
+    }
+    qsort(window, count, sizeof(uint32_t), compare_us);
+
+    stats->frames = count;
+    stats->p50_ms = percentile_ms(window, count, 50);
+    stats->p95_ms = percentile_ms(window, count, 95);
+    stats->p99_ms = percentile_ms(window, count, 99);
+    stats->max_ms = window[count - 1] / 1000.0f;
+    for (int section = 0; section < PROFILE_SECTIONS; section++) {
+        stats->section_ms[section] = (float)section_us[section] / count / 1000.0f;
+    }
+}
+
+const char* frame_profiler_section_name(ProfileSection section) {
+    switch (section) {
+    case ProfileEvents: return "events";
+    case ProfileDraw: return "draw";
+    case ProfilePresent: return "present";
+    case ProfileAssets: return "assets";
+    default: return "?";
+    }
+}
+
+bool frame_profiler_write_csv(const FrameProfiler* profiler, const char* path) {
+    if (profiler->trace == NULL) {
+        return false;
+    }
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "frame,start_ms,frame_ms");
+    for (int section = 0; section < PROFILE_SECTIONS; section++) {
+        fprintf(file, ",%s_ms", frame_profiler_section_name((ProfileSection)section));
+    }
+    fprintf(file, "\n");
+
+    uint64_t first = profiler->frame_count > PROFILER_TRACE_FRAMES ? profiler->frame_count - PROFILER_TRACE_FRAMES : 0;
+    for (uint64_t frame = first; frame < profiler->frame_count; frame++) {
+        const FrameRecord* record = &profiler->trace[frame % PROFILER_TRACE_FRAMES];
+        fprintf(file, "%llu,%.3f,%.3f", (unsigned long long)frame, record->start_us / 1000.0, record->frame_us / 1000.0);
+        for (int section = 0; section < PROFILE_SECTIONS; section++) {
+            fprintf(file, ",%.3f", record->section_us[section] / 1000.0);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+// Frame time profiler for the GUI.
+//
+// The main loop brackets each part of a frame with frame_profiler_begin/end and closes
+// the frame with frame_profiler_end_frame. Every frame becomes one record in a ring of
+// recent frames: the time since the previous frame ended and the time spent in each
+// section. frame_profiler_stats gives percentiles over the last PROFILER_WINDOW frames
+// for the overlay, frame_profiler_write_csv dumps the whole ring so a stutter report
+// comes with the frames around it. While tracing is on (trace.h) every section is also
+// recorded as a trace event.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROFILER_WINDOW 512             // Frames behind the rolling percentiles
+#define PROFILER_TRACE_FRAMES (1 << 17) // Frames kept for the CSV, about half an hour at 60 Hz
+
+typedef enum {
+    ProfileEvents,
+    ProfileDraw,
+    ProfilePresent,
+    ProfileAssets,
+    PROFILE_SECTIONS
+} ProfileSection;
+
+typedef struct FrameRecord {
+    uint64_t start_us;                  // Since frame_profiler_init
+    uint32_t frame_us;
+    uint32_t section_us[PROFILE_SECTIONS];
+} FrameRecord;
+
+typedef struct FrameProfiler {
+    uint64_t origin_ns;
+    uint64_t frame_start_ns;
+    uint64_t section_start_ns[PROFILE_SECTIONS];
+    uint64_t section_ns[PROFILE_SECTIONS]; // Of the frame in progress
+    FrameRecord* trace;                 // Ring of PROFILER_TRACE_FRAMES, NULL if it could not be allocated
+    uint64_t frame_count;
+} FrameProfiler;
+
+typedef struct FrameStats {
+    uint32_t frames;                    // In the window
+    float p50_ms;
+    float p95_ms;
+    float p99_ms;
+    float max_ms;
+    float section_ms[PROFILE_SECTIONS]; // Average per frame
+} FrameStats;
+
+bool frame_profiler_init(FrameProfiler* profiler);
+void frame_profiler_free(FrameProfiler* profiler);
+
+// Sections may run more than once per frame; work outside any frame (asset loads before
+// the first one) counts towards the next frame
+void frame_profiler_begin(FrameProfiler* profiler, ProfileSection section);
+void frame_profiler_end(FrameProfiler* profiler, ProfileSection section);
+void frame_profiler_end_frame(FrameProfiler* profiler);
+
+void frame_profiler_stats(const FrameProfiler* profiler, FrameStats* stats);
+const char* frame_profiler_section_name(ProfileSection section);
+
+// One line per kept frame, oldest first, times in milliseconds
+bool frame_profiler_write_csv(const FrameProfiler* profiler, const char* path);
+
+#endif
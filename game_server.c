@@ -0,0 +1,307 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "game_server.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+GameServer* game_server_create(uint32_t max_sessions, int worker_count, uint64_t seed) {
+    if (max_sessions == 0 || worker_count < 1 || worker_count > SERVER_MAX_WORKERS) {
+        return NULL;
+    }
+    GameServer* server = (GameServer*)calloc(1, sizeof(GameServer));
+    if (server == NULL) {
+        return NULL;
+    }
+    server->capacity = max_sessions;
+    server->worker_count = worker_count;
+    server->block_size = (size_t)max_sessions * sizeof(Session);
+    server->sessions = (Session*)platform_alloc_large(server->block_size, true, &server->huge_pages);
+    server->workers = (ServerWorker*)calloc((size_t)worker_count, sizeof(ServerWorker));
+    if (server->sessions == NULL || server->workers == NULL) {
+        game_server_destroy(server);
+        return NULL;
+    }
+
+    // Each worker owns a contiguous slice of the arena, chained into its free list
+    for (int w = 0; w < worker_count; w++) {
+        uint32_t first = (uint32_t)((uint64_t)max_sessions * w / worker_count);
+        uint32_t end = (uint32_t)((uint64_t)max_sessions * (w + 1) / worker_count);
+        server->workers[w].free_head = first < end ? first : SERVER_NO_SESSION;
+        server->workers[w].rng = seed ^ ((uint64_t)w << 48);
+        for (uint32_t i = first; i < end; i++) {
+            server->sessions[i].next = i + 1 < end ? i + 1 : SERVER_NO_SESSION;
+        }
+    }
+    return server;
+}
+
+void game_server_destroy(GameServer* server) {
+    if (server == NULL) {
+        return;
+    }
+    if (server->sessions != NULL) {
+        platform_free_large(server->sessions, server->block_size, server->huge_pages);
+    }
+    free(server->workers);
+    free(server);
+}
+
+void game_server_connect(GameServer* server, ServerConnection* connection, uint64_t id, int worker) {
+    (void)server;
+    connection->id = id;
+    connection->worker = worker;
+    connection->sessions = SERVER_NO_SESSION;
+}
+
+static Session* open_session(GameServer* server, ServerConnection* connection, uint32_t deal) {
+    ServerWorker* worker = &server->workers[connection->worker];
+    uint32_t index = worker->free_head;
+    if (index == SERVER_NO_SESSION) {
+        return NULL;
+    }
+    Session* session = &server->sessions[index];
+    worker->free_head = session->next;
+
+    session->owner = connection->id;
+    session->deal = deal;
+    session->previous = SERVER_NO_SESSION;
+    session->next = connection->sessions;
+    if (connection->sessions != SERVER_NO_SESSION) {
+        server->sessions[connection->sessions].previous = index;
+    }
+    connection->sessions = index;
+    state_deal(&session->state, deal);
+    journal_init(&session->journal, session->journal_storage, SERVER_JOURNAL_CAPACITY);
+    atomic_store_explicit(&worker->active_sessions, atomic_load_explicit(&worker->active_sessions, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    return session;
+}
+
+static void close_session(GameServer* server, ServerConnection* connection, uint32_t index) {
+    ServerWorker* worker = &server->workers[connection->worker];
+    Session* session = &server->sessions[index];
+    if (session->previous != SERVER_NO_SESSION) {
+        server->sessions[session->previous].next = session->next;
+    }
+    else {
+        connection->sessions = session->next;
+    }
+    if (session->next != SERVER_NO_SESSION) {
+        server->sessions[session->next].previous = session->previous;
+    }
+
+    session->owner = 0;
+    session->next = worker->free_head;
+    worker->free_head = index;
+    atomic_store_explicit(&worker->active_sessions, atomic_load_explicit(&worker->active_sessions, memory_order_relaxed) - 1,
+                          memory_order_relaxed);
+}
+
+void game_server_disconnect(GameServer* server, ServerConnection* connection) {
+    while (connection->sessions != SERVER_NO_SESSION) {
+        close_session(server, connection, connection->sessions);
+    }
+}
+
+// Splits off the next word, or returns NULL at the end of the line
+static char* next_word(char** line) {
+    char* word = *line;
+    while (*word == ' ' || *word == '\t' || *word == '\r') {
+        word++;
+    }
+    if (*word == '\0') {
+        return NULL;
+    }
+    char* end = word;
+    while (*end != '\0' && *end != ' ' && *end != '\t' && *end != '\r') {
+        end++;
+    }
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+    *line = end;
+    return word;
+}
+
+static bool parse_number(const char* text, uint32_t* value) {
+    char* end;
+    if (text == NULL || *text < '0' || *text > '9') {
+        return false;
+    }
+    unsigned long number = strtoul(text, &end, 10);
+    if (*end != '\0' || number > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t)number;
+    return true;
+}
+
+static Session* find_session(GameServer* server, const ServerConnection* connection, const char* text) {
+    uint32_t index;
+    if (!parse_number(text, &index) || index >= server->capacity || server->sessions[index].owner != connection->id) {
+        return NULL;
+    }
+    return &server->sessions[index];
+}
+
+static int answer(char* out, const char* text) {
+    size_t length = strlen(text);
+    memcpy(out, text, length);
+    out[length] = '\n';
+    return (int)length + 1;
+}
+
+// Columns bottom to top, face down cards as ??, empty columns as -
+static int show_session(const Session* session, char* out) {
+    const GameState* state = &session->state;
+    int length = sprintf(out, "OK %u %d", session->deal, state_foundation_count(state));
+    for (int column = 0, position = 0; column < YUKON_COLUMNS; column++) {
+        out[length++] = ' ';
+        if (state->column_length[column] == 0) {
+            out[length++] = '-';
+        }
+        for (int i = 0; i < state->column_length[column]; i++, position++) {
+            if (i < state->hidden_count[column]) {
+                out[length++] = '?';
+                out[length++] = '?';
+            }
+            else {
+                card_to_string(state->cards[position], out + length);
+                length += 2;
+            }
+        }
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+int game_server_handle(GameServer* server, ServerConnection* connection, const char* request, char* out) {
+    ServerWorker* worker = &server->workers[connection->worker];
+    char line[SERVER_MAX_LINE];
+    size_t request_length = strlen(request);
+    if (request_length >= sizeof(line)) {
+        return answer(out, "ERR line too long");
+    }
+    memcpy(line, request, request_length + 1);
+    char* rest = line;
+    char* command = next_word(&rest);
+    char* argument = next_word(&rest);
+    char* extra = next_word(&rest);
+    atomic_store_explicit(&worker->requests, atomic_load_explicit(&worker->requests, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+
+    if (command == NULL) {
+        return answer(out, "ERR empty request");
+    }
+    if (strcmp(command, "NEW") == 0) {
+        uint32_t deal;
+        if (argument == NULL) {
+            deal = (uint32_t)rng_next(&worker->rng);
+        }
+        else if (!parse_number(argument, &deal)) {
+            return answer(out, "ERR bad deal number");
+        }
+        Session* session = open_session(server, connection, deal);
+        if (session == NULL) {
+            return answer(out, "ERR no free session");
+        }
+        return sprintf(out, "OK %u %u\n", (uint32_t)(session - server->sessions), deal);
+    }
+    if (strcmp(command, "STATS") == 0) {
+        ServerStats stats;
+        game_server_stats(server, &stats);
+        return sprintf(out, "OK sessions %u requests %llu p50_us %.1f p99_us %.1f max_us %.1f\n", stats.sessions,
+                       (unsigned long long)stats.requests, stats.p50_us, stats.p99_us, stats.max_us);
+    }
+    if (strcmp(command, "QUIT") == 0) {
+        return SERVER_QUIT;
+    }
+
+    Session* session = find_session(server, connection, argument);
+    if (strcmp(command, "MOVE") != 0 && strcmp(command, "UNDO") != 0 && strcmp(command, "REDO") != 0 &&
+        strcmp(command, "MOVES") != 0 && strcmp(command, "SHOW") != 0 && strcmp(command, "CLOSE") != 0) {
+        return answer(out, "ERR unknown command");
+    }
+    if (session == NULL) {
+        return answer(out, "ERR no such session");
+    }
+
+    if (strcmp(command, "MOVE") == 0) {
+        Move move;
+        if (extra == NULL || !move_from_string(&session->state, extra, &move) || !state_is_move_legal(&session->state, move)) {
+            return answer(out, "ERR move not allowed");
+        }
+        journal_apply(&session->journal, &session->state, move);
+        return answer(out, state_is_won(&session->state) ? "OK WON" : "OK");
+    }
+    if (strcmp(command, "UNDO") == 0) {
+        return answer(out, journal_undo_state(&session->journal, &session->state) ? "OK" : "ERR nothing to undo");
+    }
+    if (strcmp(command, "REDO") == 0) {
+        return answer(out, journal_redo_state(&session->journal, &session->state) ? "OK" : "ERR nothing to redo");
+    }
+    if (strcmp(command, "MOVES") == 0) {
+        Move moves[YUKON_MAX_MOVES];
+        int count = state_generate_moves(&session->state, moves);
+        int length = sprintf(out, "OK %d", count);
+        for (int i = 0; i < count; i++) {
+            out[length++] = ' ';
+            move_to_string(&session->state, moves[i], out + length);
+            length += (int)strlen(out + length);
+        }
+        out[length++] = '\n';
+        return length;
+    }
+    if (strcmp(command, "SHOW") == 0) {
+        return show_session(session, out);
+    }
+    close_session(server, connection, (uint32_t)(session - server->sessions));
+    return answer(out, "OK");
+}
+
+void game_server_record_latency(GameServer* server, int worker, uint64_t ns) {
+    uint64_t bucket = ns / LATENCY_BUCKET_NS;
+    _Atomic uint64_t* counter = &server->workers[worker].latency[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1];
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+void game_server_stats(const GameServer* server, ServerStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    uint64_t* merged = (uint64_t*)calloc(LATENCY_BUCKETS, sizeof(uint64_t));
+    uint64_t timed = 0;
+    for (int w = 0; w < server->worker_count; w++) {
+        const ServerWorker* worker = &server->workers[w];
+        stats->sessions += atomic_load_explicit(&worker->active_sessions, memory_order_relaxed);
+        stats->requests += atomic_load_explicit(&worker->requests, memory_order_relaxed);
+        for (int b = 0; b < LATENCY_BUCKETS && merged != NULL; b++) {
+            uint64_t count = atomic_load_explicit(&worker->latency[b], memory_order_relaxed);
+            merged[b] += count;
+            timed += count;
+        }
+    }
+    if (merged == NULL || timed == 0) {
+        free(merged);
+        return;
+    }
+
+    // Upper edge of the bucket holding each percentile
+    uint64_t p50_rank = (timed + 1) / 2;
+    uint64_t p99_rank = (timed * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (merged[b] == 0) {
+            continue;
+        }
+        double edge_us = (double)(b + 1) * LATENCY_BUCKET_NS / 1000.0;
+        if (seen < p50_rank && seen + merged[b] >= p50_rank) {
+            stats->p50_us = edge_us;
+        }
+        if (seen < p99_rank && seen + merged[b] >= p99_rank) {
+            stats->p99_us = edge_us;
+        }
+        seen += merged[b];
+        stats->max_us = edge_us;
+    }
+    free(merged);
+}
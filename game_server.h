@@ -0,0 +1,100 @@
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+// Many Yukon games in one process, driven by a line protocol.
+//
+// This is the part of yukon_server that does not touch sockets: the session arena and
+// the request handler. Every session is an engine GameState with a short undo journal,
+// taken from one preallocated arena. The arena is split into one slice per worker, and a
+// connection stays on one worker, so creating, playing and closing sessions needs no
+// locks. Requests, one per line, and their one line responses:
+//
+//   NEW [DEAL]          OK <session> <deal>
+//   MOVE <session> <m>  OK | OK WON            m as move_to_string writes it, C2:5H->C5, C1->F3
+//   UNDO <session>      OK
+//   REDO <session>      OK
+//   MOVES <session>     OK <count> <move>...
+//   SHOW <session>      OK <deal> <cards on foundations> <column 1> ... <column 7>
+//   CLOSE <session>     OK
+//   STATS               OK sessions <n> requests <n> p50_us <t> p99_us <t> max_us <t>
+//   QUIT                closes the connection
+//
+// Errors answer "ERR <reason>". A session can only be used by the connection that
+// created it and is closed with it.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "game_state.h"
+#include "move_journal.h"
+
+#define SERVER_MAX_WORKERS 64
+#define SERVER_MAX_LINE 2048
+#define SERVER_JOURNAL_CAPACITY 64          // Undo depth of a session
+#define SERVER_NO_SESSION UINT32_MAX
+#define SERVER_QUIT (-1)
+
+// Request latencies in 100 ns buckets up to 1 ms, slower ones share the last bucket
+#define LATENCY_BUCKET_NS 100
+#define LATENCY_BUCKETS 10000
+
+typedef struct Session {
+    GameState state;
+    uint64_t owner;                         // Connection id, 0 while the session is free
+    uint32_t deal;
+    uint32_t previous;                      // Links in the owner's list, or the worker's free list
+    uint32_t next;
+    MoveJournal journal;
+    Move journal_storage[SERVER_JOURNAL_CAPACITY];
+} Session;
+
+// Written by its worker only, read by STATS from any worker
+typedef struct ServerWorker {
+    uint32_t free_head;
+    uint64_t rng;                           // Deals for NEW without a deal number
+    _Atomic uint32_t active_sessions;
+    _Atomic uint64_t requests;
+    _Atomic uint64_t latency[LATENCY_BUCKETS];
+} ServerWorker;
+
+typedef struct GameServer {
+    Session* sessions;
+    uint32_t capacity;
+    size_t block_size;
+    bool huge_pages;
+    int worker_count;
+    ServerWorker* workers;
+} GameServer;
+
+typedef struct ServerConnection {
+    uint64_t id;                            // Unique and not 0
+    int worker;
+    uint32_t sessions;                      // Head of the list of its sessions
+} ServerConnection;
+
+typedef struct ServerStats {
+    uint32_t sessions;
+    uint64_t requests;
+    double p50_us;
+    double p99_us;
+    double max_us;
+} ServerStats;
+
+GameServer* game_server_create(uint32_t max_sessions, int worker_count, uint64_t seed);
+void game_server_destroy(GameServer* server);
+
+void game_server_connect(GameServer* server, ServerConnection* connection, uint64_t id, int worker);
+// Closes the connection's sessions
+void game_server_disconnect(GameServer* server, ServerConnection* connection);
+
+// Answers one request line (without its newline). Writes the response, newline included,
+// and returns its length, or SERVER_QUIT to close the connection. out needs
+// SERVER_MAX_LINE bytes.
+int game_server_handle(GameServer* server, ServerConnection* connection, const char* line, char* out);
+
+// Time from reading a request to having its response ready
+void game_server_record_latency(GameServer* server, int worker, uint64_t ns);
+void game_server_stats(const GameServer* server, ServerStats* stats);
+
+#endif
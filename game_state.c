@@ -0,0 +1,465 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "game_state.h"
+#include <string.h>
+#include <ctype.h>
+
+#define PARENT_COLUMN_BASE 52
+#define PARENT_FOUNDATION 53
+#define PARENT_HIDDEN 54
+
+uint64_t rng_next(uint64_t* rng) {
+    uint64_t x = (*rng += 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+uint32_t rng_below(uint64_t* rng, uint32_t bound) {
+    return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+// Zobrist keys are indexed by (card, what it lies on) instead of (card, column, row).
+// Moving a whole stack then only changes the key of its bottom card, and the hash
+// does not depend on the order of the columns, which are interchangeable anyway.
+static uint64_t zobrist_key(int card, int parent) {
+    uint64_t seed = ((uint64_t)card << 8) | (uint64_t)parent;
+    return rng_next(&seed);
+}
+
+void deal_order(uint32_t deal_number, uint8_t order[YUKON_CARDS]) {
+    uint64_t rng = 0x59554B4F4E000000ull ^ deal_number; // "YUKON"
+    for (int i = 0; i < YUKON_CARDS; i++) {
+        order[i] = (uint8_t)i;
+    }
+    for (int i = YUKON_CARDS - 1; i > 0; i--) {
+        int swap = (int)rng_below(&rng, (uint32_t)i + 1);
+        uint8_t temp = order[i];
+        order[i] = order[swap];
+        order[swap] = temp;
+    }
+}
+
+void state_clear(GameState* state) {
+    memset(state, 0, sizeof(*state));
+    state->hash = state_compute_hash(state);
+}
+
+// Same layout as deal_cards: 1, 6, 7, ..., 11 cards, each new card going under the previous
+// ones, and column i keeps its bottom i cards face down
+void state_deal_from_order(GameState* state, const uint8_t order[YUKON_CARDS]) {
+    memset(state, 0, sizeof(*state));
+    int dealt = 0;
+    int start = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        int count = column == 0 ? 1 : column + 5;
+        for (int i = 0; i < count; i++) {
+            state->cards[start + count - 1 - i] = order[dealt++];
+        }
+        state->column_length[column] = (uint8_t)count;
+        state->hidden_count[column] = (uint8_t)column;
+        start += count;
+    }
+    state->hash = state_compute_hash(state);
+}
+
+void state_deal(GameState* state, uint32_t deal_number) {
+    uint8_t order[YUKON_CARDS];
+    deal_order(deal_number, order);
+    state_deal_from_order(state, order);
+}
+
+int state_column_start(const GameState* state, int column) {
+    int start = 0;
+    for (int i = 0; i < column; i++) {
+        start += state->column_length[i];
+    }
+    return start;
+}
+
+uint8_t state_top_card(const GameState* state, int column) {
+    if (state->column_length[column] == 0) {
+        return NO_CARD;
+    }
+    return state->cards[state_column_start(state, column) + state->column_length[column] - 1];
+}
+
+int state_foundation_count(const GameState* state) {
+    return state->foundation[0] + state->foundation[1] + state->foundation[2] + state->foundation[3];
+}
+
+int state_tableau_count(const GameState* state) {
+    return YUKON_CARDS - state_foundation_count(state);
+}
+
+bool state_is_won(const GameState* state) {
+    return state_foundation_count(state) == YUKON_CARDS;
+}
+
+static bool fits_on(uint8_t card, uint8_t target) {
+    return CARD_RANK(card) + 1 == CARD_RANK(target) && CARD_IS_RED(card) != CARD_IS_RED(target);
+}
+
+bool state_is_move_legal(const GameState* state, Move move) {
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+
+    if (from >= YUKON_COLUMNS || to >= YUKON_PILES || from == to || count == 0) {
+        return false;
+    }
+    int length = state->column_length[from];
+    if (count > length - state->hidden_count[from]) {
+        return false; // Only face up cards can be moved
+    }
+    uint8_t card = state->cards[state_column_start(state, from) + length - count];
+
+    if (PILE_IS_FOUNDATION(to)) {
+        int suit = to - PILE_FOUNDATION;
+        return count == 1 && CARD_SUIT(card) == suit && CARD_RANK(card) == state->foundation[suit];
+    }
+
+    uint8_t target = state_top_card(state, to);
+    if (target == NO_CARD) {
+        return CARD_RANK(card) == YUKON_RANKS - 1; // Only kings go into empty columns
+    }
+    return fits_on(card, target);
+}
+
+int state_generate_moves(const GameState* state, Move moves[YUKON_MAX_MOVES]) {
+    uint8_t top_column[YUKON_CARDS];
+    int start[YUKON_COLUMNS];
+    int empty_column = -1;
+    int count = 0;
+
+    memset(top_column, 0xFF, sizeof(top_column));
+    for (int column = 0, offset = 0; column < YUKON_COLUMNS; column++) {
+        start[column] = offset;
+        offset += state->column_length[column];
+        if (state->column_length[column] == 0) {
+            if (empty_column < 0) {
+                empty_column = column;
+            }
+        }
+        else {
+            top_column[state->cards[offset - 1]] = (uint8_t)column;
+        }
+    }
+
+    // Foundation moves first, they are almost always the ones worth trying
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        int length = state->column_length[column];
+        if (length > 0) {
+            uint8_t card = state->cards[start[column] + length - 1];
+            if (CARD_RANK(card) == state->foundation[CARD_SUIT(card)]) {
+                moves[count++] = MOVE_MAKE(column, PILE_FOUNDATION + CARD_SUIT(card), 1);
+            }
+        }
+    }
+
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        int length = state->column_length[column];
+        for (int i = state->hidden_count[column]; i < length; i++) {
+            uint8_t card = state->cards[start[column] + i];
+            int moved = length - i;
+            int rank = CARD_RANK(card);
+
+            if (rank == YUKON_RANKS - 1) {
+                // A king already at the bottom of its column gains nothing from an empty one
+                if (i > 0 && empty_column >= 0) {
+                    moves[count++] = MOVE_MAKE(column, empty_column, moved);
+                }
+                continue;
+            }
+
+            // The two cards this one can go on: next rank, other colour
+            int first_suit = CARD_IS_RED(card) ? 2 : 0;
+            for (int suit = first_suit; suit < first_suit + 2; suit++) {
+                uint8_t target_column = top_column[suit * YUKON_RANKS + rank + 1];
+                if (target_column != 0xFF && target_column != column) {
+                    moves[count++] = MOVE_MAKE(column, target_column, moved);
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static int parent_of(const GameState* state, int position, int column_start) {
+    return position > column_start ? state->cards[position - 1] : PARENT_COLUMN_BASE;
+}
+
+Move state_apply_move(GameState* state, Move move) {
+    move = MOVE_WITHOUT_FLAGS(move);
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+    int total = state_tableau_count(state);
+    int from_start = state_column_start(state, from);
+    int from_end = from_start + state->column_length[from];
+    int moved_at = from_end - count;
+    uint8_t card = state->cards[moved_at];
+
+    state->hash ^= zobrist_key(card, parent_of(state, moved_at, from_start));
+
+    if (PILE_IS_FOUNDATION(to)) {
+        memmove(&state->cards[moved_at], &state->cards[moved_at + 1], (size_t)(total - moved_at - 1));
+        state->foundation[to - PILE_FOUNDATION]++;
+        state->hash ^= zobrist_key(card, PARENT_FOUNDATION);
+    }
+    else {
+        uint8_t moving[YUKON_CARDS];
+        int to_start = state_column_start(state, to);
+        int to_end = to_start + state->column_length[to];
+
+        state->hash ^= zobrist_key(card, to_end > to_start ? state->cards[to_end - 1] : PARENT_COLUMN_BASE);
+
+        // Rotate the stack past the cards between the two columns
+        memcpy(moving, &state->cards[moved_at], (size_t)count);
+        if (to > from) {
+            memmove(&state->cards[moved_at], &state->cards[from_end], (size_t)(to_end - from_end));
+            memcpy(&state->cards[to_end - count], moving, (size_t)count);
+        }
+        else {
+            memmove(&state->cards[to_end + count], &state->cards[to_end], (size_t)(moved_at - to_end));
+            memcpy(&state->cards[to_end], moving, (size_t)count);
+        }
+        state->column_length[to] += (uint8_t)count;
+    }
+    state->column_length[from] -= (uint8_t)count;
+
+    // Turn the new top card face up
+    int remaining = state->column_length[from];
+    if (remaining > 0 && state->hidden_count[from] == remaining) {
+        state->hidden_count[from]--;
+        state->hash ^= zobrist_key(state->cards[state_column_start(state, from) + remaining - 1], PARENT_HIDDEN);
+        move |= MOVE_REVEAL;
+    }
+    return move;
+}
+
+void state_undo_move(GameState* state, Move move) {
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+    int total = state_tableau_count(state);
+    int from_start = state_column_start(state, from);
+    int from_end = from_start + state->column_length[from];
+
+    if (move & MOVE_REVEAL) {
+        state->hidden_count[from]++;
+        state->hash ^= zobrist_key(state->cards[from_end - 1], PARENT_HIDDEN);
+    }
+
+    uint8_t card;
+    if (PILE_IS_FOUNDATION(to)) {
+        int suit = to - PILE_FOUNDATION;
+        card = (uint8_t)(suit * YUKON_RANKS + state->foundation[suit] - 1);
+        memmove(&state->cards[from_end + 1], &state->cards[from_end], (size_t)(total - from_end));
+        state->cards[from_end] = card;
+        state->foundation[suit]--;
+        state->hash ^= zobrist_key(card, PARENT_FOUNDATION);
+    }
+    else {
+        uint8_t moving[YUKON_CARDS];
+        int to_start = state_column_start(state, to);
+        int to_end = to_start + state->column_length[to];
+        int stack_at = to_end - count;
+
+        card = state->cards[stack_at];
+        state->hash ^= zobrist_key(card, parent_of(state, stack_at, to_start));
+
+        memcpy(moving, &state->cards[stack_at], (size_t)count);
+        if (to > from) {
+            memmove(&state->cards[from_end + count], &state->cards[from_end], (size_t)(stack_at - from_end));
+            memcpy(&state->cards[from_end], moving, (size_t)count);
+        }
+        else {
+            memmove(&state->cards[stack_at], &state->cards[to_end], (size_t)(from_end - to_end));
+            memcpy(&state->cards[from_end - count], moving, (size_t)count);
+            from_start -= count; // The column moved down by the cards that left the lower column
+            from_end -= count;
+        }
+        state->column_length[to] -= (uint8_t)count;
+    }
+    state->column_length[from] += (uint8_t)count;
+    state->hash ^= zobrist_key(card, from_end > from_start ? state->cards[from_end - 1] : PARENT_COLUMN_BASE);
+}
+
+uint64_t state_compute_hash(const GameState* state) {
+    uint64_t hash = 0;
+    int position = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        int start = position;
+        for (int i = 0; i < state->column_length[column]; i++, position++) {
+            uint8_t card = state->cards[position];
+            hash ^= zobrist_key(card, parent_of(state, position, start));
+            if (i < state->hidden_count[column]) {
+                hash ^= zobrist_key(card, PARENT_HIDDEN);
+            }
+        }
+    }
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        for (int rank = 0; rank < state->foundation[suit]; rank++) {
+            hash ^= zobrist_key(suit * YUKON_RANKS + rank, PARENT_FOUNDATION);
+        }
+    }
+    return hash;
+}
+
+void state_rehash(GameState* state) {
+    state->hash = state_compute_hash(state);
+}
+
+void card_to_string(uint8_t card, char out[3]) {
+    out[0] = "A23456789TJQK"[CARD_RANK(card)];
+    out[1] = "HDCS"[CARD_SUIT(card)];
+    out[2] = '\0';
+}
+
+bool card_from_string(const char* text, uint8_t* card) {
+    const char* ranks = "A23456789TJQK";
+    const char* suits = "HDCS";
+    int rank = -1;
+    int suit = -1;
+    char rank_char = (char)toupper((unsigned char)text[0]);
+
+    // Accept both "TH" and "10H"
+    if (text[0] == '1' && text[1] == '0') {
+        rank_char = 'T';
+        text++;
+    }
+    for (int i = 0; i < YUKON_RANKS; i++) {
+        if (ranks[i] == rank_char) {
+            rank = i;
+        }
+    }
+    for (int i = 0; i < YUKON_FOUNDATIONS; i++) {
+        if (suits[i] == toupper((unsigned char)text[1])) {
+            suit = i;
+        }
+    }
+    if (rank < 0 || suit < 0) {
+        return false;
+    }
+    *card = (uint8_t)(suit * YUKON_RANKS + rank);
+    return true;
+}
+
+// Same text as the front end commands: C2:5H->C5 or C1->F1
+void move_to_string(const GameState* state, Move move, char out[16]) {
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+    char card[3];
+    char target = PILE_IS_FOUNDATION(to) ? 'F' : 'C';
+    int target_index = PILE_IS_FOUNDATION(to) ? to - PILE_FOUNDATION + 1 : to + 1;
+
+    if (count == 1) {
+        sprintf(out, "C%d->%c%d", from + 1, target, target_index);
+        return;
+    }
+    card_to_string(state->cards[state_column_start(state, from) + state->column_length[from] - count], card);
+    sprintf(out, "C%d:%s->%c%d", from + 1, card, target, target_index);
+}
+
+bool move_from_string(const GameState* state, const char* text, Move* move) {
+    if (toupper((unsigned char)text[0]) != 'C' || text[1] < '1' || text[1] > '0' + YUKON_COLUMNS) {
+        return false;
+    }
+    int from = text[1] - '1';
+    int length = state->column_length[from];
+    int count = 1;
+    const char* arrow = strstr(text, "->");
+    if (arrow == NULL || length == 0) {
+        return false;
+    }
+    if (text[2] == ':') {
+        uint8_t card;
+        if (!card_from_string(text + 3, &card)) {
+            return false;
+        }
+        int start = state_column_start(state, from);
+        count = 0;
+        for (int i = state->hidden_count[from]; i < length && count == 0; i++) {
+            if (state->cards[start + i] == card) {
+                count = length - i;
+            }
+        }
+        if (count == 0) {
+            return false;
+        }
+    }
+    else if (arrow != text + 2) {
+        return false;
+    }
+
+    // Check each byte before reading the next, the text may end anywhere after the arrow
+    if (arrow[2] == '\0' || arrow[3] == '\0' || arrow[4] != '\0') {
+        return false;
+    }
+    char target = (char)toupper((unsigned char)arrow[2]);
+    int index = arrow[3] - '1';
+    if (target == 'C' && index >= 0 && index < YUKON_COLUMNS) {
+        *move = MOVE_MAKE(from, index, count);
+        return true;
+    }
+    if (target == 'F' && index >= 0 && index < YUKON_FOUNDATIONS) {
+        *move = MOVE_MAKE(from, PILE_FOUNDATION + index, count);
+        return true;
+    }
+    return false;
+}
+
+void state_print(const GameState* state, FILE* out) {
+    static const uint8_t suits[YUKON_FOUNDATIONS] = { 0, 1, 2, 3 };
+    state_print_pockets(state, suits, out);
+}
+
+void state_print_pockets(const GameState* state, const uint8_t pocket_suit[YUKON_FOUNDATIONS], FILE* out) {
+    int start[YUKON_COLUMNS];
+    int max_length = 1;
+    char card[3];
+
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        start[column] = state_column_start(state, column);
+        if (state->column_length[column] > max_length) {
+            max_length = state->column_length[column];
+        }
+    }
+
+    fprintf(out, " ");
+    for (int i = 1; i <= YUKON_COLUMNS; i++) {
+        fprintf(out, " C%d  ", i);
+    }
+    for (int i = 1; i <= YUKON_FOUNDATIONS; i++) {
+        fprintf(out, " F%d  ", i);
+    }
+    fprintf(out, "\n");
+
+    for (int row = 0; row < max_length; row++) {
+        for (int column = 0; column < YUKON_COLUMNS; column++) {
+            if (row >= state->column_length[column]) {
+                fprintf(out, "     ");
+            }
+            else if (row < state->hidden_count[column]) {
+                fprintf(out, "  [] ");
+            }
+            else {
+                card_to_string(state->cards[start[column] + row], card);
+                fprintf(out, "  %s ", card);
+            }
+        }
+        // Foundations only show their top card, on the first row
+        for (int pile = 0; pile < YUKON_FOUNDATIONS; pile++) {
+            int suit = pocket_suit[pile];
+            if (row == 0 && suit < YUKON_FOUNDATIONS && state->foundation[suit] > 0) {
+                card_to_string((uint8_t)(suit * YUKON_RANKS + state->foundation[suit] - 1), card);
+                fprintf(out, "  %s ", card);
+            }
+            else {
+                fprintf(out, "     ");
+            }
+        }
+        fprintf(out, "\n");
+    }
+}
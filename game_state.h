@@ -0,0 +1,90 @@
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+// Compact Yukon game state shared by the solvers, tools and front ends.
+//
+// The front ends keep their linked lists of Card; this is the flat form the engine
+// works on. A whole position is 80 bytes, so it can be copied and hashed cheaply.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define YUKON_COLUMNS 7
+#define YUKON_FOUNDATIONS 4
+#define YUKON_PILES (YUKON_COLUMNS + YUKON_FOUNDATIONS)
+#define YUKON_CARDS 52
+#define YUKON_RANKS 13
+#define YUKON_MAX_MOVES 128
+#define YUKON_RULES_VERSION 1 // Bump when move legality changes
+
+// Cards are 0-51: suit * 13 + rank, rank 0-12 (Ace..King), suit 0-3 (Hearts, Diamonds, Clubs, Spades)
+#define CARD_CODE(value, suit) ((uint8_t)(((suit) - 1) * YUKON_RANKS + (value) - 1)) // From Card::value/suit
+#define CARD_RANK(card) ((card) % YUKON_RANKS)
+#define CARD_SUIT(card) ((card) / YUKON_RANKS)
+#define CARD_IS_RED(card) (CARD_SUIT(card) < 2)
+#define CARD_VALUE(card) (CARD_RANK(card) + 1) // Back to Card::value 1-13
+#define CARD_SUIT_NUMBER(card) (CARD_SUIT(card) + 1) // Back to Card::suit 1-4
+#define NO_CARD 0xFF
+
+// Piles 0-6 are the columns, 7-10 the foundations (one per suit in the engine)
+#define PILE_FOUNDATION 7
+#define PILE_IS_FOUNDATION(pile) ((pile) >= PILE_FOUNDATION)
+
+// A move in 2 bytes: from pile (4 bits) | to pile (4 bits) | card count (6 bits) | reveal flag
+typedef uint16_t Move;
+#define MOVE_NONE 0
+#define MOVE_MAKE(from, to, count) ((Move)((from) | ((to) << 4) | ((count) << 8)))
+#define MOVE_FROM(move) ((move) & 0xF)
+#define MOVE_TO(move) (((move) >> 4) & 0xF)
+#define MOVE_COUNT(move) (((move) >> 8) & 0x3F)
+#define MOVE_REVEAL 0x4000 // Set when the move turned a hidden card face up
+#define MOVE_WITHOUT_FLAGS(move) ((Move)((move) & 0x3FFF))
+
+typedef struct GameState {
+    uint8_t cards[YUKON_CARDS];                 // Column cards bottom to top, columns stored back to back
+    uint8_t column_length[YUKON_COLUMNS];
+    uint8_t hidden_count[YUKON_COLUMNS];        // The first hidden_count cards of a column are face down
+    uint8_t foundation[YUKON_FOUNDATIONS];      // Number of cards on each suit's foundation
+    uint8_t reserved[2];
+    uint64_t hash;                              // Zobrist key, kept up to date by apply/undo
+} GameState;
+
+// Deterministic random numbers (splitmix64), identical on every platform
+uint64_t rng_next(uint64_t* rng);
+uint32_t rng_below(uint64_t* rng, uint32_t bound);
+
+// Shuffled deck for a deal number, in the order deal_cards takes cards off the deck
+void deal_order(uint32_t deal_number, uint8_t order[YUKON_CARDS]);
+void state_deal_from_order(GameState* state, const uint8_t order[YUKON_CARDS]);
+void state_deal(GameState* state, uint32_t deal_number);
+void state_clear(GameState* state);
+
+int state_column_start(const GameState* state, int column);
+uint8_t state_top_card(const GameState* state, int column);
+int state_tableau_count(const GameState* state);
+int state_foundation_count(const GameState* state);
+bool state_is_won(const GameState* state);
+
+bool state_is_move_legal(const GameState* state, Move move);
+int state_generate_moves(const GameState* state, Move moves[YUKON_MAX_MOVES]);
+
+// Returns the move with MOVE_REVEAL set if it turned a card face up; pass that to undo
+Move state_apply_move(GameState* state, Move move);
+void state_undo_move(GameState* state, Move move);
+
+uint64_t state_compute_hash(const GameState* state);
+void state_rehash(GameState* state);
+
+void card_to_string(uint8_t card, char out[3]);
+bool card_from_string(const char* text, uint8_t* card);
+void move_to_string(const GameState* state, Move move, char out[16]);
+// Reads what move_to_string writes (F1-F4 are the suits' foundations). Only checks that
+// the card is face up in the column, pass the move to state_is_move_legal as well.
+bool move_from_string(const GameState* state, const char* text, Move* move);
+void state_print(const GameState* state, FILE* out);
+// Same, with F1-F4 showing the suit each pocket holds (pocket_suit[i], YUKON_FOUNDATIONS or
+// more for an empty pocket) instead of one foundation per suit
+void state_print_pockets(const GameState* state, const uint8_t pocket_suit[YUKON_FOUNDATIONS], FILE* out);
+
+#endif
@@ -0,0 +1,228 @@
+#include "hint_engine.h"
+#include "solver.h"
+#include "determinize.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+struct HintEngine {
+    PlatformThread thread;
+    PlatformMutex mutex;          // Guards the request mailbox below
+    PlatformCondition wake;
+    GameState request;
+    uint32_t requested;           // Generation of the newest request
+    uint32_t taken;               // Generation the worker last picked up
+    bool line_requested;          // The newest request wants a whole line
+    bool quit;
+    SolveResult line;             // Also guarded by the mutex: the last line found
+    uint32_t line_generation;     // Request the line belongs to, 0 for none
+
+    _Atomic bool stop;            // Cancels the running search
+    _Atomic uint64_t published;   // generation (32) | kind (8) | move (16)
+
+    Solver* solver;
+    SolveResult result;
+    FairHinter* fair;             // Set in fair mode, samples the face down cards
+    FairHint fair_hint;
+    Solver* line_solver;          // Optional, for hint_engine_request_line
+};
+
+static uint64_t pack_hint(uint32_t generation, HintKind kind, Move move) {
+    return ((uint64_t)generation << 32) | ((uint64_t)kind << 16) | move;
+}
+
+static void publish(HintEngine* engine, uint32_t generation, HintKind kind, Move move) {
+    atomic_store_explicit(&engine->published, pack_hint(generation, kind, MOVE_WITHOUT_FLAGS(move)), memory_order_release);
+}
+
+static bool state_has_hidden(const GameState* state) {
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        if (state->hidden_count[column] > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void hint_worker(void* argument) {
+    HintEngine* engine = (HintEngine*)argument;
+    trace_thread_name("hint worker");
+    for (;;) {
+        GameState state;
+        uint32_t generation;
+        bool want_line;
+
+        platform_mutex_lock(&engine->mutex);
+        while (!engine->quit && engine->taken == engine->requested) {
+            platform_condition_wait(&engine->wake, &engine->mutex);
+        }
+        if (engine->quit) {
+            platform_mutex_unlock(&engine->mutex);
+            break;
+        }
+        state = engine->request;
+        generation = engine->taken = engine->requested;
+        want_line = engine->line_requested;
+        // Cleared under the lock so a newer request can not slip in between
+        atomic_store_explicit(&engine->stop, false, memory_order_relaxed);
+        platform_mutex_unlock(&engine->mutex);
+
+        // Something to show right away, then let the solver try to do better
+        uint64_t trace_start = trace_begin();
+        Move moves[YUKON_MAX_MOVES];
+        int count = solver_ordered_moves(&state, moves);
+        publish(engine, generation, count > 0 ? HintGuess : HintNone, count > 0 ? moves[0] : MOVE_NONE);
+        if (want_line) {
+            SolveStatus status = solver_solve(engine->line_solver, &state, &engine->result);
+            // A cancelled search is for an older board; the flag is only set under the lock
+            platform_mutex_lock(&engine->mutex);
+            if (!atomic_load_explicit(&engine->stop, memory_order_relaxed)) {
+                engine->line = engine->result;
+                engine->line_generation = generation;
+            }
+            platform_mutex_unlock(&engine->mutex);
+            if (status == SolveWon) {
+                publish(engine, generation, HintWinning, engine->result.line[0]);
+            }
+            else if (status == SolveUnsolvable) {
+                publish(engine, generation, HintNoWin, moves[0]);
+            }
+            trace_end_value("solve line", "hint", trace_start, (int64_t)engine->result.nodes);
+            continue;
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        if (engine->fair && state_has_hidden(&state)) {
+            if (!fair_hinter_run(engine->fair, &state, &engine->fair_hint)) {
+                continue;
+            }
+            const FairHint* hint = &engine->fair_hint;
+            publish(engine, generation, hint->win_rate >= 0.5f ? HintWinning : hint->win_rate == 0.0f ? HintNoWin : HintGuess,
+                    hint->move);
+            trace_end_value("fair hint", "hint", trace_start, generation);
+            continue;
+        }
+
+        SolveStatus status = solver_solve(engine->solver, &state, &engine->result);
+        if (atomic_load_explicit(&engine->stop, memory_order_relaxed)) {
+            continue; // Cancelled, the board has already changed
+        }
+        if (status == SolveWon) {
+            publish(engine, generation, HintWinning, engine->result.line[0]);
+        }
+        else if (status == SolveUnsolvable) {
+            publish(engine, generation, HintNoWin, moves[0]);
+        }
+        trace_end_value("hint", "hint", trace_start, generation);
+    }
+    trace_thread_release();
+}
+
+HintEngine* hint_engine_create(uint64_t node_limit, size_t tt_mb, bool fair, const Tablebase* tablebase) {
+    HintEngine* engine = (HintEngine*)calloc(1, sizeof(HintEngine));
+    if (engine == NULL) {
+        return NULL;
+    }
+    SolverConfig config;
+    solver_default_config(&config);
+    config.node_limit = node_limit;
+    config.tt_mb = tt_mb;
+    config.stop = &engine->stop;
+    config.tablebase = tablebase;
+
+    engine->solver = solver_create(&config);
+    if (fair) {
+        FairHintConfig fair_config;
+        fair_hint_default_config(&fair_config);
+        fair_config.tt_mb = tt_mb / 4 > 0 ? tt_mb / 4 : 1;
+        fair_config.stop = &engine->stop;
+        fair_config.tablebase = tablebase;
+        engine->fair = fair_hinter_create(&fair_config);
+    }
+    bool mutex_ok = platform_mutex_init(&engine->mutex);
+    bool wake_ok = platform_condition_init(&engine->wake);
+    if (engine->solver == NULL || (fair && engine->fair == NULL) || !mutex_ok || !wake_ok ||
+        !platform_thread_start(&engine->thread, hint_worker, engine)) {
+        solver_destroy(engine->solver);
+        fair_hinter_destroy(engine->fair);
+        platform_condition_destroy(&engine->wake);
+        platform_mutex_destroy(&engine->mutex);
+        free(engine);
+        return NULL;
+    }
+    return engine;
+}
+
+void hint_engine_destroy(HintEngine* engine) {
+    if (engine == NULL) {
+        return;
+    }
+    platform_mutex_lock(&engine->mutex);
+    engine->quit = true;
+    atomic_store_explicit(&engine->stop, true, memory_order_relaxed);
+    platform_condition_signal(&engine->wake);
+    platform_mutex_unlock(&engine->mutex);
+
+    platform_thread_join(&engine->thread);
+    solver_destroy(engine->solver);
+    solver_destroy(engine->line_solver);
+    fair_hinter_destroy(engine->fair);
+    platform_condition_destroy(&engine->wake);
+    platform_mutex_destroy(&engine->mutex);
+    free(engine);
+}
+
+static uint32_t request(HintEngine* engine, const GameState* state, bool line) {
+    platform_mutex_lock(&engine->mutex);
+    engine->request = *state;
+    engine->line_requested = line;
+    uint32_t generation = ++engine->requested;
+    atomic_store_explicit(&engine->stop, true, memory_order_relaxed);
+    // Whatever is published now belongs to an older board
+    publish(engine, generation, HintNone, MOVE_NONE);
+    platform_condition_signal(&engine->wake);
+    platform_mutex_unlock(&engine->mutex);
+    return generation;
+}
+
+uint32_t hint_engine_request(HintEngine* engine, const GameState* state) {
+    return request(engine, state, false);
+}
+
+bool hint_engine_set_line_solver(HintEngine* engine, const SolverConfig* config) {
+    if (engine->line_solver != NULL) {
+        return false;
+    }
+    // The worker only reads it for a line request, which comes later through the mutex
+    SolverConfig line_config = *config;
+    line_config.stop = &engine->stop;
+    engine->line_solver = solver_create(&line_config);
+    return engine->line_solver != NULL;
+}
+
+uint32_t hint_engine_request_line(HintEngine* engine, const GameState* state) {
+    return engine->line_solver != NULL ? request(engine, state, true) : 0;
+}
+
+bool hint_engine_take_line(HintEngine* engine, uint32_t generation, SolveResult* result) {
+    platform_mutex_lock(&engine->mutex);
+    bool done = generation != 0 && engine->line_generation == generation;
+    if (done) {
+        *result = engine->line;
+    }
+    platform_mutex_unlock(&engine->mutex);
+    return done;
+}
+
+Hint hint_engine_peek(const HintEngine* engine) {
+    uint64_t packed = atomic_load_explicit(&((HintEngine*)engine)->published, memory_order_acquire);
+    Hint hint;
+    hint.generation = (uint32_t)(packed >> 32);
+    hint.kind = (HintKind)((packed >> 16) & 0xFF);
+    hint.move = (Move)(packed & 0xFFFF);
+    return hint;
+}
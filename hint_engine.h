@@ -0,0 +1,57 @@
+#ifndef HINT_ENGINE_H
+#define HINT_ENGINE_H
+
+// Background hint search for the front ends.
+//
+// hint_engine_request hands a position to a worker thread and returns at once; a search
+// still running for an older position is cancelled. The worker publishes its best move
+// through a single atomic word, so hint_engine_peek can be called every frame without
+// locking or waiting.
+//
+// The same worker also finds whole winning lines on request (hint_engine_request_line),
+// so a front end never searches on its own thread.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+#include "tablebase.h"
+#include "solver.h"
+
+typedef enum {
+    HintNone,     // Nothing found yet (or no legal move)
+    HintGuess,    // Most promising move by the solver's move ordering, still searching
+    HintWinning,  // First move of a line that wins (fair mode: wins at least half the samples)
+    HintNoWin     // The search proved the game can not be won from here (fair mode: in any sample)
+} HintKind;
+
+typedef struct Hint {
+    uint32_t generation; // Matches the value hint_engine_request returned
+    HintKind kind;
+    Move move;           // Engine move, foundations are 7 + suit
+} Hint;
+
+typedef struct HintEngine HintEngine;
+
+// node_limit bounds each search, tt_mb is the worker's transposition table. In fair mode
+// positions with face down cards are hinted by determinize.h, which never looks at them.
+// tablebase is optional and must stay open until the engine is destroyed.
+HintEngine* hint_engine_create(uint64_t node_limit, size_t tt_mb, bool fair, const Tablebase* tablebase);
+void hint_engine_destroy(HintEngine* engine);
+
+uint32_t hint_engine_request(HintEngine* engine, const GameState* state);
+Hint hint_engine_peek(const HintEngine* engine);
+
+// The solver hint_engine_request_line uses, typically a beam search; set it once, before
+// the first line request. Its stop flag is replaced by the engine's own, so a newer request
+// cancels it like a hint search. Returns false if it could not be created.
+bool hint_engine_set_line_solver(HintEngine* engine, const SolverConfig* config);
+
+// Like hint_engine_request, but the worker looks for a whole winning line instead of a
+// hint (and publishes its first move as one). Returns 0 without a line solver.
+uint32_t hint_engine_request_line(HintEngine* engine, const GameState* state);
+
+// Copies the line once the worker has finished the search of generation; false while it is
+// still searching, or once a newer request cancelled it
+bool hint_engine_take_line(HintEngine* engine, uint32_t generation, SolveResult* result);
+
+#endif
@@ -0,0 +1,331 @@
+#include "mcts.h"
+#include "determinize.h"
+#include "solver.h"
+#include "platform.h"
+#include "trace.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MCTS_MAX_DEPTH 256
+#define MCTS_REWARD_ONE 65536u // Playout results are summed in fixed point
+#define MCTS_SPARE_NODES 1024  // Nodes lost when two threads add the same child at once
+
+typedef struct MctsNode {
+    _Atomic uint32_t visits;
+    _Atomic uint32_t virtual_loss;
+    _Atomic uint32_t available;   // Visits of the parent in which this move was legal
+    _Atomic uint32_t first_child; // 0 for none, node 0 is never used
+    _Atomic uint64_t reward;
+    uint32_t next_sibling;        // Written before the node is published
+    Move move;
+} MctsNode;
+
+typedef struct MctsWorker {
+    struct MctsPlayer* player;
+    int tree;
+    uint64_t rng;
+    uint32_t playouts;
+    uint64_t playout_moves;
+} MctsWorker;
+
+struct MctsPlayer {
+    MctsConfig config;
+    int thread_count;
+    int tree_count;
+    MctsWorker workers[MCTS_MAX_THREADS];
+    MctsNode* nodes;
+    uint32_t capacity;
+    uint64_t run;                 // Varies the samples from one search to the next
+
+    // State of the current search
+    GameState observed;
+    _Atomic uint32_t node_count;
+    uint32_t roots[MCTS_MAX_THREADS];
+    _Atomic int64_t playouts_left[MCTS_MAX_THREADS];
+};
+
+void mcts_default_config(MctsConfig* config) {
+    config->playouts = 20000;
+    config->threads = 0;
+    config->trees = 1;
+    config->exploration = 0.4;
+    config->virtual_loss = 3;
+    config->playout_moves = 200;
+    config->seed = 0x4D435453504C4159ull; // "MCTSPLAY"
+    config->stop = NULL;
+}
+
+MctsPlayer* mcts_create(const MctsConfig* config) {
+    MctsPlayer* player = (MctsPlayer*)calloc(1, sizeof(MctsPlayer));
+    if (player == NULL) {
+        return NULL;
+    }
+    player->config = *config;
+    player->thread_count = config->threads > 0 ? config->threads : platform_cpu_count();
+    if (player->thread_count > MCTS_MAX_THREADS) {
+        player->thread_count = MCTS_MAX_THREADS;
+    }
+    player->tree_count = config->trees < 1 ? 1 : config->trees > player->thread_count ? player->thread_count : config->trees;
+    // Every playout adds at most one node, besides the roots
+    player->capacity = config->playouts + (uint32_t)player->tree_count + MCTS_SPARE_NODES;
+    player->nodes = (MctsNode*)malloc(sizeof(MctsNode) * player->capacity);
+    if (player->nodes == NULL) {
+        free(player);
+        return NULL;
+    }
+    for (int i = 0; i < player->thread_count; i++) {
+        player->workers[i].player = player;
+        player->workers[i].tree = i % player->tree_count;
+    }
+    return player;
+}
+
+void mcts_destroy(MctsPlayer* player) {
+    if (player) {
+        free(player->nodes);
+        free(player);
+    }
+}
+
+static bool stopped(const MctsPlayer* player) {
+    return player->config.stop && atomic_load_explicit(player->config.stop, memory_order_relaxed);
+}
+
+// A fresh node from the pool, 0 once it is used up
+static uint32_t new_node(MctsPlayer* player, Move move, uint32_t available) {
+    uint32_t index = atomic_fetch_add_explicit(&player->node_count, 1, memory_order_relaxed);
+    if (index >= player->capacity) {
+        return 0;
+    }
+    MctsNode* node = &player->nodes[index];
+    atomic_store_explicit(&node->visits, 0, memory_order_relaxed);
+    atomic_store_explicit(&node->virtual_loss, 0, memory_order_relaxed);
+    atomic_store_explicit(&node->available, available, memory_order_relaxed);
+    atomic_store_explicit(&node->first_child, 0, memory_order_relaxed);
+    atomic_store_explicit(&node->reward, 0, memory_order_relaxed);
+    node->next_sibling = 0;
+    node->move = move;
+    return index;
+}
+
+static uint32_t find_child(const MctsPlayer* player, uint32_t child, Move move) {
+    for (; child != 0; child = player->nodes[child].next_sibling) {
+        if (player->nodes[child].move == move) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+// The child of parent for move, added if no other thread did it first. 0 if the pool is used up.
+static uint32_t add_child(MctsPlayer* player, MctsNode* parent, Move move) {
+    uint32_t head = atomic_load_explicit(&parent->first_child, memory_order_acquire);
+    uint32_t index = 0;
+    for (;;) {
+        uint32_t found = find_child(player, head, move);
+        if (found != 0) {
+            atomic_fetch_add_explicit(&player->nodes[found].available, 1, memory_order_relaxed);
+            return found; // A node of ours stays unused in the pool
+        }
+        if (index == 0 && (index = new_node(player, move, 1)) == 0) {
+            return 0;
+        }
+        player->nodes[index].next_sibling = head;
+        if (atomic_compare_exchange_weak_explicit(&parent->first_child, &head, index, memory_order_release,
+                                                  memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+// UCB with the in flight playouts counted as lost ones
+static double ucb(const MctsNode* node, double exploration) {
+    uint32_t visits = atomic_load_explicit(&node->visits, memory_order_relaxed) +
+                      atomic_load_explicit(&node->virtual_loss, memory_order_relaxed);
+    if (visits == 0) {
+        return 1e9;
+    }
+    uint32_t available = atomic_load_explicit(&node->available, memory_order_relaxed);
+    double mean = (double)atomic_load_explicit(&node->reward, memory_order_relaxed) / MCTS_REWARD_ONE / visits;
+    return mean + exploration * sqrt(log((double)available) / visits);
+}
+
+// Random playout: moves near the front of the solver's order are likelier, and the stack
+// just moved is never put straight back. Returns the result in MCTS_REWARD_ONE units.
+static uint32_t playout(MctsPlayer* player, MctsWorker* worker, GameState* world) {
+    Move last = MOVE_NONE;
+    for (int i = 0; i < player->config.playout_moves && !state_is_won(world); i++) {
+        Move moves[YUKON_MAX_MOVES];
+        int count = solver_ordered_moves(world, moves);
+        int kept = 0;
+        for (int j = 0; j < count; j++) {
+            if (last == MOVE_NONE || (last & MOVE_REVEAL) || PILE_IS_FOUNDATION(MOVE_TO(last)) ||
+                moves[j] != MOVE_MAKE(MOVE_TO(last), MOVE_FROM(last), MOVE_COUNT(last))) {
+                moves[kept++] = moves[j];
+            }
+        }
+        if (kept == 0) {
+            break;
+        }
+        uint32_t a = rng_below(&worker->rng, (uint32_t)kept);
+        uint32_t b = rng_below(&worker->rng, (uint32_t)kept);
+        last = state_apply_move(world, moves[a < b ? a : b]);
+        worker->playout_moves++;
+    }
+    if (state_is_won(world)) {
+        return MCTS_REWARD_ONE;
+    }
+    return (uint32_t)((uint64_t)state_foundation_count(world) * MCTS_REWARD_ONE / YUKON_CARDS);
+}
+
+static void search_once(MctsPlayer* player, MctsWorker* worker) {
+    GameState world;
+    determinize_sample(&player->observed, &worker->rng, &world);
+    uint32_t path[MCTS_MAX_DEPTH];
+    int length = 0;
+    uint32_t node = player->roots[worker->tree];
+    uint32_t virtual_loss = player->config.virtual_loss;
+    path[length++] = node;
+
+    // Down the tree over the moves legal in this deal, until a new node is added
+    bool added = false;
+    while (!added && length < MCTS_MAX_DEPTH && !state_is_won(&world)) {
+        Move moves[YUKON_MAX_MOVES];
+        uint32_t children[YUKON_MAX_MOVES];
+        int count = solver_ordered_moves(&world, moves);
+        MctsNode* parent = &player->nodes[node];
+        uint32_t head = atomic_load_explicit(&parent->first_child, memory_order_acquire);
+        int missing = -1;
+        for (int i = 0; i < count; i++) {
+            children[i] = find_child(player, head, moves[i]);
+            if (children[i] == 0 && missing < 0) {
+                missing = i;
+            }
+        }
+
+        uint32_t best = 0;
+        if (missing >= 0 && (best = add_child(player, parent, moves[missing])) != 0) {
+            added = true;
+        }
+        double best_score = -1.0;
+        for (int i = 0; i < count; i++) {
+            if (children[i] == 0) {
+                continue;
+            }
+            atomic_fetch_add_explicit(&player->nodes[children[i]].available, 1, memory_order_relaxed);
+            double score = ucb(&player->nodes[children[i]], player->config.exploration);
+            if (!added && score > best_score) {
+                best_score = score;
+                best = children[i];
+            }
+        }
+        if (best == 0) {
+            break; // No legal move, or the pool is used up
+        }
+        atomic_fetch_add_explicit(&player->nodes[best].virtual_loss, virtual_loss, memory_order_relaxed);
+        state_apply_move(&world, player->nodes[best].move);
+        path[length++] = best;
+        node = best;
+    }
+
+    uint32_t reward = playout(player, worker, &world);
+    for (int i = 0; i < length; i++) {
+        MctsNode* visited = &player->nodes[path[i]];
+        atomic_fetch_add_explicit(&visited->reward, reward, memory_order_relaxed);
+        atomic_fetch_add_explicit(&visited->visits, 1, memory_order_relaxed);
+        if (i > 0) {
+            atomic_fetch_sub_explicit(&visited->virtual_loss, virtual_loss, memory_order_relaxed);
+        }
+    }
+    worker->playouts++;
+}
+
+static void mcts_worker(void* argument) {
+    MctsWorker* worker = (MctsWorker*)argument;
+    MctsPlayer* player = worker->player;
+    bool own_thread = worker != &player->workers[0];
+    if (own_thread) {
+        trace_thread_name("mcts worker");
+    }
+    uint64_t trace_start = trace_begin();
+    while (atomic_fetch_sub_explicit(&player->playouts_left[worker->tree], 1, memory_order_relaxed) > 0 &&
+           !stopped(player)) {
+        search_once(player, worker);
+    }
+    trace_end_value("mcts search", "mcts", trace_start, worker->playouts);
+    if (own_thread) {
+        trace_thread_release();
+    }
+}
+
+bool mcts_choose(MctsPlayer* player, const GameState* observed, MctsResult* result) {
+    memset(result, 0, sizeof(*result));
+    Move moves[YUKON_MAX_MOVES];
+    int count = solver_ordered_moves(observed, moves);
+    if (count <= 1) {
+        result->move = count == 1 ? moves[0] : MOVE_NONE; // Nothing to choose
+        return true;
+    }
+
+    player->observed = *observed;
+    player->run++;
+    atomic_store(&player->node_count, 1);
+    for (int tree = 0; tree < player->tree_count; tree++) {
+        uint32_t share = player->config.playouts / (uint32_t)player->tree_count;
+        share += (uint32_t)tree < player->config.playouts % (uint32_t)player->tree_count;
+        player->roots[tree] = new_node(player, MOVE_NONE, 1);
+        atomic_store(&player->playouts_left[tree], (int64_t)share);
+    }
+    for (int i = 0; i < player->thread_count; i++) {
+        MctsWorker* worker = &player->workers[i];
+        worker->rng = player->config.seed ^ (player->run << 32) ^ ((uint64_t)(i + 1) * 0x9E3779B97F4A7C15ull);
+        worker->playouts = 0;
+        worker->playout_moves = 0;
+    }
+
+    // Workers 1.. run on their own threads, worker 0 on this one
+    PlatformThread threads[MCTS_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < player->thread_count; i++) {
+        if (platform_thread_start(&threads[started], mcts_worker, &player->workers[i])) {
+            started++;
+        }
+    }
+    mcts_worker(&player->workers[0]);
+    for (int i = 0; i < started; i++) {
+        platform_thread_join(&threads[i]);
+    }
+    if (stopped(player)) {
+        return false;
+    }
+
+    for (int i = 0; i < player->thread_count; i++) {
+        result->playouts += player->workers[i].playouts;
+        result->playout_moves += player->workers[i].playout_moves;
+    }
+    uint32_t used = atomic_load(&player->node_count);
+    result->nodes = used < player->capacity ? used - 1 : player->capacity - 1;
+
+    // The trees vote with their visits; ties keep the solver's move order
+    uint64_t best = 0;
+    result->move = moves[0];
+    for (int i = 0; i < count; i++) {
+        uint64_t visits = 0;
+        uint64_t reward = 0;
+        for (int tree = 0; tree < player->tree_count; tree++) {
+            uint32_t head = atomic_load(&player->nodes[player->roots[tree]].first_child);
+            uint32_t child = find_child(player, head, moves[i]);
+            if (child != 0) {
+                visits += atomic_load(&player->nodes[child].visits);
+                reward += atomic_load(&player->nodes[child].reward);
+            }
+        }
+        if (visits > best) {
+            best = visits;
+            result->move = moves[i];
+            result->value = (float)((double)reward / MCTS_REWARD_ONE / (double)visits);
+        }
+    }
+    return true;
+}
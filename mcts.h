@@ -0,0 +1,55 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+// Monte Carlo tree search player for the game as a player sees it, face down cards unknown.
+//
+// Every playout deals the face down cards at random (determinize_sample), walks down the
+// tree by UCB over the moves that are legal in that deal, adds one node and finishes the
+// game with a quick random playout. A node also counts how often its move was legal when
+// its parent was visited, which stands in for the parent's visits in UCB, as moves after a
+// turned card differ from deal to deal.
+//
+// Search runs in parallel two ways: several independent trees (root parallelism) whose
+// visits are added up at the end, and several threads per tree (tree parallelism). Node
+// statistics are atomics and children are pushed onto their parent's list with a compare
+// and swap, so threads never lock; a thread adds a virtual loss to every node on its path
+// until its playout is counted, so the others spread out over the tree. Nodes come from a
+// pool sized by the playout budget, so nothing is allocated during a search.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "game_state.h"
+
+#define MCTS_MAX_THREADS 64
+
+typedef struct MctsConfig {
+    uint32_t playouts;     // Per move, over all trees
+    int threads;           // 0 for one per core
+    int trees;             // Independent trees, the threads are split over them
+    double exploration;    // UCB constant
+    uint32_t virtual_loss; // Lost visits a playout in flight adds to its path
+    int playout_moves;     // Random playouts stop after this many moves
+    uint64_t seed;
+    _Atomic bool* stop;    // Optional, cancels the search
+} MctsConfig;
+
+typedef struct MctsResult {
+    Move move;             // Most visited move, MOVE_NONE if there is no legal move
+    float value;           // Its mean playout result: 1 for a win, otherwise the share of cards up
+    uint32_t playouts;
+    uint32_t nodes;
+    uint64_t playout_moves; // Moves made in the random playouts
+} MctsResult;
+
+typedef struct MctsPlayer MctsPlayer;
+
+void mcts_default_config(MctsConfig* config);
+MctsPlayer* mcts_create(const MctsConfig* config);
+void mcts_destroy(MctsPlayer* player);
+
+// Searches observed, whose face down cards are never read. Returns false if it was cancelled.
+bool mcts_choose(MctsPlayer* player, const GameState* observed, MctsResult* result);
+
+#endif
@@ -0,0 +1,80 @@
+#include "move_journal.h"
+
+void journal_init(MoveJournal* journal, Move* storage, uint32_t capacity) {
+    journal->moves = storage;
+    journal->mask = capacity - 1;
+    journal_clear(journal);
+}
+
+void journal_clear(MoveJournal* journal) {
+    journal->begin = 0;
+    journal->cursor = 0;
+    journal->end = 0;
+}
+
+void journal_record(MoveJournal* journal, Move move) {
+    journal->moves[journal->cursor & journal->mask] = move;
+    journal->cursor++;
+    journal->end = journal->cursor;
+    // Full: forget the oldest move
+    if (journal->cursor - journal->begin > journal->mask + 1) {
+        journal->begin++;
+    }
+}
+
+bool journal_can_undo(const MoveJournal* journal) {
+    return journal->cursor != journal->begin;
+}
+
+bool journal_can_redo(const MoveJournal* journal) {
+    return journal->cursor != journal->end;
+}
+
+uint32_t journal_depth(const MoveJournal* journal) {
+    return journal->cursor - journal->begin;
+}
+
+Move journal_undo(MoveJournal* journal) {
+    if (!journal_can_undo(journal)) {
+        return MOVE_NONE;
+    }
+    journal->cursor--;
+    return journal->moves[journal->cursor & journal->mask];
+}
+
+Move journal_redo(MoveJournal* journal) {
+    if (!journal_can_redo(journal)) {
+        return MOVE_NONE;
+    }
+    Move move = journal->moves[journal->cursor & journal->mask];
+    journal->cursor++;
+    return move;
+}
+
+Move journal_move_at(const MoveJournal* journal, uint32_t index) {
+    return journal->moves[(journal->begin + index) & journal->mask];
+}
+
+Move journal_apply(MoveJournal* journal, GameState* state, Move move) {
+    Move applied = state_apply_move(state, move);
+    journal_record(journal, applied);
+    return applied;
+}
+
+bool journal_undo_state(MoveJournal* journal, GameState* state) {
+    Move move = journal_undo(journal);
+    if (move == MOVE_NONE) {
+        return false;
+    }
+    state_undo_move(state, move);
+    return true;
+}
+
+bool journal_redo_state(MoveJournal* journal, GameState* state) {
+    Move move = journal_redo(journal);
+    if (move == MOVE_NONE) {
+        return false;
+    }
+    state_apply_move(state, move);
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef MOVE_JOURNAL_H
+#define MOVE_JOURNAL_H
+
+// Undo/redo history as a ring buffer of 2-byte moves.
+//
+// Each entry is the Move as applied, including MOVE_REVEAL when it turned a card face up,
+// so undoing never needs a copy of the board. The storage is supplied by the caller and
+// never reallocated; once it is full the oldest moves are forgotten.
+// The front ends, the game server and replay checking keep their games in one; the solvers
+// backtrack on their own frame stacks, which also hold the moves left to try.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+
+#define JOURNAL_DEFAULT_CAPACITY 1024
+
+typedef struct MoveJournal {
+    Move* moves;
+    uint32_t mask;   // capacity - 1, capacity is a power of two
+    uint32_t begin;  // Oldest move that can still be undone
+    uint32_t cursor; // One past the last applied move
+    uint32_t end;    // One past the last move that can be redone
+} MoveJournal;
+
+// capacity must be a power of two
+void journal_init(MoveJournal* journal, Move* storage, uint32_t capacity);
+void journal_clear(MoveJournal* journal);
+
+// Records an applied move and drops anything that could have been redone
+void journal_record(MoveJournal* journal, Move move);
+
+bool journal_can_undo(const MoveJournal* journal);
+bool journal_can_redo(const MoveJournal* journal);
+uint32_t journal_depth(const MoveJournal* journal);
+
+// Return the move to revert / re-apply, or MOVE_NONE
+Move journal_undo(MoveJournal* journal);
+Move journal_redo(MoveJournal* journal);
+
+// index 0 is the oldest move still in the journal
+Move journal_move_at(const MoveJournal* journal, uint32_t index);
+
+// Helpers that keep an engine GameState in step with the journal
+Move journal_apply(MoveJournal* journal, GameState* state, Move move);
+bool journal_undo_state(MoveJournal* journal, GameState* state);
+bool journal_redo_state(MoveJournal* journal, GameState* state);
+
+#endif
@@ -0,0 +1,178 @@
+#include "packed_state.h"
+#include "bitboard.h"
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define FOUNDATION_BASE (YUKON_RANKS + 1)
+#define FOUNDATION_STATES (FOUNDATION_BASE * FOUNDATION_BASE * FOUNDATION_BASE * FOUNDATION_BASE)
+#define HIDDEN_BASE (PACKED_MAX_HIDDEN + 1)
+#define HEADER_BITS 35       // Below 2^35: FOUNDATION_BASE to the 4th times HIDDEN_BASE to the 7th
+#define LENGTH_BITS 6
+#define SUIT_CARDS ((1ull << YUKON_RANKS) - 1)
+
+// Bits go in and come out most significant first, through a buffer of at most 39 bits
+typedef struct BitStream {
+    uint8_t* out;
+    const uint8_t* in;
+    int position;
+    uint64_t buffer;
+    int bits;
+} BitStream;
+
+static void put_bits(BitStream* stream, uint32_t value, int width) {
+    stream->buffer = (stream->buffer << width) | value;
+    stream->bits += width;
+    while (stream->bits >= 8) {
+        stream->bits -= 8;
+        stream->out[stream->position++] = (uint8_t)(stream->buffer >> stream->bits);
+    }
+}
+
+static void flush_bits(BitStream* stream) {
+    if (stream->bits > 0) {
+        stream->out[stream->position++] = (uint8_t)(stream->buffer << (8 - stream->bits));
+        stream->bits = 0;
+    }
+}
+
+static uint32_t get_bits(BitStream* stream, int width) {
+    while (stream->bits < width) {
+        stream->buffer = (stream->buffer << 8) | stream->in[stream->position++];
+        stream->bits += 8;
+    }
+    stream->bits -= width;
+    return (uint32_t)(stream->buffer >> stream->bits) & (uint32_t)((1ull << width) - 1);
+}
+
+// Without a popcount instruction in the baseline x64 target, counted in the register
+static int count_cards(uint64_t mask) {
+    mask -= (mask >> 1) & 0x5555555555555555ull;
+    mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((mask * 0x0101010101010101ull) >> 56);
+}
+
+static int lowest_card(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// Bits for an index below count; the loops over the cards step it down as count goes down
+static int index_bits(int count) {
+    int width = 0;
+    while ((1 << width) < count) {
+        width++;
+    }
+    return width;
+}
+
+// The tableau cards are the ones above each suit's foundation
+static uint64_t tableau_cards(const uint8_t foundation[YUKON_FOUNDATIONS]) {
+    uint64_t cards = 0;
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        cards |= ((SUIT_CARDS >> foundation[suit]) << foundation[suit]) << (suit * YUKON_RANKS);
+    }
+    return cards;
+}
+
+bool packed_state_encode(const GameState* state, PackedState* packed) {
+    uint64_t header = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        if (state->hidden_count[column] > PACKED_MAX_HIDDEN) {
+            return false;
+        }
+        header = header * HIDDEN_BASE + state->hidden_count[column];
+    }
+    for (int suit = YUKON_FOUNDATIONS - 1; suit >= 0; suit--) {
+        header = header * FOUNDATION_BASE + state->foundation[suit];
+    }
+
+    memset(packed, 0, sizeof(*packed));
+    BitStream stream = {packed->bytes, NULL, 0, 0, 0};
+    put_bits(&stream, (uint32_t)(header >> 32), HEADER_BITS - 32);
+    put_bits(&stream, (uint32_t)header, 32);
+    for (int column = 0; column < YUKON_COLUMNS - 1; column++) {
+        put_bits(&stream, state->column_length[column], LENGTH_BITS);
+    }
+
+    uint64_t left = tableau_cards(state->foundation);
+    int count = count_cards(left);
+    int width = index_bits(count);
+    for (int i = 0; i < count; i++) {
+        uint8_t card = state->cards[i];
+        if (width > 0 && (1 << (width - 1)) >= count - i) {
+            width--;
+        }
+        put_bits(&stream, (uint32_t)count_cards(left & (BITBOARD_CARD(card) - 1)), width);
+        left &= ~BITBOARD_CARD(card);
+    }
+    flush_bits(&stream);
+    return true;
+}
+
+bool packed_state_decode(const PackedState* packed, GameState* state) {
+    BitStream stream = {NULL, packed->bytes, 0, 0, 0};
+    uint64_t header = (uint64_t)get_bits(&stream, HEADER_BITS - 32) << 32;
+    header |= get_bits(&stream, 32);
+
+    memset(state, 0, sizeof(*state));
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        state->foundation[suit] = (uint8_t)(header % FOUNDATION_BASE);
+        header /= FOUNDATION_BASE;
+    }
+    for (int column = YUKON_COLUMNS - 1; column >= 0; column--) {
+        state->hidden_count[column] = (uint8_t)(header % HIDDEN_BASE);
+        header /= HIDDEN_BASE;
+    }
+    if (header != 0) {
+        return false;
+    }
+
+    uint64_t left = tableau_cards(state->foundation);
+    int count = count_cards(left);
+    int last = count;
+    for (int column = 0; column < YUKON_COLUMNS - 1; column++) {
+        state->column_length[column] = (uint8_t)get_bits(&stream, LENGTH_BITS);
+        last -= state->column_length[column];
+    }
+    if (last < 0) {
+        return false;
+    }
+    state->column_length[YUKON_COLUMNS - 1] = (uint8_t)last;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        if (state->hidden_count[column] > state->column_length[column]) {
+            return false;
+        }
+    }
+
+    // The tableau cards not placed yet, lowest first
+    uint8_t unplaced[YUKON_CARDS];
+    for (int i = 0; i < count; i++) {
+        unplaced[i] = (uint8_t)lowest_card(left);
+        left &= left - 1;
+    }
+    int width = index_bits(count);
+    for (int i = 0; i < count; i++) {
+        if (width > 0 && (1 << (width - 1)) >= count - i) {
+            width--;
+        }
+        uint32_t index = get_bits(&stream, width);
+        if (index >= (uint32_t)(count - i)) {
+            return false;
+        }
+        state->cards[i] = unplaced[index];
+        memmove(unplaced + index, unplaced + index + 1, (size_t)(count - i - 1) - index);
+    }
+    for (int i = count; i < YUKON_CARDS; i++) {
+        state->cards[i] = NO_CARD;
+    }
+    state_rehash(state);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef PACKED_STATE_H
+#define PACKED_STATE_H
+
+// Positions packed into 40 bytes, half of a GameState, so a search or cache holding many of
+// them keeps twice the positions in the same memory.
+//
+// The foundations are not stored as cards: they hold the lowest cards of each suit, so four
+// counts say which cards are still in the tableau. With the face down count of every column
+// (at most 6, as dealt) they make one 35 bit number. Six column lengths of 6 bits follow, the
+// seventh column has the cards left over. Then the tableau cards in GameState order, each as
+// its index among the tableau cards not placed yet, in just enough bits for how many are left:
+// 6 bits for the first ones down to none for the last. A full tableau takes 249 bits, which
+// makes 320 bits at most.
+//
+// Packing keeps the order of the columns, so a state comes back exactly as it was, and equal
+// states pack to equal bytes. The bit string is big endian, so comparing packed states with
+// memcmp orders them by their face down counts and foundations first.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+
+#define PACKED_STATE_BYTES 40
+#define PACKED_MAX_HIDDEN 6
+
+typedef struct PackedState {
+    uint8_t bytes[PACKED_STATE_BYTES];
+} PackedState;
+
+// Returns false for a state with more than PACKED_MAX_HIDDEN face down cards in a column,
+// which no deal has
+bool packed_state_encode(const GameState* state, PackedState* packed);
+
+// Rebuilds the state, hash included. Returns false when the bytes are not a packed state.
+bool packed_state_decode(const PackedState* packed, GameState* state);
+
+#endif
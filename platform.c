@@ -0,0 +1,405 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#if !defined(_WIN32)
+#define _GNU_SOURCE
+#endif
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#endif
+
+// Threads receive a heap copy of the function and argument, freed by the thread itself
+typedef struct ThreadStart {
+    PlatformThreadFunction function;
+    void* argument;
+} ThreadStart;
+
+static ThreadStart* new_thread_start(PlatformThreadFunction function, void* argument) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (start) {
+        start->function = function;
+        start->argument = argument;
+    }
+    return start;
+}
+
+static void run_thread_start(ThreadStart* start) {
+    ThreadStart copy = *start;
+    free(start);
+    copy.function(copy.argument);
+}
+
+#ifdef _WIN32
+
+void* platform_alloc_large(size_t size, bool huge_pages, bool* used_huge_pages) {
+    *used_huge_pages = false;
+    if (huge_pages) {
+        // Large pages need the "Lock pages in memory" privilege, so this often fails
+        SIZE_T large_page = GetLargePageMinimum();
+        if (large_page > 0) {
+            size_t rounded = (size + large_page - 1) / large_page * large_page;
+            void* memory = VirtualAlloc(NULL, rounded, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (memory != NULL) {
+                *used_huge_pages = true;
+                return memory;
+            }
+        }
+    }
+    // VirtualAlloc memory is page aligned and zeroed
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+void platform_free_large(void* memory, size_t size, bool used_huge_pages) {
+    (void)size;
+    (void)used_huge_pages;
+    if (memory) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+    }
+}
+
+uint64_t platform_time_ns() {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+}
+
+bool platform_map_file(const char* path, PlatformMappedFile* file) {
+    memset(file, 0, sizeof(*file));
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file->size = (size_t)size.QuadPart;
+    if (file->size == 0) {
+        CloseHandle(handle);
+        return true; // Nothing to map, data stays NULL
+    }
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle); // The mapping keeps the file open
+    if (mapping == NULL) {
+        return false;
+    }
+    file->data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (file->data == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+    file->handle = mapping;
+    return true;
+}
+
+void platform_unmap_file(PlatformMappedFile* file) {
+    if (file->data) {
+        UnmapViewOfFile(file->data);
+    }
+    if (file->handle) {
+        CloseHandle((HANDLE)file->handle);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+bool platform_replace_file(const char* from, const char* to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+bool platform_seek(FILE* file, uint64_t offset) {
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+}
+
+static DWORD WINAPI thread_main(LPVOID argument) {
+    run_thread_start((ThreadStart*)argument);
+    return 0;
+}
+
+bool platform_thread_start(PlatformThread* thread, PlatformThreadFunction function, void* argument) {
+    ThreadStart* start = new_thread_start(function, argument);
+    if (start == NULL) {
+        return false;
+    }
+    thread->handle = CreateThread(NULL, 0, thread_main, start, 0, NULL);
+    if (thread->handle == NULL) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void platform_thread_join(PlatformThread* thread) {
+    if (thread->handle) {
+        WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+        CloseHandle((HANDLE)thread->handle);
+        thread->handle = NULL;
+    }
+}
+
+int platform_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+bool platform_mutex_init(PlatformMutex* mutex) {
+    SRWLOCK* lock = (SRWLOCK*)malloc(sizeof(SRWLOCK));
+    if (lock) {
+        InitializeSRWLock(lock);
+    }
+    mutex->handle = lock;
+    return lock != NULL;
+}
+
+void platform_mutex_destroy(PlatformMutex* mutex) {
+    free(mutex->handle);
+    mutex->handle = NULL;
+}
+
+void platform_mutex_lock(PlatformMutex* mutex) {
+    AcquireSRWLockExclusive((SRWLOCK*)mutex->handle);
+}
+
+void platform_mutex_unlock(PlatformMutex* mutex) {
+    ReleaseSRWLockExclusive((SRWLOCK*)mutex->handle);
+}
+
+bool platform_condition_init(PlatformCondition* condition) {
+    CONDITION_VARIABLE* variable = (CONDITION_VARIABLE*)malloc(sizeof(CONDITION_VARIABLE));
+    if (variable) {
+        InitializeConditionVariable(variable);
+    }
+    condition->handle = variable;
+    return variable != NULL;
+}
+
+void platform_condition_destroy(PlatformCondition* condition) {
+    free(condition->handle);
+    condition->handle = NULL;
+}
+
+void platform_condition_wait(PlatformCondition* condition, PlatformMutex* mutex) {
+    SleepConditionVariableSRW((CONDITION_VARIABLE*)condition->handle, (SRWLOCK*)mutex->handle, INFINITE, 0);
+}
+
+void platform_condition_signal(PlatformCondition* condition) {
+    WakeConditionVariable((CONDITION_VARIABLE*)condition->handle);
+}
+
+void platform_condition_broadcast(PlatformCondition* condition) {
+    WakeAllConditionVariable((CONDITION_VARIABLE*)condition->handle);
+}
+
+#else
+
+void* platform_alloc_large(size_t size, bool huge_pages, bool* used_huge_pages) {
+    *used_huge_pages = false;
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        // Explicit huge pages only work when the admin reserved some (vm.nr_hugepages)
+        size_t rounded = (size + (2u << 20) - 1) & ~(size_t)((2u << 20) - 1);
+        void* memory = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            *used_huge_pages = true;
+            return memory;
+        }
+    }
+#endif
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    // Fall back to transparent huge pages where the kernel supports them
+    if (huge_pages) {
+        madvise(memory, size, MADV_HUGEPAGE);
+    }
+#endif
+    return memory;
+}
+
+void platform_free_large(void* memory, size_t size, bool used_huge_pages) {
+    if (memory == NULL) {
+        return;
+    }
+    if (used_huge_pages) {
+        size = (size + (2u << 20) - 1) & ~(size_t)((2u << 20) - 1);
+    }
+    munmap(memory, size);
+}
+
+uint64_t platform_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+bool platform_map_file(const char* path, PlatformMappedFile* file) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    file->size = (size_t)info.st_size;
+    if (file->size == 0) {
+        close(fd);
+        return true; // Nothing to map, data stays NULL
+    }
+    void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, file->size, MADV_SEQUENTIAL);
+    file->data = (const uint8_t*)data;
+    return true;
+}
+
+void platform_unmap_file(PlatformMappedFile* file) {
+    if (file->data) {
+        munmap((void*)file->data, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+bool platform_replace_file(const char* from, const char* to) {
+    return rename(from, to) == 0; // Atomic on POSIX, readers see the old file or the new one
+}
+
+bool platform_seek(FILE* file, uint64_t offset) {
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+}
+
+static void* thread_main(void* argument) {
+    run_thread_start((ThreadStart*)argument);
+    return NULL;
+}
+
+bool platform_thread_start(PlatformThread* thread, PlatformThreadFunction function, void* argument) {
+    ThreadStart* start = new_thread_start(function, argument);
+    pthread_t* handle = (pthread_t*)malloc(sizeof(pthread_t));
+    if (start == NULL || handle == NULL || pthread_create(handle, NULL, thread_main, start) != 0) {
+        free(start);
+        free(handle);
+        thread->handle = NULL;
+        return false;
+    }
+    thread->handle = handle;
+    return true;
+}
+
+void platform_thread_join(PlatformThread* thread) {
+    if (thread->handle) {
+        pthread_join(*(pthread_t*)thread->handle, NULL);
+        free(thread->handle);
+        thread->handle = NULL;
+    }
+}
+
+int platform_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+bool platform_mutex_init(PlatformMutex* mutex) {
+    pthread_mutex_t* lock = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    if (lock && pthread_mutex_init(lock, NULL) != 0) {
+        free(lock);
+        lock = NULL;
+    }
+    mutex->handle = lock;
+    return lock != NULL;
+}
+
+void platform_mutex_destroy(PlatformMutex* mutex) {
+    if (mutex->handle) {
+        pthread_mutex_destroy((pthread_mutex_t*)mutex->handle);
+        free(mutex->handle);
+        mutex->handle = NULL;
+    }
+}
+
+void platform_mutex_lock(PlatformMutex* mutex) {
+    pthread_mutex_lock((pthread_mutex_t*)mutex->handle);
+}
+
+void platform_mutex_unlock(PlatformMutex* mutex) {
+    pthread_mutex_unlock((pthread_mutex_t*)mutex->handle);
+}
+
+bool platform_condition_init(PlatformCondition* condition) {
+    pthread_cond_t* variable = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    if (variable && pthread_cond_init(variable, NULL) != 0) {
+        free(variable);
+        variable = NULL;
+    }
+    condition->handle = variable;
+    return variable != NULL;
+}
+
+void platform_condition_destroy(PlatformCondition* condition) {
+    if (condition->handle) {
+        pthread_cond_destroy((pthread_cond_t*)condition->handle);
+        free(condition->handle);
+        condition->handle = NULL;
+    }
+}
+
+void platform_condition_wait(PlatformCondition* condition, PlatformMutex* mutex) {
+    pthread_cond_wait((pthread_cond_t*)condition->handle, (pthread_mutex_t*)mutex->handle);
+}
+
+void platform_condition_signal(PlatformCondition* condition) {
+    pthread_cond_signal((pthread_cond_t*)condition->handle);
+}
+
+void platform_condition_broadcast(PlatformCondition* condition) {
+    pthread_cond_broadcast((pthread_cond_t*)condition->handle);
+}
+
+#endif
+
+// CPU feature checks depend on the compiler rather than the OS
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+
+bool platform_cpu_has_avx2() {
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+}
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+bool platform_cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+#else
+bool platform_cpu_has_avx2() {
+    return false;
+}
+#endif
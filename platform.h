@@ -0,0 +1,73 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Small portability layer shared by the engine modules.
+// Everything OS specific (Windows vs. POSIX) lives in platform.c.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define PLATFORM_CACHE_LINE 64
+
+// Large, zero-initialised, cache-line aligned allocation.
+// Tries huge/large pages first when huge_pages is true; *used_huge_pages tells whether that worked.
+void* platform_alloc_large(size_t size, bool huge_pages, bool* used_huge_pages);
+void platform_free_large(void* memory, size_t size, bool used_huge_pages);
+
+// Monotonic high resolution clock in nanoseconds
+uint64_t platform_time_ns();
+
+// Read-only memory mapping of a whole file
+typedef struct PlatformMappedFile {
+    const uint8_t* data;
+    size_t size;
+    void* handle; // File mapping handle on Windows
+} PlatformMappedFile;
+
+bool platform_map_file(const char* path, PlatformMappedFile* file);
+void platform_unmap_file(PlatformMappedFile* file);
+
+// Moves from over to, replacing it in one step, so a crash leaves either file whole
+bool platform_replace_file(const char* from, const char* to);
+
+// fseek to a 64-bit offset, as long is 32 bits on Windows
+bool platform_seek(FILE* file, uint64_t offset);
+
+// Minimal threads for the batch tools and background searches
+typedef struct PlatformThread {
+    void* handle;
+} PlatformThread;
+
+typedef void (*PlatformThreadFunction)(void* argument);
+
+bool platform_thread_start(PlatformThread* thread, PlatformThreadFunction function, void* argument);
+void platform_thread_join(PlatformThread* thread);
+int platform_cpu_count();
+
+// True when the CPU and OS support AVX2, for kernels that pick their code path at run time
+bool platform_cpu_has_avx2();
+
+// Mutex and condition variable, only meant for short critical sections and idle waits
+typedef struct PlatformMutex {
+    void* handle;
+} PlatformMutex;
+
+typedef struct PlatformCondition {
+    void* handle;
+} PlatformCondition;
+
+bool platform_mutex_init(PlatformMutex* mutex);
+void platform_mutex_destroy(PlatformMutex* mutex);
+void platform_mutex_lock(PlatformMutex* mutex);
+void platform_mutex_unlock(PlatformMutex* mutex);
+
+bool platform_condition_init(PlatformCondition* condition);
+void platform_condition_destroy(PlatformCondition* condition);
+void platform_condition_wait(PlatformCondition* condition, PlatformMutex* mutex);
+void platform_condition_signal(PlatformCondition* condition);
+void platform_condition_broadcast(PlatformCondition* condition);
+
+#endif
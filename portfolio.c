@@ -0,0 +1,155 @@
+#include "portfolio.h"
+#include "transposition_table.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PortfolioWorker {
+    struct Portfolio* portfolio;
+    int index;
+    Solver* solver;
+    SolveResult* result;
+} PortfolioWorker;
+
+struct Portfolio {
+    PortfolioConfig config;
+    PortfolioWorker workers[PORTFOLIO_MAX_STRATEGIES];
+    TranspositionTable* shared;
+
+    // State of the current solve
+    GameState start;
+    _Atomic bool stop;
+    _Atomic int winner;
+};
+
+void portfolio_default_config(PortfolioConfig* config) {
+    config->strategy_count = 4;
+    config->strategies[0] = SolverDepthFirst;
+    config->strategies[1] = SolverWeightedAStar;
+    config->strategies[2] = SolverBeam;
+    config->strategies[3] = SolverRestarts;
+    config->node_limit = 5000000;
+    config->tt_mb = 64;
+    config->shared_mb = 16;
+    config->weight = 2.0;
+    config->beam_width = 256;
+    config->seed = 0x504F5254464F4C49ull; // "PORTFOLI"
+    config->tablebase = NULL;
+}
+
+Portfolio* portfolio_create(const PortfolioConfig* config) {
+    Portfolio* portfolio = (Portfolio*)calloc(1, sizeof(Portfolio));
+    if (portfolio == NULL) {
+        return NULL;
+    }
+    portfolio->config = *config;
+    if (portfolio->config.strategy_count > PORTFOLIO_MAX_STRATEGIES) {
+        portfolio->config.strategy_count = PORTFOLIO_MAX_STRATEGIES;
+    }
+    if (config->shared_mb > 0) {
+        portfolio->shared = tt_create(config->shared_mb, TTReplaceDepthPreferred, false);
+        if (portfolio->shared == NULL) {
+            free(portfolio);
+            return NULL;
+        }
+    }
+
+    SolverConfig solver_config;
+    solver_default_config(&solver_config);
+    solver_config.node_limit = config->node_limit;
+    solver_config.tt_mb = config->tt_mb;
+    solver_config.weight = config->weight;
+    solver_config.beam_width = config->beam_width;
+    solver_config.stop = &portfolio->stop;
+    solver_config.tablebase = config->tablebase;
+    solver_config.shared = portfolio->shared;
+    for (int i = 0; i < portfolio->config.strategy_count; i++) {
+        PortfolioWorker* worker = &portfolio->workers[i];
+        worker->portfolio = portfolio;
+        worker->index = i;
+        solver_config.algorithm = config->strategies[i];
+        solver_config.seed = config->seed + (uint64_t)i; // Two restart strategies try different orders
+        worker->solver = solver_create(&solver_config);
+        worker->result = (SolveResult*)malloc(sizeof(SolveResult));
+        if (worker->solver == NULL || worker->result == NULL) {
+            portfolio_destroy(portfolio);
+            return NULL;
+        }
+    }
+    return portfolio;
+}
+
+void portfolio_destroy(Portfolio* portfolio) {
+    if (portfolio == NULL) {
+        return;
+    }
+    for (int i = 0; i < portfolio->config.strategy_count; i++) {
+        solver_destroy(portfolio->workers[i].solver);
+        free(portfolio->workers[i].result);
+    }
+    tt_destroy(portfolio->shared);
+    free(portfolio);
+}
+
+static void portfolio_worker(void* argument) {
+    PortfolioWorker* worker = (PortfolioWorker*)argument;
+    Portfolio* portfolio = worker->portfolio;
+    bool own_thread = worker != &portfolio->workers[0];
+    if (own_thread) {
+        trace_thread_name(solver_algorithm_name(portfolio->config.strategies[worker->index]));
+    }
+
+    // Every status but unknown is a definite answer; the first one stops the rest
+    if (solver_solve(worker->solver, &portfolio->start, worker->result) != SolveUnknown) {
+        int none = -1;
+        if (atomic_compare_exchange_strong(&portfolio->winner, &none, worker->index)) {
+            atomic_store(&portfolio->stop, true);
+        }
+    }
+    if (own_thread) {
+        trace_thread_release();
+    }
+}
+
+SolveStatus portfolio_solve(Portfolio* portfolio, const GameState* start, SolveResult* result, int* winner) {
+    uint64_t trace_start = trace_begin();
+    portfolio->start = *start;
+    atomic_store(&portfolio->stop, false);
+    atomic_store(&portfolio->winner, -1);
+    for (int i = 0; i < portfolio->config.strategy_count; i++) {
+        portfolio->workers[i].result->nodes = 0;
+    }
+
+    // Strategies 1.. run on their own threads, strategy 0 on this one
+    PlatformThread threads[PORTFOLIO_MAX_STRATEGIES];
+    int started = 0;
+    for (int i = 1; i < portfolio->config.strategy_count; i++) {
+        if (platform_thread_start(&threads[started], portfolio_worker, &portfolio->workers[i])) {
+            started++;
+        }
+    }
+    portfolio_worker(&portfolio->workers[0]);
+    for (int i = 0; i < started; i++) {
+        platform_thread_join(&threads[i]);
+    }
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < portfolio->config.strategy_count; i++) {
+        nodes += portfolio->workers[i].result->nodes;
+    }
+    *winner = atomic_load(&portfolio->winner);
+    if (*winner >= 0) {
+        const SolveResult* answer = portfolio->workers[*winner].result;
+        result->status = answer->status;
+        result->length = answer->length;
+        memcpy(result->line, answer->line, sizeof(Move) * answer->length);
+    }
+    else {
+        result->status = SolveUnknown;
+        result->length = 0;
+    }
+    result->nodes = nodes;
+    trace_end_value("portfolio solve", "solver", trace_start, *winner);
+    return result->status;
+}
@@ -0,0 +1,45 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+// Solver portfolio: several solver algorithms race on the same position, one thread each.
+//
+// Which algorithm settles a deal first varies by orders of magnitude from deal to deal, so
+// running them side by side and taking the first definite answer (a win, or a complete
+// proof that there is none) cuts the slow tail far more than picking any single one. The
+// first answer stops the others. All of them share a table of positions proven lost, which
+// outlives the solve, so each strategy also skips what the others already refuted.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+#include "solver.h"
+#include "tablebase.h"
+
+#define PORTFOLIO_MAX_STRATEGIES 8
+
+typedef struct PortfolioConfig {
+    int strategy_count;    // Threads, one per strategy
+    SolverAlgorithm strategies[PORTFOLIO_MAX_STRATEGIES];
+    uint64_t node_limit;   // Per strategy, 0 for none
+    size_t tt_mb;          // Per strategy
+    size_t shared_mb;      // Table of lost positions, 0 to share nothing
+    double weight;         // Weighted A*
+    int beam_width;        // Beam search
+    uint64_t seed;         // Randomized restarts
+    const Tablebase* tablebase; // Optional, shared by the strategies' solvers
+} PortfolioConfig;
+
+typedef struct Portfolio Portfolio;
+
+// Depth first search, weighted A*, beam search and randomized restarts
+void portfolio_default_config(PortfolioConfig* config);
+Portfolio* portfolio_create(const PortfolioConfig* config);
+void portfolio_destroy(Portfolio* portfolio);
+
+// Returns the first definite answer, with its line in result, or SolveUnknown once every
+// strategy gave up. result->nodes counts the nodes of all strategies. *winner is the index
+// of the strategy that answered, -1 for none.
+SolveStatus portfolio_solve(Portfolio* portfolio, const GameState* start, SolveResult* result, int* winner);
+
+#endif
@@ -0,0 +1,212 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "replay.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t get_u16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+int replay_pack_move(Move move, uint8_t out[2]) {
+    int code = MOVE_FROM(move) * YUKON_PILES + MOVE_TO(move);
+    int count = MOVE_COUNT(move);
+    if (count == 1) {
+        out[0] = (uint8_t)code;
+        return 1;
+    }
+    out[0] = (uint8_t)(0x80 | code);
+    out[1] = (uint8_t)count;
+    return 2;
+}
+
+bool replay_writer_open(ReplayWriter* writer, const char* path, bool append) {
+    memset(writer, 0, sizeof(*writer));
+
+    // Only append to files that already have a header
+    FILE* existing = append ? fopen(path, "rb") : NULL;
+    bool has_header = false;
+    if (existing) {
+        uint8_t header[REPLAY_FILE_HEADER_SIZE];
+        has_header = fread(header, 1, sizeof(header), existing) == sizeof(header) && memcmp(header, "YKRP", 4) == 0;
+        fclose(existing);
+    }
+
+    writer->file = fopen(path, has_header ? "ab" : "wb");
+    if (writer->file == NULL) {
+        return false;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, 1 << 16);
+
+    if (!has_header) {
+        uint8_t header[REPLAY_FILE_HEADER_SIZE] = { 'Y', 'K', 'R', 'P' };
+        put_u16(header + 4, REPLAY_FORMAT_VERSION);
+        put_u16(header + 6, YUKON_RULES_VERSION);
+        fwrite(header, 1, sizeof(header), writer->file);
+    }
+    return true;
+}
+
+void replay_writer_begin_game(ReplayWriter* writer, uint32_t deal_number) {
+    writer->deal_number = deal_number;
+    writer->move_count = 0;
+    writer->length = 0;
+    writer->in_game = true;
+}
+
+static void append_bytes(ReplayWriter* writer, const uint8_t* bytes, int count) {
+    if (writer->length + (size_t)count > writer->capacity) {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        uint8_t* moves = (uint8_t*)realloc(writer->moves, capacity);
+        if (moves == NULL) {
+            return;
+        }
+        writer->moves = moves;
+        writer->capacity = capacity;
+    }
+    memcpy(writer->moves + writer->length, bytes, (size_t)count);
+    writer->length += (size_t)count;
+    writer->move_count++;
+}
+
+void replay_writer_add_move(ReplayWriter* writer, Move move) {
+    uint8_t packed[2];
+    append_bytes(writer, packed, replay_pack_move(move, packed));
+}
+
+void replay_writer_add_undo(ReplayWriter* writer) {
+    uint8_t code = REPLAY_UNDO_CODE;
+    append_bytes(writer, &code, 1);
+}
+
+bool replay_writer_end_game(ReplayWriter* writer, bool won) {
+    if (!writer->in_game) {
+        return false;
+    }
+    uint8_t header[REPLAY_GAME_HEADER_SIZE];
+    put_u32(header, writer->deal_number);
+    put_u32(header + 4, writer->move_count);
+    put_u32(header + 8, (uint32_t)writer->length);
+    put_u32(header + 12, won ? REPLAY_FLAG_WON : 0);
+
+    writer->in_game = false;
+    return fwrite(header, 1, sizeof(header), writer->file) == sizeof(header) &&
+           fwrite(writer->moves, 1, writer->length, writer->file) == writer->length;
+}
+
+void replay_writer_close(ReplayWriter* writer) {
+    if (writer->in_game) {
+        replay_writer_end_game(writer, false);
+    }
+    if (writer->file) {
+        fclose(writer->file);
+    }
+    free(writer->moves);
+    memset(writer, 0, sizeof(*writer));
+}
+
+bool replay_reader_open(ReplayReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+    if (!platform_map_file(path, &reader->file)) {
+        return false;
+    }
+    if (reader->file.size < REPLAY_FILE_HEADER_SIZE || memcmp(reader->file.data, "YKRP", 4) != 0 ||
+        get_u16(reader->file.data + 4) > REPLAY_FORMAT_VERSION) {
+        platform_unmap_file(&reader->file);
+        return false;
+    }
+    reader->rules_version = get_u16(reader->file.data + 6);
+    reader->offset = REPLAY_FILE_HEADER_SIZE;
+    return true;
+}
+
+bool replay_reader_next(ReplayReader* reader, ReplayGame* game) {
+    const uint8_t* data = reader->file.data;
+    if (reader->offset + REPLAY_GAME_HEADER_SIZE > reader->file.size) {
+        return false;
+    }
+    game->deal_number = get_u32(data + reader->offset);
+    game->move_count = get_u32(data + reader->offset + 4);
+    game->length = get_u32(data + reader->offset + 8);
+    game->flags = get_u32(data + reader->offset + 12);
+    game->moves = data + reader->offset + REPLAY_GAME_HEADER_SIZE;
+
+    // A truncated last record (e.g. the writer was killed) ends the file
+    if (reader->offset + REPLAY_GAME_HEADER_SIZE + game->length > reader->file.size) {
+        return false;
+    }
+    reader->offset += REPLAY_GAME_HEADER_SIZE + game->length;
+    return true;
+}
+
+void replay_reader_rewind(ReplayReader* reader) {
+    reader->offset = REPLAY_FILE_HEADER_SIZE;
+}
+
+void replay_reader_close(ReplayReader* reader) {
+    platform_unmap_file(&reader->file);
+}
+
+void replay_cursor_init(ReplayCursor* cursor, const ReplayGame* game) {
+    cursor->at = game->moves;
+    cursor->end = game->moves + game->length;
+}
+
+bool replay_cursor_next(ReplayCursor* cursor, Move* move) {
+    if (cursor->at >= cursor->end) {
+        return false;
+    }
+    uint8_t byte = *cursor->at++;
+    int code = byte & 0x7F;
+    int count = 1;
+
+    if (byte == REPLAY_UNDO_CODE) {
+        *move = MOVE_NONE;
+        return true;
+    }
+    if (byte & 0x80) {
+        if (cursor->at >= cursor->end) {
+            return false;
+        }
+        count = *cursor->at++;
+    }
+    *move = MOVE_MAKE(code / YUKON_PILES, code % YUKON_PILES, count);
+    return true;
+}
+
+bool replay_play_game(const ReplayGame* game, GameState* state, MoveJournal* scratch) {
+    ReplayCursor cursor;
+    Move move;
+
+    state_deal(state, game->deal_number);
+    journal_clear(scratch);
+    replay_cursor_init(&cursor, game);
+    while (replay_cursor_next(&cursor, &move)) {
+        if (move == MOVE_NONE) {
+            if (!journal_undo_state(scratch, state)) {
+                return false;
+            }
+            continue;
+        }
+        if (!state_is_move_legal(state, move)) {
+            return false;
+        }
+        journal_apply(scratch, state, move);
+    }
+    return true;
+}
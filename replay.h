@@ -0,0 +1,81 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Compact binary game records.
+//
+// File:  "YKRP" | format version (u16) | rules version (u16) | 8 reserved bytes
+// Game:  deal number (u32) | move count (u32) | byte length (u32) | flags (u32) | packed moves
+// All integers are little endian.
+//
+// A move is one byte, from * 11 + to, when it moves a single card. Stacks set the high bit
+// and add a count byte. REPLAY_UNDO_CODE takes back the previous move.
+// Moves use the engine pile numbers, so foundations are 7 + suit.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+#include "move_journal.h"
+#include "platform.h"
+
+#define REPLAY_FORMAT_VERSION 1
+#define REPLAY_FILE_HEADER_SIZE 16
+#define REPLAY_GAME_HEADER_SIZE 16
+#define REPLAY_UNDO_CODE 121
+#define REPLAY_FLAG_WON 1
+
+typedef struct ReplayWriter {
+    FILE* file;
+    uint8_t* moves;        // Packed moves of the game being recorded
+    size_t length;
+    size_t capacity;
+    uint32_t deal_number;
+    uint32_t move_count;
+    bool in_game;
+} ReplayWriter;
+
+typedef struct ReplayGame {
+    uint32_t deal_number;
+    uint32_t move_count;   // Moves and undos in the stream
+    uint32_t flags;
+    uint32_t length;
+    const uint8_t* moves;  // Points into the mapped file
+} ReplayGame;
+
+typedef struct ReplayReader {
+    PlatformMappedFile file;
+    size_t offset;
+    uint16_t rules_version;
+} ReplayReader;
+
+typedef struct ReplayCursor {
+    const uint8_t* at;
+    const uint8_t* end;
+} ReplayCursor;
+
+// Returns the number of bytes written to out (1 or 2)
+int replay_pack_move(Move move, uint8_t out[2]);
+
+// append adds games to an existing file instead of starting a new one
+bool replay_writer_open(ReplayWriter* writer, const char* path, bool append);
+void replay_writer_begin_game(ReplayWriter* writer, uint32_t deal_number);
+void replay_writer_add_move(ReplayWriter* writer, Move move);
+void replay_writer_add_undo(ReplayWriter* writer);
+bool replay_writer_end_game(ReplayWriter* writer, bool won);
+void replay_writer_close(ReplayWriter* writer);
+
+bool replay_reader_open(ReplayReader* reader, const char* path);
+bool replay_reader_next(ReplayReader* reader, ReplayGame* game);
+void replay_reader_rewind(ReplayReader* reader);
+void replay_reader_close(ReplayReader* reader);
+
+void replay_cursor_init(ReplayCursor* cursor, const ReplayGame* game);
+// Sets *move to MOVE_NONE for an undo; returns false at the end of the stream
+bool replay_cursor_next(ReplayCursor* cursor, Move* move);
+
+// Deals the game and applies its moves. scratch is the undo stack and needs room for
+// the longest line in the game. Returns false if a move in the stream is illegal.
+bool replay_play_game(const ReplayGame* game, GameState* state, MoveJournal* scratch);
+
+#endif
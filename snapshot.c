@@ -0,0 +1,112 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "snapshot.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+static uint32_t snapshot_checksum(const Snapshot* snapshot) {
+    const uint8_t* bytes = (const uint8_t*)snapshot;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Snapshot, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void snapshot_capture(Snapshot* snapshot, const GameState* state, uint32_t deal_number, uint32_t move_count,
+                      const uint8_t pocket_suit[YUKON_FOUNDATIONS]) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    memcpy(snapshot->magic, "YKSV", 4);
+    snapshot->version = SNAPSHOT_VERSION;
+    snapshot->rules_version = YUKON_RULES_VERSION;
+    snapshot->deal_number = deal_number;
+    snapshot->move_count = move_count;
+    memcpy(snapshot->cards, state->cards, sizeof(snapshot->cards));
+    memcpy(snapshot->column_length, state->column_length, sizeof(snapshot->column_length));
+    memcpy(snapshot->hidden_count, state->hidden_count, sizeof(snapshot->hidden_count));
+    memcpy(snapshot->foundation, state->foundation, sizeof(snapshot->foundation));
+    memcpy(snapshot->pocket_suit, pocket_suit, sizeof(snapshot->pocket_suit));
+    snapshot->checksum = snapshot_checksum(snapshot);
+}
+
+bool snapshot_restore(const Snapshot* snapshot, GameState* state) {
+    if (memcmp(snapshot->magic, "YKSV", 4) != 0 || snapshot->version != SNAPSHOT_VERSION ||
+        snapshot->rules_version != YUKON_RULES_VERSION || snapshot->checksum != snapshot_checksum(snapshot)) {
+        return false;
+    }
+
+    // Every card must be on the board exactly once: in a column or under a foundation top
+    bool seen[YUKON_CARDS] = { false };
+    int tableau = 0;
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        if (snapshot->foundation[suit] > YUKON_RANKS) {
+            return false;
+        }
+        for (int rank = 0; rank < snapshot->foundation[suit]; rank++) {
+            seen[suit * YUKON_RANKS + rank] = true;
+        }
+    }
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        if (snapshot->hidden_count[column] > snapshot->column_length[column]) {
+            return false;
+        }
+        tableau += snapshot->column_length[column];
+    }
+    if (tableau > YUKON_CARDS) {
+        return false;
+    }
+    for (int i = 0; i < tableau; i++) {
+        uint8_t card = snapshot->cards[i];
+        if (card >= YUKON_CARDS || seen[card]) {
+            return false;
+        }
+        seen[card] = true;
+    }
+    for (int card = 0; card < YUKON_CARDS; card++) {
+        if (!seen[card]) {
+            return false;
+        }
+    }
+    // A pocket must hold a suit that is on a foundation, and no suit twice
+    for (int pocket = 0; pocket < YUKON_FOUNDATIONS; pocket++) {
+        uint8_t suit = snapshot->pocket_suit[pocket];
+        if (suit == SNAPSHOT_NO_SUIT) {
+            continue;
+        }
+        if (suit >= YUKON_FOUNDATIONS || snapshot->foundation[suit] == 0) {
+            return false;
+        }
+        for (int other = 0; other < pocket; other++) {
+            if (snapshot->pocket_suit[other] == suit) {
+                return false;
+            }
+        }
+    }
+
+    memset(state, 0, sizeof(*state));
+    memcpy(state->cards, snapshot->cards, (size_t)tableau);
+    memcpy(state->column_length, snapshot->column_length, sizeof(state->column_length));
+    memcpy(state->hidden_count, snapshot->hidden_count, sizeof(state->hidden_count));
+    memcpy(state->foundation, snapshot->foundation, sizeof(state->foundation));
+    state_rehash(state);
+    return true;
+}
+
+bool snapshot_save(const Snapshot* snapshot, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fwrite(snapshot, sizeof(*snapshot), 1, file) == 1;
+    return fclose(file) == 0 && ok;
+}
+
+bool snapshot_load(Snapshot* snapshot, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fread(snapshot, sizeof(*snapshot), 1, file) == 1;
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Fixed-size save games.
+//
+// A snapshot is the 96 byte struct below written as is, so saving and loading are one
+// write and one read with nothing to parse. Fields are little endian (every platform we
+// build for). The checksum covers everything before it, so a torn or foreign file is
+// rejected instead of producing a broken board.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_state.h"
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_SIZE 96
+#define SNAPSHOT_NO_SUIT 0xFF
+
+typedef struct Snapshot {
+    char magic[4];                          // "YKSV"
+    uint16_t version;
+    uint16_t rules_version;
+    uint32_t deal_number;
+    uint32_t move_count;                    // Moves made so far
+    uint8_t cards[YUKON_CARDS];             // Same layout as GameState
+    uint8_t column_length[YUKON_COLUMNS];
+    uint8_t hidden_count[YUKON_COLUMNS];
+    uint8_t foundation[YUKON_FOUNDATIONS];
+    uint8_t pocket_suit[YUKON_FOUNDATIONS]; // Suit held by each front end pocket, SNAPSHOT_NO_SUIT if empty
+    uint8_t reserved[2];
+    uint32_t checksum;                      // FNV-1a of the bytes before it
+} Snapshot;
+
+_Static_assert(sizeof(Snapshot) == SNAPSHOT_SIZE, "Snapshot must stay a fixed 96 bytes");
+
+void snapshot_capture(Snapshot* snapshot, const GameState* state, uint32_t deal_number, uint32_t move_count,
+                      const uint8_t pocket_suit[YUKON_FOUNDATIONS]);
+
+// Checks version, rules version, checksum and that every card is there exactly once,
+// then rebuilds the state including its hash. A game saved under other rules is refused.
+bool snapshot_restore(const Snapshot* snapshot, GameState* state);
+
+bool snapshot_save(const Snapshot* snapshot, const char* path);
+bool snapshot_load(Snapshot* snapshot, const char* path);
+
+#endif
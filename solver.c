@@ -0,0 +1,1443 @@
+#include "solver.h"
+#include "transposition_table.h"
+#include "trace.h"
+#include "deadlock.h"
+#include "packed_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SolverFrame {
+    Move moves[YUKON_MAX_MOVES];
+    uint8_t count;
+    uint8_t next;
+    Move applied; // The move of this frame currently on the board
+    bool forced;  // Only a safe foundation move was generated, so every child is expanded in full
+    int16_t relies_on; // With a shared table: shallowest path position the loss so far relied on
+    uint64_t hash;
+} SolverFrame;
+
+// A loss proven whatever the path, and one that is not proven for good (a cut off line, or a
+// position reached again that was not shared). Path positions sit in between.
+#define RELIES_NONE SOLVER_MAX_LINE
+#define RELIES_UNPROVEN -1
+
+#define STOP_CHECK_NODES 1024 // Nodes searched between looks at the stop flag
+
+// Weighted A* keeps every position it expanded, packed, with the move that led to it. Open
+// positions are only the expanded parent and the move, played again when they come up.
+typedef struct SearchNode {
+    PackedState state;
+    uint32_t parent;
+    uint16_t g;
+    Move move;
+} SearchNode;
+
+typedef struct OpenEntry {
+    uint32_t priority;     // Weighted f, ties broken by smaller h
+    uint32_t parent;       // Node the position is a child of, UINT32_MAX for the start
+    Move move;
+} OpenEntry;
+
+#define PN_INFINITE 0x3FFFFFFFu
+#define PN_PATH_FILTER 4096 // Path positions counted per top 12 hash bits
+
+// Proof number search keeps the numbers of every child of the positions on its path
+typedef struct PnsFrame {
+    Move moves[YUKON_MAX_MOVES];
+    uint32_t pn[YUKON_MAX_MOVES];          // Proof numbers: 0 won, otherwise at least the heuristic
+    uint32_t dn[YUKON_MAX_MOVES];          // Disproof numbers: 0 lost, otherwise positions left to refute
+    int16_t relies_lo[YUKON_MAX_MOVES];    // Lost children: shallowest path position the loss relied on
+    int16_t relies_hi[YUKON_MAX_MOVES];    // and the deepest, -1 none
+    uint8_t count;
+    uint8_t child;         // The child being searched
+    Move applied;          // The move to it, as applied
+    uint32_t pn_threshold;
+    uint32_t dn_threshold;
+    uint32_t serial;       // Tells apart the positions that were at this depth over time
+    uint64_t hash;
+    uint64_t start_nodes;  // Nodes when the position was entered, for the work it took
+} PnsFrame;
+
+// Beam search keeps the states of one layer, and the move into every position of each layer
+typedef struct BeamCandidate {
+    int32_t score;
+    uint32_t parent;       // Position in the current layer
+    Move move;
+} BeamCandidate;
+
+typedef struct BeamStep {
+    uint32_t parent;       // Position in the layer before
+    Move move;             // As applied
+} BeamStep;
+
+struct Solver {
+    SolverConfig config;
+    TranspositionTable* tt;
+    int32_t search_id;     // Stored in the table so entries from earlier solves never match
+    int32_t first_id;      // Ids first_id..search_id are this search's, checkpoints start a new one
+    SolverFrame* stack;
+    SearchNode* nodes;     // Weighted A* storage, grown on demand and kept between solves
+    size_t node_capacity;
+    OpenEntry* open;
+    size_t open_capacity;
+    PnsFrame* pns_stack;   // Proof number search path, allocated on first use
+    uint32_t pns_serial;
+    uint16_t path_filter[PN_PATH_FILTER];  // Also used by depth first search with a shared table
+    uint64_t node_cap;     // Node limit of the current restart, 0 for none
+    uint64_t next_stop_check; // Node count at which the stop flag is read next
+    uint64_t rng;          // Shuffles the move order during restarts
+    bool shuffle;
+    GameState* beam;       // Beam search layers and line steps, allocated on first use
+    BeamStep* beam_steps;
+    BeamCandidate* candidates;
+    uint8_t* frontier;     // Checkpoint encoding of the depth first path, allocated on first use
+    VisitedFilter* filter; // Depth first visited set instead of the table, with filter_states
+};
+
+void solver_default_config(SolverConfig* config) {
+    config->algorithm = SolverDepthFirst;
+    config->weight = 2.0;
+    config->node_limit = 5000000;
+    config->tt_mb = 64;
+    config->huge_pages = false;
+    config->stop = NULL;
+    config->tablebase = NULL;
+    config->pruning = true;
+    config->beam_width = 256;
+    config->seed = 0x524553544152545Full; // "RESTART_"
+    config->shared = NULL;
+    config->checkpoint = NULL;
+    config->checkpoint_context = NULL;
+    config->checkpoint_nodes = 50000000;
+    config->filter_states = 0;
+    config->filter_rate = 0.01;
+}
+
+Solver* solver_create(const SolverConfig* config) {
+    Solver* solver = (Solver*)calloc(1, sizeof(Solver));
+    if (solver == NULL) {
+        return NULL;
+    }
+    solver->config = *config;
+    solver->tt = tt_create(config->tt_mb, TTReplaceAging, config->huge_pages);
+    solver->stack = (SolverFrame*)malloc(sizeof(SolverFrame) * SOLVER_MAX_LINE);
+    if (config->filter_states > 0) {
+        solver->filter = visited_filter_create(config->filter_states, config->filter_rate, config->huge_pages);
+    }
+    if (solver->tt == NULL || solver->stack == NULL || (config->filter_states > 0 && solver->filter == NULL)) {
+        solver_destroy(solver);
+        return NULL;
+    }
+    return solver;
+}
+
+void solver_destroy(Solver* solver) {
+    if (solver) {
+        tt_destroy(solver->tt);
+        free(solver->stack);
+        free(solver->nodes);
+        free(solver->open);
+        free(solver->pns_stack);
+        free(solver->beam);
+        free(solver->beam_steps);
+        free(solver->candidates);
+        free(solver->frontier);
+        visited_filter_destroy(solver->filter);
+        free(solver);
+    }
+}
+
+const char* solve_status_name(SolveStatus status) {
+    switch (status) {
+    case SolveWon: return "won";
+    case SolveUnsolvable: return "unsolvable";
+    default: return "unknown";
+    }
+}
+
+static const char* algorithm_names[] = { "dfs", "ida", "wastar", "pns", "beam", "restart" };
+
+const char* solver_algorithm_name(SolverAlgorithm algorithm) {
+    return algorithm_names[algorithm];
+}
+
+bool solver_algorithm_from_string(const char* text, SolverAlgorithm* algorithm) {
+    for (int i = 0; i < (int)(sizeof(algorithm_names) / sizeof(algorithm_names[0])); i++) {
+        if (strcmp(text, algorithm_names[i]) == 0) {
+            *algorithm = (SolverAlgorithm)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Common budget check: node limit and the optional stop flag. The flag is read once
+// STOP_CHECK_NODES more nodes have been searched, however many a step adds at a time.
+static bool out_of_budget(Solver* solver, uint64_t nodes) {
+    if (solver->config.node_limit != 0 && nodes >= solver->config.node_limit) {
+        return true;
+    }
+    if (solver->node_cap != 0 && nodes >= solver->node_cap) {
+        return true;
+    }
+    if (solver->config.stop == NULL || nodes < solver->next_stop_check) {
+        return false;
+    }
+    solver->next_stop_check = nodes + STOP_CHECK_NODES;
+    return atomic_load_explicit(solver->config.stop, memory_order_relaxed);
+}
+
+// Starts a search, entries stored from here on are told apart from those of earlier ones
+static void begin_search(Solver* solver) {
+    tt_new_search(solver->tt);
+    solver->search_id++;
+    solver->first_id = solver->search_id;
+}
+
+static bool is_current(const Solver* solver, int32_t id) {
+    return id >= solver->first_id && id <= solver->search_id;
+}
+
+// Duplicate check of IDA* and weighted A*: true when this search already reached the
+// position in at most g moves. Otherwise it is recorded as reached in g moves and false is
+// returned.
+static bool seen_within(Solver* solver, uint64_t key, int g) {
+    TTEntry entry;
+    if (tt_probe(solver->tt, key, &entry) && is_current(solver, entry.value) && entry.move <= g) {
+        return true;
+    }
+    entry.value = solver->search_id;
+    entry.move = (uint16_t)g;
+    entry.depth = 1;
+    entry.bound = TTBoundExact;
+    tt_store(solver->tt, key, &entry);
+    return false;
+}
+
+// Depth first search stores the move a position was expanded after, MOVE_NONE once every
+// move from it was tried
+static void mark_expanded(Solver* solver, uint64_t key, Move context) {
+    TTEntry entry;
+    entry.value = solver->search_id;
+    entry.move = context;
+    entry.depth = 1;
+    entry.bound = TTBoundExact;
+    tt_store(solver->tt, key, &entry);
+}
+
+// Returns true with the stored move in *context if the position was already explored in this solve
+static bool seen_after(Solver* solver, uint64_t key, Move* context) {
+    TTEntry entry;
+    if (tt_probe(solver->tt, key, &entry) && is_current(solver, entry.value)) {
+        *context = entry.move;
+        return true;
+    }
+    return false;
+}
+
+// The shared table only ever holds positions lost whatever the path to them
+static bool shared_lost(const Solver* solver, uint64_t key) {
+    TTEntry entry;
+    return solver->config.shared && tt_probe(solver->config.shared, key, &entry);
+}
+
+static void share_lost(const Solver* solver, uint64_t key) {
+    TTEntry entry;
+    entry.value = 0;
+    entry.move = MOVE_NONE;
+    entry.depth = 1;
+    entry.bound = TTBoundExact;
+    tt_store(solver->config.shared, key, &entry);
+}
+
+// Moves on four different piles neither enable nor block each other, and reach the same
+// position in either order
+static bool moves_commute(Move a, Move b) {
+    int a_from = MOVE_FROM(a);
+    int a_to = MOVE_TO(a);
+    int b_from = MOVE_FROM(b);
+    int b_to = MOVE_TO(b);
+    return a_from != b_from && a_from != b_to && a_to != b_from && a_to != b_to;
+}
+
+// Commuting moves that sort below context are tried by the parent, with context after them
+static bool commutes_below(Move context, Move move) {
+    Move last = MOVE_WITHOUT_FLAGS(context);
+    return context != MOVE_NONE && move < last && moves_commute(move, last);
+}
+
+// Moves not worth trying right after context: the commuting ones sorting below it, and the
+// move that puts the stack back where it was (unless that turned a card face up)
+static bool is_pruned_after(Move context, Move move) {
+    Move last = MOVE_WITHOUT_FLAGS(context);
+    if (context != MOVE_NONE && !(context & MOVE_REVEAL) && !PILE_IS_FOUNDATION(MOVE_TO(last)) &&
+        move == MOVE_MAKE(MOVE_TO(last), MOVE_FROM(last), MOVE_COUNT(last))) {
+        return true;
+    }
+    return commutes_below(context, move);
+}
+
+// A card can go to the foundation without losing anything once both cards it could
+// hold in the tableau (next lower rank, other colour) are on their foundations
+static bool is_safe_foundation_move(const GameState* state, uint8_t card) {
+    int rank = CARD_RANK(card);
+    int other = CARD_IS_RED(card) ? 2 : 0;
+    return state->foundation[other] >= rank && state->foundation[other + 1] >= rank;
+}
+
+static bool fits_on(uint8_t card, uint8_t target) {
+    return CARD_RANK(card) + 1 == CARD_RANK(target) && CARD_IS_RED(card) != CARD_IS_RED(target);
+}
+
+static int move_priority(const GameState* state, Move move, const int start[YUKON_COLUMNS]) {
+    int from = MOVE_FROM(move);
+    int moved_at = state->column_length[from] - MOVE_COUNT(move);
+    if (PILE_IS_FOUNDATION(MOVE_TO(move))) {
+        return 4;
+    }
+    if (moved_at > 0 && moved_at == state->hidden_count[from]) {
+        return 3; // Turns a card face up
+    }
+    if (moved_at == 0) {
+        return 2; // Empties a column
+    }
+    const uint8_t* column = &state->cards[start[from]];
+    if (!fits_on(column[moved_at], column[moved_at - 1])) {
+        return 1; // Puts an out of sequence card in order
+    }
+    return 0; // Only splits a sequence
+}
+
+// Sets *forced when a safe foundation move came back alone. With rng, moves of the same
+// priority come in random order.
+static int ordered_moves(const GameState* state, Move moves[YUKON_MAX_MOVES], bool dominance, bool* forced, uint64_t* rng) {
+    int start[YUKON_COLUMNS];
+    int count = state_generate_moves(state, moves);
+
+    // Safe foundation moves are forced: try only the first one
+    *forced = false;
+    for (int i = 0; i < count && dominance; i++) {
+        Move move = moves[i];
+        if (!PILE_IS_FOUNDATION(MOVE_TO(move))) {
+            break; // Foundation moves come first
+        }
+        int suit = MOVE_TO(move) - PILE_FOUNDATION;
+        if (is_safe_foundation_move(state, (uint8_t)(suit * YUKON_RANKS + state->foundation[suit]))) {
+            moves[0] = move;
+            *forced = true;
+            return 1;
+        }
+    }
+
+    for (int column = 0, offset = 0; column < YUKON_COLUMNS; column++) {
+        start[column] = offset;
+        offset += state->column_length[column];
+    }
+
+    // Stable insertion sort by priority, highest first
+    int priority[YUKON_MAX_MOVES];
+    for (int i = 0; i < count; i++) {
+        Move move = moves[i];
+        int value = move_priority(state, move, start) * 256 + (rng ? (int)(rng_next(rng) & 255) : 0);
+        int j = i;
+        while (j > 0 && priority[j - 1] < value) {
+            moves[j] = moves[j - 1];
+            priority[j] = priority[j - 1];
+            j--;
+        }
+        moves[j] = move;
+        priority[j] = value;
+    }
+    return count;
+}
+
+int solver_ordered_moves(const GameState* state, Move moves[YUKON_MAX_MOVES]) {
+    bool forced;
+    return ordered_moves(state, moves, true, &forced, NULL);
+}
+
+int solver_heuristic(const GameState* state) {
+    int estimate = state_tableau_count(state);
+    int position = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        // Lowest rank seen so far per suit, walking up from the bottom of the column
+        int lowest[YUKON_FOUNDATIONS] = { YUKON_RANKS, YUKON_RANKS, YUKON_RANKS, YUKON_RANKS };
+        bool blocked = false;
+        for (int i = 0; i < state->column_length[column]; i++) {
+            uint8_t card = state->cards[position + i];
+            int suit = CARD_SUIT(card);
+            if (CARD_RANK(card) > lowest[suit]) {
+                blocked = true;
+            }
+            else {
+                lowest[suit] = CARD_RANK(card);
+            }
+        }
+        estimate += blocked;
+        position += state->column_length[column];
+    }
+    return estimate;
+}
+
+// Appends the tablebase line from a covered won position to the length moves already in
+// result->line. False if it does not fit.
+static bool finish_from_tablebase(const Solver* solver, const GameState* state, int length, SolveResult* result) {
+    int rest = tablebase_line(solver->config.tablebase, state, &result->line[length], SOLVER_MAX_LINE - length);
+    if (rest < 0) {
+        return false;
+    }
+    result->length = (uint32_t)(length + rest);
+    return true;
+}
+
+static void expand(Solver* solver, const GameState* state, SolverFrame* frame) {
+    frame->count = (uint8_t)ordered_moves(state, frame->moves, solver->config.pruning, &frame->forced,
+                                          solver->shuffle ? &solver->rng : NULL);
+    frame->next = 0;
+    frame->applied = MOVE_NONE;
+    frame->relies_on = RELIES_NONE;
+    frame->hash = state->hash;
+}
+
+// Depth first expansion of the position reached after context. A position explored before
+// after another move (explored) only gets the commuting moves that one skipped; the move
+// back leads to a position that is already explored. Returns the move to store for the
+// position: MOVE_NONE once no commuting move was skipped, so no position is expanded more
+// than twice. A loss of the position relies on the parent when any move was left out.
+static Move expand_after(Solver* solver, const GameState* state, SolverFrame* frame, int parent, Move context, const Move* explored) {
+    expand(solver, state, frame);
+    if (explored) {
+        frame->relies_on = RELIES_UNPROVEN; // The moves of the first visit are not shared
+    }
+    if (frame->forced) {
+        frame->count = explored ? 0 : frame->count; // The forced move does not depend on context
+        return MOVE_NONE;
+    }
+    int count = frame->count;
+    int kept = 0;
+    bool skipped = false;
+    for (int i = 0; i < frame->count; i++) {
+        Move move = frame->moves[i];
+        if (explored ? commutes_below(*explored, move) : !is_pruned_after(context, move)) {
+            frame->moves[kept++] = move;
+        }
+        else if (!explored && commutes_below(context, move)) {
+            skipped = true;
+        }
+    }
+    frame->count = (uint8_t)kept;
+    if (!explored && kept < count) {
+        frame->relies_on = (int16_t)parent;
+    }
+    return skipped ? context : MOVE_NONE;
+}
+
+// A child of the position at depth lost, relying on path position relies_on
+static void add_reliance(SolverFrame* frame, int depth, int relies_on) {
+    if (relies_on < depth && relies_on < frame->relies_on) {
+        frame->relies_on = (int16_t)relies_on;
+    }
+}
+
+// Path position holding this hash, or RELIES_UNPROVEN. The filter skips the walk for almost
+// every position.
+static int path_index(const Solver* solver, uint64_t hash, int depth) {
+    if (solver->path_filter[hash >> 52] == 0) {
+        return RELIES_UNPROVEN;
+    }
+    for (int i = depth; i >= 0; i--) {
+        if (solver->stack[i].hash == hash) {
+            return i;
+        }
+    }
+    return RELIES_UNPROVEN;
+}
+
+// Every move from the position at depth was tried and lost. It is shared when the loss relied
+// on no path position, and otherwise the parent's loss relies on the same one.
+static void backed_up(Solver* solver, int depth) {
+    SolverFrame* frame = &solver->stack[depth];
+    solver->path_filter[frame->hash >> 52]--;
+    if (frame->relies_on == RELIES_NONE) {
+        share_lost(solver, frame->hash);
+    }
+    else if (depth > 0) {
+        add_reliance(&solver->stack[depth - 1], depth - 1, frame->relies_on);
+    }
+}
+
+// Checkpoint encoding of the path: a version byte and the frame count (16 bits), then per
+// frame its forced flag, the number of moves left to try, the move to the next frame (all
+// but the last frame) and the moves left. Moves are 16 bits, little endian.
+#define FRONTIER_VERSION 1
+#define FRONTIER_CAPACITY (3 + SOLVER_MAX_LINE * (2 + 2 * (YUKON_MAX_MOVES + 1)))
+
+static void put16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t get16(const uint8_t* in) {
+    return (uint16_t)(in[0] | in[1] << 8);
+}
+
+// Hands the path to the checkpoint function. The moves of the frames below depth are on the
+// board, the last frame has none. Entries stored from here on get a new id.
+static void save_progress(Solver* solver, const GameState* start, int depth, bool truncated, bool stopping,
+                          const SolveResult* result) {
+    if (solver->frontier == NULL) {
+        solver->frontier = (uint8_t*)malloc(FRONTIER_CAPACITY);
+        if (solver->frontier == NULL) {
+            return;
+        }
+    }
+    uint8_t* out = solver->frontier;
+    size_t size = 3;
+    out[0] = FRONTIER_VERSION;
+    put16(out + 1, (uint16_t)(depth + 1));
+    for (int i = 0; i <= depth; i++) {
+        const SolverFrame* frame = &solver->stack[i];
+        out[size++] = frame->forced;
+        out[size++] = (uint8_t)(frame->count - frame->next);
+        int first = i < depth ? frame->next - 1 : frame->next;
+        for (int m = first; m < frame->count; m++) {
+            put16(out + size, frame->moves[m]);
+            size += 2;
+        }
+    }
+
+    SolverProgress progress;
+    progress.start_hash = start->hash;
+    progress.nodes = result->nodes;
+    progress.first_id = solver->first_id;
+    progress.last_id = solver->search_id;
+    progress.truncated = truncated;
+    progress.stopping = stopping;
+    progress.frontier = out;
+    progress.frontier_size = size;
+    solver->config.checkpoint(&progress, solver->config.checkpoint_context);
+    solver->search_id++;
+}
+
+// With a shared table every frame also tracks which path positions its loss relied on: a
+// move back onto the path, or moves pruning left to the parent. A position whose loss relied
+// on none of them is lost whatever the path and goes in the shared table.
+//
+// With filtering the visited filter stands in for the table. It keeps no move orders, so new
+// positions are expanded in full, and no losses are shared or checkpoints saved: a false
+// positive skips a position never explored, which proves nothing.
+//
+// Runs from a path already set up, state being the position of the frame at depth.
+static SolveStatus depth_first_from(Solver* solver, const GameState* start, GameState state, int depth, bool truncated,
+                                    bool filtering, SolveResult* result) {
+    SolverFrame* stack = solver->stack;
+    bool sharing = solver->config.shared != NULL && !filtering;
+    bool checkpoints = solver->config.checkpoint != NULL && solver->config.checkpoint_nodes > 0 && !solver->shuffle &&
+                       !filtering;
+    uint64_t next_checkpoint = result->nodes + solver->config.checkpoint_nodes;
+
+    while (depth >= 0) {
+        SolverFrame* frame = &stack[depth];
+        if (checkpoints && result->nodes >= next_checkpoint) {
+            save_progress(solver, start, depth, truncated, false, result);
+            next_checkpoint = result->nodes + solver->config.checkpoint_nodes;
+        }
+        if (frame->next == frame->count) {
+            // Every move from here failed, back up one level
+            if (sharing) {
+                backed_up(solver, depth);
+            }
+            depth--;
+            if (depth >= 0) {
+                state_undo_move(&state, stack[depth].applied);
+            }
+            continue;
+        }
+
+        frame->applied = state_apply_move(&state, frame->moves[frame->next++]);
+        result->nodes++;
+
+        if (state_is_won(&state)) {
+            for (int i = 0; i <= depth; i++) {
+                result->line[i] = stack[i].applied;
+            }
+            result->length = (uint32_t)depth + 1;
+            result->status = SolveWon;
+            return SolveWon;
+        }
+        if (out_of_budget(solver, result->nodes)) {
+            if (checkpoints) {
+                // The move is tried again after a resume
+                state_undo_move(&state, frame->applied);
+                frame->next--;
+                save_progress(solver, start, depth, truncated, true, result);
+            }
+            return SolveUnknown;
+        }
+        int known = tablebase_probe(solver->config.tablebase, &state);
+        if (known != TABLEBASE_NOT_FOUND) {
+            if (known != TABLEBASE_LOST) {
+                for (int i = 0; i <= depth; i++) {
+                    result->line[i] = stack[i].applied;
+                }
+                if (finish_from_tablebase(solver, &state, depth + 1, result)) {
+                    return SolveWon;
+                }
+                truncated = true;
+                frame->relies_on = RELIES_UNPROVEN;
+            }
+            state_undo_move(&state, frame->applied);
+            continue;
+        }
+        if (depth + 1 >= SOLVER_MAX_LINE) {
+            truncated = true;
+            frame->relies_on = RELIES_UNPROVEN;
+            state_undo_move(&state, frame->applied);
+            continue;
+        }
+        if (shared_lost(solver, state.hash)) {
+            state_undo_move(&state, frame->applied);
+            continue;
+        }
+        if (filtering) {
+            if (!visited_filter_check_and_add(solver->filter, state.hash)) {
+                expand(solver, &state, &stack[++depth]);
+                continue;
+            }
+            state_undo_move(&state, frame->applied);
+            continue;
+        }
+        // Children of a forced move are expanded in full: the parent did not try the other orders
+        Move context = solver->config.pruning && !frame->forced ? frame->applied : MOVE_NONE;
+        Move explored;
+        if (!seen_after(solver, state.hash, &explored)) {
+            mark_expanded(solver, state.hash, expand_after(solver, &state, &stack[depth + 1], depth, context, NULL));
+            depth++;
+            if (sharing) {
+                solver->path_filter[state.hash >> 52]++;
+            }
+            continue;
+        }
+        if (explored != context && explored != MOVE_NONE) {
+            expand_after(solver, &state, &stack[depth + 1], depth, context, &explored);
+            mark_expanded(solver, state.hash, MOVE_NONE);
+            if (stack[depth + 1].count > 0) {
+                depth++;
+                if (sharing) {
+                    solver->path_filter[state.hash >> 52]++;
+                }
+                continue;
+            }
+        }
+        if (sharing) {
+            add_reliance(frame, depth, path_index(solver, state.hash, depth));
+        }
+        state_undo_move(&state, frame->applied);
+    }
+
+    // Positions cut off by the line limit or skipped by the filter were not really explored
+    return truncated || filtering ? SolveUnknown : SolveUnsolvable;
+}
+
+static SolveStatus solve_depth_first(Solver* solver, const GameState* start, SolveResult* result) {
+    // Restarts search the same positions many times over, so they keep to the table
+    bool filtering = solver->filter != NULL && !solver->shuffle;
+    begin_search(solver);
+    if (filtering) {
+        visited_filter_clear(solver->filter);
+        visited_filter_check_and_add(solver->filter, start->hash);
+        expand(solver, start, &solver->stack[0]);
+        return depth_first_from(solver, start, *start, 0, false, true, result);
+    }
+    mark_expanded(solver, start->hash, MOVE_NONE);
+    expand(solver, start, &solver->stack[0]);
+    if (solver->config.shared != NULL) {
+        memset(solver->path_filter, 0, sizeof(solver->path_filter));
+        solver->path_filter[start->hash >> 52]++;
+    }
+    return depth_first_from(solver, start, *start, 0, false, false, result);
+}
+
+// Depth first search below an f bound, repeated with the smallest f that went over it.
+// Within one iteration a position reached again with no fewer moves is skipped.
+static SolveStatus solve_ida_star(Solver* solver, const GameState* start, SolveResult* result) {
+    GameState state = *start;
+    SolverFrame* stack = solver->stack;
+    int bound = solver_heuristic(&state);
+    bool truncated = false;
+
+    for (;;) {
+        int next_bound = INT32_MAX;
+        int depth = 0;
+        uint64_t trace_start = trace_begin();
+
+        begin_search(solver);
+        seen_within(solver, state.hash, 0);
+        expand(solver, &state, &stack[0]);
+
+        while (depth >= 0) {
+            SolverFrame* frame = &stack[depth];
+            if (frame->next == frame->count) {
+                depth--;
+                if (depth >= 0) {
+                    state_undo_move(&state, stack[depth].applied);
+                }
+                continue;
+            }
+
+            frame->applied = state_apply_move(&state, frame->moves[frame->next++]);
+            result->nodes++;
+            int g = depth + 1;
+
+            if (state_is_won(&state)) {
+                for (int i = 0; i <= depth; i++) {
+                    result->line[i] = stack[i].applied;
+                }
+                result->length = (uint32_t)g;
+                return SolveWon;
+            }
+            if (out_of_budget(solver, result->nodes)) {
+                return SolveUnknown;
+            }
+            // A covered endgame has an exact distance, and within the bound it is the rest of the line
+            int known = tablebase_probe(solver->config.tablebase, &state);
+            if (known == TABLEBASE_LOST) {
+                state_undo_move(&state, frame->applied);
+                continue;
+            }
+            int f = g + (known == TABLEBASE_NOT_FOUND ? solver_heuristic(&state) : known);
+            if (known != TABLEBASE_NOT_FOUND && f <= bound) {
+                for (int i = 0; i <= depth; i++) {
+                    result->line[i] = stack[i].applied;
+                }
+                if (finish_from_tablebase(solver, &state, g, result)) {
+                    return SolveWon;
+                }
+                truncated = true;
+                state_undo_move(&state, frame->applied);
+                continue;
+            }
+            if (f > bound || g >= SOLVER_MAX_LINE) {
+                if (g >= SOLVER_MAX_LINE) {
+                    truncated = true;
+                }
+                else if (f < next_bound) {
+                    next_bound = f;
+                }
+                state_undo_move(&state, frame->applied);
+                continue;
+            }
+            if (seen_within(solver, state.hash, g)) {
+                state_undo_move(&state, frame->applied);
+                continue;
+            }
+            expand(solver, &state, &stack[++depth]);
+        }
+
+        // Nothing went over the bound: every reachable position was searched
+        if (next_bound == INT32_MAX) {
+            return truncated ? SolveUnknown : SolveUnsolvable;
+        }
+        if (next_bound > SOLVER_MAX_LINE) {
+            return SolveUnknown;
+        }
+        // Iterations that end the search show as the rest of the "solve" event
+        trace_end_value("ida iteration", "solver", trace_start, bound);
+        bound = next_bound;
+    }
+}
+
+static bool reserve_nodes(Solver* solver, size_t count) {
+    if (count <= solver->node_capacity) {
+        return true;
+    }
+    size_t capacity = solver->node_capacity ? solver->node_capacity * 2 : 1 << 16;
+    SearchNode* nodes = (SearchNode*)realloc(solver->nodes, capacity * sizeof(SearchNode));
+    if (nodes == NULL) {
+        return false;
+    }
+    solver->nodes = nodes;
+    solver->node_capacity = capacity;
+    return true;
+}
+
+static bool open_push(Solver* solver, size_t* size, uint32_t priority, uint32_t parent, Move move) {
+    if (*size == solver->open_capacity) {
+        size_t capacity = solver->open_capacity ? solver->open_capacity * 2 : 1 << 16;
+        OpenEntry* open = (OpenEntry*)realloc(solver->open, capacity * sizeof(OpenEntry));
+        if (open == NULL) {
+            return false;
+        }
+        solver->open = open;
+        solver->open_capacity = capacity;
+    }
+    OpenEntry* heap = solver->open;
+    size_t i = (*size)++;
+    while (i > 0 && heap[(i - 1) / 2].priority > priority) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].priority = priority;
+    heap[i].parent = parent;
+    heap[i].move = move;
+    return true;
+}
+
+static OpenEntry open_pop(Solver* solver, size_t* size) {
+    OpenEntry* heap = solver->open;
+    OpenEntry top = heap[0];
+    OpenEntry last = heap[--(*size)];
+    size_t i = 0;
+    for (;;) {
+        size_t child = i * 2 + 1;
+        if (child >= *size) {
+            break;
+        }
+        if (child + 1 < *size && heap[child + 1].priority < heap[child].priority) {
+            child++;
+        }
+        if (heap[child].priority >= last.priority) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*size > 0) {
+        heap[i] = last;
+    }
+    return top;
+}
+
+static uint32_t astar_priority(double weight, int g, int h) {
+    // f scaled by 64 leaves room for fractional weights; the low bits prefer small h
+    uint32_t f = (uint32_t)((g + weight * h) * 64.0);
+    return (f << 6) | (uint32_t)(h < 63 ? h : 63);
+}
+
+// Best first search on g + weight * h. weight 1 gives shortest lines like IDA* but keeps
+// every position in memory; larger weights trade length for far fewer nodes.
+static SolveStatus solve_weighted_astar(Solver* solver, const GameState* start, SolveResult* result) {
+    double weight = solver->config.weight < 1.0 ? 1.0 : solver->config.weight;
+    bool truncated = false;
+    size_t node_count = 0;
+    size_t open_size = 0;
+
+    begin_search(solver);
+    seen_within(solver, start->hash, 0);
+    if (!open_push(solver, &open_size, astar_priority(weight, 0, solver_heuristic(start)), UINT32_MAX, MOVE_NONE)) {
+        return SolveUnknown;
+    }
+
+    while (open_size > 0) {
+        OpenEntry open = open_pop(solver, &open_size);
+        Move moves[YUKON_MAX_MOVES];
+        GameState state = *start;
+        int parent_g = -1;
+        if (open.parent != UINT32_MAX) {
+            packed_state_decode(&solver->nodes[open.parent].state, &state);
+            state_apply_move(&state, open.move);
+            parent_g = solver->nodes[open.parent].g;
+        }
+        if (!reserve_nodes(solver, node_count + 1)) {
+            return SolveUnknown;
+        }
+        uint32_t index = (uint32_t)node_count++;
+        SearchNode* expanded = &solver->nodes[index];
+        if (!packed_state_encode(&state, &expanded->state)) {
+            return SolveUnknown;
+        }
+        expanded->parent = open.parent;
+        expanded->g = (uint16_t)(parent_g + 1);
+        expanded->move = open.move;
+        int g = expanded->g + 1;
+
+        // The best open position is a won endgame: finish it from the tablebase
+        int known = tablebase_probe(solver->config.tablebase, &state);
+        if (known != TABLEBASE_NOT_FOUND && known != TABLEBASE_LOST) {
+            uint32_t length = solver->nodes[index].g;
+            for (uint32_t node = index; solver->nodes[node].parent != UINT32_MAX; node = solver->nodes[node].parent) {
+                result->line[--length] = solver->nodes[node].move;
+            }
+            if (finish_from_tablebase(solver, &state, solver->nodes[index].g, result)) {
+                return SolveWon;
+            }
+            truncated = true;
+            continue;
+        }
+        bool forced;
+        int count = ordered_moves(&state, moves, solver->config.pruning, &forced, NULL);
+
+        if (g > SOLVER_MAX_LINE) {
+            truncated = true;
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            Move applied = state_apply_move(&state, moves[i]);
+            result->nodes++;
+
+            if (state_is_won(&state)) {
+                // Walk back up the parents for the line
+                uint32_t length = (uint32_t)g;
+                result->line[--length] = applied;
+                for (uint32_t node = index; solver->nodes[node].parent != UINT32_MAX; node = solver->nodes[node].parent) {
+                    result->line[--length] = solver->nodes[node].move;
+                }
+                result->length = (uint32_t)g;
+                return SolveWon;
+            }
+            int h = tablebase_probe(solver->config.tablebase, &state);
+            if (h == TABLEBASE_LOST || shared_lost(solver, state.hash)) {
+                state_undo_move(&state, applied);
+                continue;
+            }
+            if (h == TABLEBASE_NOT_FOUND) {
+                h = solver_heuristic(&state);
+            }
+            if (!seen_within(solver, state.hash, g)
+                && !open_push(solver, &open_size, astar_priority(weight, g, h), index, applied)) {
+                return SolveUnknown;
+            }
+            state_undo_move(&state, applied);
+            if (out_of_budget(solver, result->nodes)) {
+                return SolveUnknown;
+            }
+        }
+    }
+    return truncated ? SolveUnknown : SolveUnsolvable;
+}
+
+// Lost positions are stored for good, unless the loss relied on a move back to a position on
+// the path: then it only holds while the deepest one (relies_hi) is still on the path. Only
+// a loss that relied on nothing at all is shared.
+static void pns_store(Solver* solver, const PnsFrame* frame, uint32_t pn, uint32_t dn, int relies_lo, int relies_hi, uint64_t nodes) {
+    TTEntry entry;
+    // Keep the positions that took the most work to evaluate
+    uint64_t work = nodes - frame->start_nodes;
+    int depth = 1;
+    while (work > 1 && depth < 64) {
+        work >>= 1;
+        depth++;
+    }
+    entry.depth = (uint8_t)depth;
+    if (dn == 0 && relies_hi < 0) {
+        entry.value = 0;
+        entry.move = 0;
+        entry.bound = TTBoundExact;
+        if (relies_lo == RELIES_NONE && solver->config.shared) {
+            share_lost(solver, frame->hash);
+        }
+    }
+    else if (dn == 0) {
+        entry.value = (int32_t)solver->pns_stack[relies_hi].serial;
+        entry.move = (uint16_t)relies_hi;
+        entry.bound = TTBoundUpper;
+    }
+    else {
+        entry.value = (int32_t)dn;
+        entry.move = (uint16_t)(pn < 0xFFFF ? pn : 0xFFFF);
+        entry.bound = TTBoundLower;
+    }
+    tt_store(solver->tt, frame->hash, &entry);
+}
+
+// Numbers of a child of the position at depth from the table. False if it is not stored,
+// or is a path dependent loss whose path position has left the path. Losses from the table
+// count as unproven for sharing, as the table does not keep what they relied on.
+static bool pns_lookup(const Solver* solver, uint64_t hash, int depth, uint32_t* pn, uint32_t* dn, int* relies_lo, int* relies_hi) {
+    TTEntry entry;
+    if (!tt_probe(solver->tt, hash, &entry)) {
+        return false;
+    }
+    if (entry.bound == TTBoundLower) {
+        *pn = entry.move;
+        *dn = (uint32_t)entry.value;
+        return true;
+    }
+    if (entry.bound == TTBoundUpper && (entry.move > depth || solver->pns_stack[entry.move].serial != (uint32_t)entry.value)) {
+        return false;
+    }
+    *pn = PN_INFINITE;
+    *dn = 0;
+    *relies_lo = RELIES_UNPROVEN;
+    *relies_hi = entry.bound == TTBoundUpper ? entry.move : -1;
+    return true;
+}
+
+// Path position holding this hash, or -1. The filter skips the walk for almost every position.
+static int pns_path_index(const Solver* solver, uint64_t hash, int depth) {
+    if (solver->path_filter[hash >> 52] == 0) {
+        return -1;
+    }
+    for (int i = depth; i >= 0; i--) {
+        if (solver->pns_stack[i].hash == hash) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Generates the children of the position at depth and numbers each one. Returns true when
+// one of them is won, with the line in result.
+static bool pns_expand(Solver* solver, GameState* state, int depth, SolveResult* result, bool* truncated) {
+    PnsFrame* frame = &solver->pns_stack[depth];
+    bool forced;
+    frame->count = (uint8_t)ordered_moves(state, frame->moves, solver->config.pruning, &forced, NULL);
+    for (int i = 0; i < frame->count; i++) {
+        Move applied = state_apply_move(state, frame->moves[i]);
+        uint32_t pn = PN_INFINITE;
+        uint32_t dn = 0;
+        int relies_lo = RELIES_NONE;
+        int relies_hi = -1;
+        result->nodes++;
+
+        int known = tablebase_probe(solver->config.tablebase, state);
+        if (state_is_won(state) || (known != TABLEBASE_NOT_FOUND && known != TABLEBASE_LOST)) {
+            for (int j = 0; j < depth; j++) {
+                result->line[j] = solver->pns_stack[j].applied;
+            }
+            result->line[depth] = applied;
+            result->length = (uint32_t)depth + 1;
+            if (state_is_won(state) || finish_from_tablebase(solver, state, depth + 1, result)) {
+                return true;
+            }
+            *truncated = true;
+            relies_lo = RELIES_UNPROVEN;
+        }
+        else if (known == TABLEBASE_LOST || shared_lost(solver, state->hash)) {
+            // Lost for good: pn and dn as set
+        }
+        else if (depth + 1 >= SOLVER_MAX_LINE) {
+            *truncated = true;
+            relies_lo = RELIES_UNPROVEN;
+        }
+        else if ((relies_hi = pns_path_index(solver, state->hash, depth)) >= 0) {
+            relies_lo = relies_hi;
+        }
+        else if (!pns_lookup(solver, state->hash, depth, &pn, &dn, &relies_lo, &relies_hi)) {
+            pn = (uint32_t)solver_heuristic(state);
+            dn = 1;
+        }
+        frame->pn[i] = pn;
+        frame->dn[i] = dn;
+        frame->relies_lo[i] = (int16_t)relies_lo;
+        frame->relies_hi[i] = (int16_t)relies_hi;
+        state_undo_move(state, applied);
+    }
+    return false;
+}
+
+// Depth first proof number search (df-pn) on an OR tree: a position's proof number is the
+// smallest of its children's, seeded with the heuristic, and its disproof number the sum of
+// theirs, so the search follows the line that looks closest to a win and stays below the
+// most promising sibling. Every position's numbers live in the transposition table, which
+// bounds the memory; an evicted position is just evaluated again.
+//
+// A move back to a position on the path never helps, so such a child counts as lost. A loss
+// that relied on that is stored with the path position, and only used while it is still on
+// the path, so no loss is ever wrong. The first won child ends the search.
+static SolveStatus solve_proof_number(Solver* solver, const GameState* start, SolveResult* result) {
+    if (solver->pns_stack == NULL) {
+        solver->pns_stack = (PnsFrame*)malloc(sizeof(PnsFrame) * SOLVER_MAX_LINE);
+        if (solver->pns_stack == NULL) {
+            return SolveUnknown;
+        }
+    }
+    PnsFrame* stack = solver->pns_stack;
+    GameState state = *start;
+    bool truncated = false;
+    int depth = 0;
+
+    // Numbers from earlier solves are not worth the risk of reusing a path dependent loss
+    tt_clear(solver->tt);
+    memset(solver->path_filter, 0, sizeof(solver->path_filter));
+    stack[0].hash = state.hash;
+    stack[0].pn_threshold = PN_INFINITE;
+    stack[0].dn_threshold = PN_INFINITE;
+    stack[0].serial = ++solver->pns_serial;
+    stack[0].start_nodes = 0;
+    solver->path_filter[state.hash >> 52]++;
+    if (pns_expand(solver, &state, 0, result, &truncated)) {
+        return SolveWon;
+    }
+
+    for (;;) {
+        PnsFrame* frame = &stack[depth];
+        uint32_t pn = PN_INFINITE;
+        uint32_t second = PN_INFINITE;
+        uint32_t dn = 0;
+        int best = 0;
+        for (int i = 0; i < frame->count; i++) {
+            if (frame->pn[i] < pn) {
+                second = pn;
+                pn = frame->pn[i];
+                best = i;
+            }
+            else if (frame->pn[i] < second) {
+                second = frame->pn[i];
+            }
+            dn += frame->dn[i];
+            if (dn >= PN_INFINITE) {
+                dn = PN_INFINITE - 1;
+            }
+        }
+
+        if (pn >= frame->pn_threshold || dn >= frame->dn_threshold) {
+            // Back up to the parent with the new numbers. A loss that only relied on this
+            // position being on the path is a real one for it.
+            int relies_lo = RELIES_NONE;
+            int relies_hi = -1;
+            for (int i = 0; i < frame->count && dn == 0; i++) {
+                if (frame->relies_lo[i] < depth) {
+                    int hi = frame->relies_hi[i] < depth ? frame->relies_hi[i] : depth - 1;
+                    relies_lo = frame->relies_lo[i] < relies_lo ? frame->relies_lo[i] : relies_lo;
+                    relies_hi = hi > relies_hi ? hi : relies_hi;
+                }
+            }
+            pns_store(solver, frame, pn, dn, relies_lo, relies_hi, result->nodes);
+            solver->path_filter[frame->hash >> 52]--;
+            if (depth == 0) {
+                return dn == 0 && !truncated ? SolveUnsolvable : SolveUnknown;
+            }
+            PnsFrame* parent = &stack[--depth];
+            state_undo_move(&state, parent->applied);
+            parent->pn[parent->child] = pn;
+            parent->dn[parent->child] = dn;
+            parent->relies_lo[parent->child] = (int16_t)relies_lo;
+            parent->relies_hi[parent->child] = (int16_t)relies_hi;
+            continue;
+        }
+        if (out_of_budget(solver, result->nodes)) {
+            return SolveUnknown;
+        }
+
+        // Search the most promising child until it looks worse than the runner up
+        frame->child = (uint8_t)best;
+        frame->applied = state_apply_move(&state, frame->moves[best]);
+        PnsFrame* next = &stack[++depth];
+        next->pn_threshold = frame->pn_threshold < second + 1 ? frame->pn_threshold : second + 1;
+        next->dn_threshold = frame->dn_threshold >= PN_INFINITE ? PN_INFINITE : frame->dn_threshold - dn + frame->dn[best];
+        next->hash = state.hash;
+        next->serial = ++solver->pns_serial;
+        next->start_nodes = result->nodes;
+        solver->path_filter[state.hash >> 52]++;
+        if (pns_expand(solver, &state, depth, result, &truncated)) {
+            return SolveWon;
+        }
+    }
+}
+
+// Beam search ranks positions by the heuristic plus four per face down card: turning cards
+// up is what opens a deal, and ranking by the heuristic alone wins about a fifth fewer deals
+static int32_t beam_score(const GameState* state) {
+    int hidden = 0;
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        hidden += state->hidden_count[column];
+    }
+    return hidden * 4 + solver_heuristic(state);
+}
+
+static int compare_candidates(const void* a, const void* b) {
+    const BeamCandidate* x = (const BeamCandidate*)a;
+    const BeamCandidate* y = (const BeamCandidate*)b;
+    if (x->score != y->score) {
+        return x->score < y->score ? -1 : 1;
+    }
+    if (x->parent != y->parent) {
+        return x->parent < y->parent ? -1 : 1; // Keeps the order of the layer
+    }
+    return (int)x->move - (int)y->move;
+}
+
+// Writes the line to the position in layer depth at index, followed by last
+static void beam_line(const Solver* solver, int depth, uint32_t index, Move last, SolveResult* result) {
+    size_t width = (size_t)solver->config.beam_width;
+    result->line[depth] = last;
+    for (int layer = depth; layer > 0; layer--) {
+        const BeamStep* step = &solver->beam_steps[(size_t)layer * width + index];
+        result->line[layer - 1] = step->move;
+        index = step->parent;
+    }
+    result->length = (uint32_t)depth + 1;
+}
+
+// Breadth first, keeping only the beam_width best scoring children of each layer. Positions
+// already kept in an earlier layer or earlier in this one are dropped, so the beam never
+// fills with transpositions. The memory is fixed by the width: two layers of states and,
+// for the line, the move into every kept position.
+static SolveStatus solve_beam(Solver* solver, const GameState* start, SolveResult* result) {
+    if (solver->config.beam_width < 1) {
+        solver->config.beam_width = 1;
+    }
+    size_t width = (size_t)solver->config.beam_width;
+    if (solver->beam == NULL) {
+        solver->beam = (GameState*)malloc(sizeof(GameState) * width * 2);
+        solver->beam_steps = (BeamStep*)malloc(sizeof(BeamStep) * width * SOLVER_MAX_LINE);
+        solver->candidates = (BeamCandidate*)malloc(sizeof(BeamCandidate) * width * YUKON_MAX_MOVES);
+        if (solver->beam == NULL || solver->beam_steps == NULL || solver->candidates == NULL) {
+            free(solver->beam);
+            free(solver->beam_steps);
+            free(solver->candidates);
+            solver->beam = NULL;
+            solver->beam_steps = NULL;
+            solver->candidates = NULL;
+            return SolveUnknown;
+        }
+    }
+    GameState* layer = solver->beam;
+    GameState* next = solver->beam + width;
+    BeamCandidate* candidates = solver->candidates;
+    size_t size = 1;
+
+    begin_search(solver);
+    mark_expanded(solver, start->hash, MOVE_NONE);
+    layer[0] = *start;
+
+    for (int depth = 0; depth < SOLVER_MAX_LINE; depth++) {
+        size_t count = 0;
+        for (size_t i = 0; i < size; i++) {
+            Move moves[YUKON_MAX_MOVES];
+            bool forced;
+            int move_count = ordered_moves(&layer[i], moves, solver->config.pruning, &forced, NULL);
+            for (int j = 0; j < move_count; j++) {
+                GameState state = layer[i];
+                Move applied = state_apply_move(&state, moves[j]);
+                Move unused;
+                result->nodes++;
+
+                int known = tablebase_probe(solver->config.tablebase, &state);
+                if (state_is_won(&state) || (known != TABLEBASE_NOT_FOUND && known != TABLEBASE_LOST)) {
+                    beam_line(solver, depth, (uint32_t)i, applied, result);
+                    if (state_is_won(&state) || finish_from_tablebase(solver, &state, depth + 1, result)) {
+                        return SolveWon;
+                    }
+                }
+                else if (known == TABLEBASE_NOT_FOUND && !shared_lost(solver, state.hash) &&
+                         !seen_after(solver, state.hash, &unused)) {
+                    candidates[count].score = beam_score(&state);
+                    candidates[count].parent = (uint32_t)i;
+                    candidates[count].move = moves[j];
+                    count++;
+                }
+                if (out_of_budget(solver, result->nodes)) {
+                    return SolveUnknown;
+                }
+            }
+        }
+        if (count == 0 || depth + 1 >= SOLVER_MAX_LINE) {
+            return SolveUnknown; // The beam died out, which proves nothing
+        }
+
+        qsort(candidates, count, sizeof(BeamCandidate), compare_candidates);
+        size_t kept = 0;
+        for (size_t i = 0; i < count && kept < width; i++) {
+            GameState state = layer[candidates[i].parent];
+            Move applied = state_apply_move(&state, candidates[i].move);
+            Move unused;
+            if (seen_after(solver, state.hash, &unused)) {
+                continue;
+            }
+            mark_expanded(solver, state.hash, MOVE_NONE);
+            next[kept] = state;
+            solver->beam_steps[(size_t)(depth + 1) * width + kept].parent = candidates[i].parent;
+            solver->beam_steps[(size_t)(depth + 1) * width + kept].move = applied;
+            kept++;
+        }
+        GameState* swap = layer;
+        layer = next;
+        next = swap;
+        size = kept;
+    }
+    return SolveUnknown;
+}
+
+// Restart lengths 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ..., which stay within a constant factor of
+// the best fixed length whatever the run time distribution
+static uint64_t luby(uint64_t i) {
+    uint64_t size = 1;
+    int sequence = 0;
+    while (size < i + 1) {
+        sequence++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) >> 1;
+        sequence--;
+        i %= size;
+    }
+    return 1ull << sequence;
+}
+
+#define RESTART_NODES 16384
+
+// Depth first search with the moves of equal priority shuffled, restarted from scratch when
+// it runs out of its share of the nodes. Search times of one deal vary by orders of magnitude
+// with the move order, so many short tries beat one long one on the hard deals. A restart
+// that ends within its share is a complete search, so it proves a deal unsolvable too.
+static SolveStatus solve_restarts(Solver* solver, const GameState* start, SolveResult* result) {
+    uint64_t limit = solver->config.node_limit;
+    SolveStatus status = SolveUnknown;
+    solver->rng = solver->config.seed ^ start->hash;
+    solver->shuffle = true;
+    for (uint64_t run = 0;; run++) {
+        uint64_t cap = result->nodes + luby(run) * RESTART_NODES;
+        solver->node_cap = limit != 0 && cap > limit ? limit : cap;
+        uint64_t trace_start = trace_begin();
+        status = solve_depth_first(solver, start, result);
+        // Stopped, out of nodes, or cut off by the line limit, which another order will not fix
+        if (status != SolveUnknown || result->nodes < solver->node_cap || (limit != 0 && result->nodes >= limit)) {
+            break;
+        }
+        trace_end_value("restart", "solver", trace_start, (int64_t)run);
+    }
+    solver->shuffle = false;
+    solver->node_cap = 0;
+    return status;
+}
+
+SolveStatus solver_solve(Solver* solver, const GameState* start, SolveResult* result) {
+    result->status = SolveUnknown;
+    result->nodes = 0;
+    solver->next_stop_check = 0;
+    result->length = 0;
+
+    if (state_is_won(start)) {
+        result->status = SolveWon;
+        return SolveWon;
+    }
+    // Dead deals are common enough that a static proof pays for itself before any search
+    if (deadlock_find(start, NULL)) {
+        result->status = SolveUnsolvable;
+        return SolveUnsolvable;
+    }
+    int known = tablebase_probe(solver->config.tablebase, start);
+    if (known == TABLEBASE_LOST) {
+        result->status = SolveUnsolvable;
+        return SolveUnsolvable;
+    }
+    if (known != TABLEBASE_NOT_FOUND && finish_from_tablebase(solver, start, 0, result)) {
+        result->status = SolveWon;
+        return SolveWon;
+    }
+    uint64_t trace_start = trace_begin();
+    switch (solver->config.algorithm) {
+    case SolverIdaStar:
+        result->status = solve_ida_star(solver, start, result);
+        break;
+    case SolverWeightedAStar:
+        result->status = solve_weighted_astar(solver, start, result);
+        break;
+    case SolverProofNumber:
+        result->status = solve_proof_number(solver, start, result);
+        break;
+    case SolverBeam:
+        result->status = solve_beam(solver, start, result);
+        break;
+    case SolverRestarts:
+        result->status = solve_restarts(solver, start, result);
+        break;
+    default:
+        result->status = solve_depth_first(solver, start, result);
+        break;
+    }
+    trace_end_value("solve", "solver", trace_start, (int64_t)result->nodes);
+    return result->status;
+}
+
+bool solver_resume(Solver* solver, const GameState* start, const SolverProgress* progress, bool table_kept,
+                   SolveResult* result) {
+    const uint8_t* in = progress->frontier;
+    size_t size = progress->frontier_size;
+    result->status = SolveUnknown;
+    result->length = 0;
+    if (solver->config.algorithm != SolverDepthFirst || progress->start_hash != start->hash || size < 3 ||
+        in[0] != FRONTIER_VERSION) {
+        return false;
+    }
+    int frames = get16(in + 1);
+    if (frames < 1 || frames > SOLVER_MAX_LINE) {
+        return false;
+    }
+
+    // Rebuild the path, checking every move against the position it is made from
+    GameState state = *start;
+    size_t at = 3;
+    for (int i = 0; i < frames; i++) {
+        SolverFrame* frame = &solver->stack[i];
+        bool last = i == frames - 1;
+        if (at + 2 > size) {
+            return false;
+        }
+        int count = in[at + 1] + (last ? 0 : 1);
+        frame->forced = in[at] != 0;
+        at += 2;
+        if (count > YUKON_MAX_MOVES || at + 2 * (size_t)count > size || (!last && count == 0)) {
+            return false;
+        }
+        for (int m = 0; m < count; m++) {
+            frame->moves[m] = get16(in + at);
+            at += 2;
+            if (!state_is_move_legal(&state, frame->moves[m])) {
+                return false;
+            }
+        }
+        frame->count = (uint8_t)count;
+        frame->next = last ? 0 : 1;
+        frame->relies_on = RELIES_UNPROVEN; // What the path relied on before is not saved
+        frame->hash = state.hash;
+        frame->applied = last ? MOVE_NONE : state_apply_move(&state, frame->moves[0]);
+    }
+    if (at != size) {
+        return false;
+    }
+
+    // The saved table holds ids up to last_id; without it the search starts over on an empty one
+    tt_new_search(solver->tt);
+    if (table_kept) {
+        solver->first_id = progress->first_id;
+        solver->search_id = progress->last_id + 1;
+    }
+    else {
+        solver->search_id++;
+        solver->first_id = solver->search_id;
+    }
+    // Path positions count as explored, each after the move that led to it, which at worst
+    // expands the moves pruning skipped once more when one is reached another way
+    state = *start;
+    if (solver->config.shared != NULL) {
+        memset(solver->path_filter, 0, sizeof(solver->path_filter));
+    }
+    for (int i = 0; i < frames; i++) {
+        const SolverFrame* frame = &solver->stack[i];
+        Move context = i > 0 && solver->config.pruning && !solver->stack[i - 1].forced ? solver->stack[i - 1].applied
+                                                                                         : MOVE_NONE;
+        Move explored;
+        if (!seen_after(solver, state.hash, &explored)) {
+            mark_expanded(solver, state.hash, context);
+        }
+        if (solver->config.shared != NULL) {
+            solver->path_filter[state.hash >> 52]++;
+        }
+        if (i < frames - 1) {
+            state_apply_move(&state, frame->moves[0]);
+        }
+    }
+
+    uint64_t trace_start = trace_begin();
+    result->nodes = progress->nodes;
+    solver->next_stop_check = 0;
+    result->status = depth_first_from(solver, start, state, frames - 1, progress->truncated, false, result);
+    trace_end_value("resume", "solver", trace_start, (int64_t)result->nodes);
+    return true;
+}
+
+TranspositionTable* solver_table(Solver* solver) {
+    return solver->tt;
+}
+
+bool solver_filter_stats(const Solver* solver, VisitedFilterStats* out) {
+    if (solver->filter == NULL) {
+        return false;
+    }
+    visited_filter_get_stats(solver->filter, out);
+    return true;
+}
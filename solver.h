@@ -0,0 +1,150 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+// Perfect information Yukon solver.
+//
+// The solver sees the face down cards, so "won" means the deal can be won by someone who
+// knows the layout, and "unsolvable" means nobody can win it. The search is a depth first
+// search on an explicit stack with a transposition table for positions already explored,
+// so a position is expanded at most once while it stays in the table.
+//
+// IDA* and weighted A* look for short lines instead. Both use solver_heuristic, a lower
+// bound on the moves still needed, so IDA* lines are the shortest possible.
+//
+// Proof number search works towards a definite answer: it keeps proof and disproof numbers
+// for every position in the transposition table, so its memory is the table size however
+// long it runs, and with no node limit it ends with won or unsolvable.
+//
+// Beam search keeps only the best beam_width positions after every move, so it is quick and
+// its memory is fixed, but it can miss wins and never proves a deal unsolvable. Randomized
+// restarts run depth first search again and again with a shuffled move order and a growing
+// node budget, which gets out of an unlucky first move far sooner than one long search.
+//
+// A shared table of lost positions lets several solvers, typically on different threads,
+// learn from each other: depth first, restart and proof number search store every position
+// they prove lost whatever the path to it, and every algorithm skips the positions in it.
+//
+// Depth first search can hand its progress to a checkpoint function every checkpoint_nodes
+// nodes: the moves on its path and those still to try below each one, a few kilobytes. A
+// solve resumed from that (solver_resume) goes on where it was, and explores again only
+// what the table no longer holds; checkpoint.h keeps these on disk, the table with them.
+//
+// With a tablebase every algorithm stops at the first endgame it covers: lost endgames are
+// pruned and won ones are finished with the tablebase line (IDA* uses the exact distance
+// as its heuristic there, so its lines stay the shortest).
+//
+// With pruning on (the default) every algorithm plays a safe foundation move as the only
+// move, and depth first search also skips move orders it has already covered: moves on
+// four different piles reach the same position in either order, so after a move only the
+// commuting moves that sort above it are tried, and a move that just puts the last stack
+// back is never tried. The table remembers which move a position was expanded after, and
+// a position reached again after a different move gets the moves it skipped the first time.
+//
+// With filter_states set, depth first search keeps the positions it has expanded in a
+// visited filter (visited_filter.h) instead of the table: several times the positions per
+// megabyte, never forgotten, but a false positive now and then skips a position never
+// explored. Such a search still finds wins, but ends with unknown rather than unsolvable,
+// expands every position in full, and shares no losses and saves no checkpoints.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "game_state.h"
+#include "tablebase.h"
+#include "transposition_table.h"
+#include "visited_filter.h"
+
+#define SOLVER_MAX_LINE 512
+
+typedef enum {
+    SolveUnknown,    // Node limit reached, the answer is not known
+    SolveWon,
+    SolveUnsolvable
+} SolveStatus;
+
+typedef enum {
+    SolverDepthFirst,     // Finds some winning line fast, proves unsolvable deals
+    SolverIdaStar,        // Iterative deepening A*, shortest lines, slow on long games
+    SolverWeightedAStar,  // Best first on g + weight * h, near shortest lines
+    SolverProofNumber,    // Depth first proof number search, settles deals within the table size
+    SolverBeam,           // Best beam_width positions per move, quick but never proves unsolvable
+    SolverRestarts        // Depth first search restarted with shuffled move orders
+} SolverAlgorithm;
+
+// Depth first search progress. Table entries the search stored up to then carry an id
+// from first_id to last_id, later ones a higher id, so a table saved while the search goes
+// on can be trimmed back to what the progress relies on.
+typedef struct SolverProgress {
+    uint64_t start_hash;
+    uint64_t nodes;
+    int32_t first_id;
+    int32_t last_id;
+    bool truncated;          // Some line was cut off, so the search can no longer prove a loss
+    bool stopping;           // The search gives up right after this one, so it must not be dropped
+    const uint8_t* frontier; // Path and moves left to try, only meaningful to solver_resume
+    size_t frontier_size;
+} SolverProgress;
+
+typedef void (*SolverCheckpointFunction)(const SolverProgress* progress, void* context);
+
+typedef struct SolverConfig {
+    SolverAlgorithm algorithm;
+    double weight;       // Weighted A* only, 1.0 is plain A*
+    uint64_t node_limit; // 0 for no limit. Weighted A* keeps up to this many positions, 12 bytes each and 48 more once expanded
+    size_t tt_mb;        // Transposition table size, all the memory proof number search uses
+    bool huge_pages;
+    _Atomic bool* stop;  // Optional, the search gives up with SolveUnknown once it is set
+    const Tablebase* tablebase; // Optional, probed instead of searching covered endgames
+    bool pruning;        // Safe foundation moves only, and no commuting move orders twice (depth first)
+    int beam_width;      // Beam search only, positions kept per move
+    uint64_t seed;       // Randomized restarts only, picks the move orders
+    TranspositionTable* shared; // Optional table of positions proven lost, safe to share between threads
+    SolverCheckpointFunction checkpoint; // Optional, called by depth first search, also when it gives up
+    void* checkpoint_context;
+    uint64_t checkpoint_nodes;  // Nodes between checkpoints
+    uint64_t filter_states;     // Depth first only: positions to size a visited filter for, 0 to use the table
+    double filter_rate;         // False positive rate of the filter once it holds filter_states positions
+} SolverConfig;
+
+typedef struct SolveResult {
+    SolveStatus status;
+    uint64_t nodes;
+    uint32_t length;
+    Move line[SOLVER_MAX_LINE]; // Moves as applied, including MOVE_REVEAL
+} SolveResult;
+
+typedef struct Solver Solver;
+
+void solver_default_config(SolverConfig* config);
+Solver* solver_create(const SolverConfig* config);
+void solver_destroy(Solver* solver);
+
+SolveStatus solver_solve(Solver* solver, const GameState* start, SolveResult* result);
+
+// Goes on with the depth first search of start that progress was saved from, counting nodes
+// from progress->nodes. table_kept tells that the solver's table holds what the search
+// stored up to then (checkpoint_load puts it back), otherwise that is explored again.
+// Returns false, without searching, when progress is not from a solve of start.
+bool solver_resume(Solver* solver, const GameState* start, const SolverProgress* progress, bool table_kept,
+                   SolveResult* result);
+
+// The solver's own transposition table, for saving it with a checkpoint
+TranspositionTable* solver_table(Solver* solver);
+
+// Memory and false positive rate of the visited filter after the last solve; false without one
+bool solver_filter_stats(const Solver* solver, VisitedFilterStats* out);
+
+// Lower bound on the moves needed to win: every card still in the tableau needs a
+// foundation move, and a column where a card lies on a lower card of its own suit needs
+// at least one more move to get it off. Returns 0 only for a won game.
+int solver_heuristic(const GameState* state);
+
+// Legal moves in the order the solver tries them; a safe foundation move comes back alone
+int solver_ordered_moves(const GameState* state, Move moves[YUKON_MAX_MOVES]);
+
+const char* solve_status_name(SolveStatus status);
+const char* solver_algorithm_name(SolverAlgorithm algorithm);
+bool solver_algorithm_from_string(const char* text, SolverAlgorithm* algorithm);
+
+#endif
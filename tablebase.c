@@ -0,0 +1,611 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "tablebase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define BUCKET_COUNT (1u << TABLEBASE_BUCKET_BITS)
+#define UNSOLVED 255 // Same byte as TABLEBASE_LOST: whatever is still unsolved at the end is lost
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, (uint16_t)value);
+    put_u16(out + 2, (uint16_t)(value >> 16));
+}
+
+static void put_u64(uint8_t* out, uint64_t value) {
+    put_u32(out, (uint32_t)value);
+    put_u32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t get_u16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return (uint32_t)get_u16(in) | ((uint32_t)get_u16(in + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    return (uint64_t)get_u32(in) | ((uint64_t)get_u32(in + 4) << 32);
+}
+
+static uint64_t keys_offset(void) {
+    // Keys start on an 8 byte boundary after the bucket index
+    return (TABLEBASE_HEADER_SIZE + (BUCKET_COUNT + 1) * 4ull + 7) & ~7ull;
+}
+
+bool tablebase_open(Tablebase* tablebase, const char* path) {
+    memset(tablebase, 0, sizeof(*tablebase));
+    if (!platform_map_file(path, &tablebase->file)) {
+        return false;
+    }
+    const uint8_t* data = tablebase->file.data;
+    size_t size = tablebase->file.size;
+    if (size < TABLEBASE_HEADER_SIZE || memcmp(data, "YKTB", 4) != 0 ||
+        get_u16(data + 4) != TABLEBASE_FORMAT_VERSION) {
+        tablebase_close(tablebase);
+        return false;
+    }
+    tablebase->rules_version = get_u16(data + 6);
+    tablebase->max_cards = get_u32(data + 8);
+    tablebase->entry_count = get_u64(data + 16);
+    uint64_t buckets = get_u64(data + 24);
+    uint64_t keys = get_u64(data + 32);
+    uint64_t values = get_u64(data + 40);
+
+    // Results from other rules would be wrong rather than just slow, so refuse them
+    if (tablebase->rules_version != YUKON_RULES_VERSION || tablebase->max_cards > TABLEBASE_MAX_CARDS ||
+        buckets + (BUCKET_COUNT + 1) * 4ull > size || keys + tablebase->entry_count * 8 > size ||
+        values + tablebase->entry_count > size) {
+        tablebase_close(tablebase);
+        return false;
+    }
+    tablebase->buckets = data + buckets;
+    tablebase->keys = data + keys;
+    tablebase->values = data + values;
+    return true;
+}
+
+void tablebase_close(Tablebase* tablebase) {
+    platform_unmap_file(&tablebase->file);
+    memset(tablebase, 0, sizeof(*tablebase));
+}
+
+bool tablebase_covers(const Tablebase* tablebase, const GameState* state) {
+    if (tablebase == NULL || tablebase->keys == NULL) {
+        return false;
+    }
+    for (int column = 0; column < YUKON_COLUMNS; column++) {
+        if (state->hidden_count[column] > 0) {
+            return false;
+        }
+    }
+    return state_tableau_count(state) <= (int)tablebase->max_cards;
+}
+
+int tablebase_probe(const Tablebase* tablebase, const GameState* state) {
+    if (!tablebase_covers(tablebase, state)) {
+        return TABLEBASE_NOT_FOUND;
+    }
+    if (state_is_won(state)) {
+        return 0;
+    }
+    uint64_t key = state->hash;
+    uint32_t bucket = (uint32_t)(key >> (64 - TABLEBASE_BUCKET_BITS));
+    uint64_t low = get_u32(tablebase->buckets + bucket * 4);
+    uint64_t high = get_u32(tablebase->buckets + (bucket + 1) * 4);
+    while (low < high) {
+        uint64_t middle = (low + high) / 2;
+        uint64_t probe = get_u64(tablebase->keys + middle * 8);
+        if (probe == key) {
+            return tablebase->values[middle];
+        }
+        if (probe < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return TABLEBASE_NOT_FOUND;
+}
+
+int tablebase_line(const Tablebase* tablebase, const GameState* state, Move* line, int max_length) {
+    int distance = tablebase_probe(tablebase, state);
+    if (distance == TABLEBASE_NOT_FOUND || distance == TABLEBASE_LOST || distance > max_length) {
+        return -1;
+    }
+    GameState current = *state;
+    int length = 0;
+    while (distance > 0) {
+        Move moves[YUKON_MAX_MOVES];
+        int count = state_generate_moves(&current, moves);
+        bool stepped = false;
+        for (int i = 0; i < count && !stepped; i++) {
+            Move applied = state_apply_move(&current, moves[i]);
+            if (tablebase_probe(tablebase, &current) == distance - 1) {
+                line[length++] = applied;
+                distance--;
+                stepped = true;
+            }
+            else {
+                state_undo_move(&current, applied);
+            }
+        }
+        if (!stepped) {
+            return -1; // Only with a damaged file
+        }
+    }
+    return length;
+}
+
+// Ways to lay out n distinct cards as at most seven columns, where the columns are not
+// ordered. Built the same way enumerate_layouts works: each card either starts a new
+// column or goes into one of the (cards so far + columns) gaps of the existing ones.
+static uint64_t layout_count(int n) {
+    uint64_t ways[YUKON_COLUMNS + 1] = { 1 };
+    for (int placed = 0; placed < n; placed++) {
+        uint64_t next[YUKON_COLUMNS + 1] = { 0 };
+        for (int columns = 0; columns <= YUKON_COLUMNS; columns++) {
+            if (ways[columns] == 0) {
+                continue;
+            }
+            next[columns] += ways[columns] * (uint64_t)(placed + columns);
+            if (columns < YUKON_COLUMNS) {
+                next[columns + 1] += ways[columns];
+            }
+        }
+        memcpy(ways, next, sizeof(ways));
+    }
+    uint64_t total = 0;
+    for (int columns = 0; columns <= YUKON_COLUMNS; columns++) {
+        total += ways[columns];
+    }
+    return total;
+}
+
+// Foundation heights leaving exactly n cards in the tableau, in a fixed order
+static int foundation_groups(int n, uint8_t groups[][YUKON_FOUNDATIONS], int capacity) {
+    int count = 0;
+    for (int a = 0; a <= YUKON_RANKS; a++) {
+        for (int b = 0; b <= YUKON_RANKS; b++) {
+            for (int c = 0; c <= YUKON_RANKS; c++) {
+                int d = 4 * YUKON_RANKS - n - a - b - c;
+                if (d < 0 || d > YUKON_RANKS) {
+                    continue;
+                }
+                if (groups != NULL && count < capacity) {
+                    groups[count][0] = (uint8_t)a;
+                    groups[count][1] = (uint8_t)b;
+                    groups[count][2] = (uint8_t)c;
+                    groups[count][3] = (uint8_t)d;
+                }
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+uint64_t tablebase_position_count(int max_cards) {
+    uint64_t total = 0;
+    for (int n = 1; n <= max_cards; n++) {
+        total += (uint64_t)foundation_groups(n, NULL, 0) * layout_count(n);
+    }
+    return total;
+}
+
+// Everything solved so far, for the foundation moves out of the next size. Open
+// addressing, a zero key marks an empty slot.
+typedef struct SolvedMap {
+    uint64_t* keys;
+    uint8_t* values;
+    uint64_t mask;
+} SolvedMap;
+
+static void solved_insert(SolvedMap* map, uint64_t key, uint8_t value) {
+    uint64_t slot = key & map->mask;
+    while (map->keys[slot] != 0 && map->keys[slot] != key) {
+        slot = (slot + 1) & map->mask;
+    }
+    map->keys[slot] = key;
+    map->values[slot] = value;
+}
+
+static int solved_lookup(const SolvedMap* map, uint64_t key) {
+    uint64_t slot = key & map->mask;
+    while (map->keys[slot] != 0) {
+        if (map->keys[slot] == key) {
+            return map->values[slot];
+        }
+        slot = (slot + 1) & map->mask;
+    }
+    return TABLEBASE_NOT_FOUND;
+}
+
+typedef struct GroupWork {
+    GameState* positions;
+    uint32_t position_count;
+    uint32_t* index;       // Local open addressing, position + 1 per slot
+    uint64_t index_mask;
+    uint32_t* successor_start;
+    uint32_t* successors;
+    size_t successor_capacity;
+    uint8_t* distance;
+
+    // Layout being built by enumerate_layouts
+    uint8_t column[YUKON_COLUMNS][TABLEBASE_MAX_CARDS];
+    uint8_t column_length[YUKON_COLUMNS];
+    int columns;
+    uint8_t cards[TABLEBASE_MAX_CARDS];
+    int card_count;
+    uint8_t foundation[YUKON_FOUNDATIONS];
+} GroupWork;
+
+typedef struct BuildJob {
+    SolvedMap solved;
+    uint8_t (*groups)[YUKON_FOUNDATIONS];
+    int group_count;
+    int cards;             // Tableau size being solved
+    uint64_t group_size;   // Positions per group
+    uint64_t* keys;        // Results of this size, group_size entries per group
+    uint8_t* values;
+    _Atomic int next_group;
+    _Atomic bool failed;
+} BuildJob;
+
+static void emit_layout(GroupWork* work) {
+    GameState* state = &work->positions[work->position_count++];
+    memset(state, 0, sizeof(*state));
+    int position = 0;
+    for (int column = 0; column < work->columns; column++) {
+        memcpy(&state->cards[position], work->column[column], work->column_length[column]);
+        state->column_length[column] = work->column_length[column];
+        position += work->column_length[column];
+    }
+    memcpy(state->foundation, work->foundation, sizeof(state->foundation));
+    state_rehash(state);
+}
+
+static void enumerate_layouts(GroupWork* work, int placed) {
+    if (placed == work->card_count) {
+        emit_layout(work);
+        return;
+    }
+    uint8_t card = work->cards[placed];
+    for (int column = 0; column < work->columns; column++) {
+        uint8_t* cards = work->column[column];
+        int length = work->column_length[column];
+        for (int at = 0; at <= length; at++) {
+            memmove(&cards[at + 1], &cards[at], (size_t)(length - at));
+            cards[at] = card;
+            work->column_length[column]++;
+            enumerate_layouts(work, placed + 1);
+            work->column_length[column]--;
+            memmove(&cards[at], &cards[at + 1], (size_t)(length - at));
+        }
+    }
+    if (work->columns < YUKON_COLUMNS) {
+        work->column[work->columns][0] = card;
+        work->column_length[work->columns++] = 1;
+        enumerate_layouts(work, placed + 1);
+        work->column_length[--work->columns] = 0;
+    }
+}
+
+static int local_find(const GroupWork* work, uint64_t key) {
+    uint64_t slot = key & work->index_mask;
+    while (work->index[slot] != 0) {
+        uint32_t position = work->index[slot] - 1;
+        if (work->positions[position].hash == key) {
+            return (int)position;
+        }
+        slot = (slot + 1) & work->index_mask;
+    }
+    return -1;
+}
+
+static bool add_successor(GroupWork* work, size_t* count, uint32_t position) {
+    if (*count == work->successor_capacity) {
+        size_t capacity = work->successor_capacity * 2;
+        uint32_t* successors = (uint32_t*)realloc(work->successors, capacity * sizeof(uint32_t));
+        if (successors == NULL) {
+            return false;
+        }
+        work->successors = successors;
+        work->successor_capacity = capacity;
+    }
+    work->successors[(*count)++] = position;
+    return true;
+}
+
+static bool solve_group(BuildJob* job, GroupWork* work, const uint8_t foundation[YUKON_FOUNDATIONS],
+                        uint64_t* keys, uint8_t* values) {
+    memcpy(work->foundation, foundation, sizeof(work->foundation));
+    work->card_count = 0;
+    for (int suit = 0; suit < YUKON_FOUNDATIONS; suit++) {
+        for (int rank = foundation[suit]; rank < YUKON_RANKS; rank++) {
+            work->cards[work->card_count++] = (uint8_t)(suit * YUKON_RANKS + rank);
+        }
+    }
+    work->position_count = 0;
+    work->columns = 0;
+    memset(work->column_length, 0, sizeof(work->column_length));
+    enumerate_layouts(work, 0);
+
+    memset(work->index, 0, (size_t)(work->index_mask + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < work->position_count; i++) {
+        uint64_t slot = work->positions[i].hash & work->index_mask;
+        while (work->index[slot] != 0) {
+            slot = (slot + 1) & work->index_mask;
+        }
+        work->index[slot] = i + 1;
+    }
+
+    // Foundation moves leave the group and have a final answer already, the best of them
+    // is the starting distance. Moves inside the group become edges.
+    size_t successor_count = 0;
+    for (uint32_t i = 0; i < work->position_count; i++) {
+        GameState state = work->positions[i];
+        Move moves[YUKON_MAX_MOVES];
+        int count = state_generate_moves(&state, moves);
+        work->successor_start[i] = (uint32_t)successor_count;
+        work->distance[i] = UNSOLVED;
+        for (int m = 0; m < count; m++) {
+            Move applied = state_apply_move(&state, moves[m]);
+            if (PILE_IS_FOUNDATION(MOVE_TO(moves[m]))) {
+                int below = job->cards == 1 ? 0 : solved_lookup(&job->solved, state.hash);
+                if (below == TABLEBASE_NOT_FOUND) {
+                    return false;
+                }
+                if (below != TABLEBASE_LOST && below + 1 < work->distance[i]) {
+                    work->distance[i] = (uint8_t)(below + 1);
+                }
+            }
+            else {
+                int position = local_find(work, state.hash);
+                if (position < 0 || !add_successor(work, &successor_count, (uint32_t)position)) {
+                    return false;
+                }
+            }
+            state_undo_move(&state, applied);
+        }
+    }
+    work->successor_start[work->position_count] = (uint32_t)successor_count;
+
+    // Relax until nothing improves; the group's move graph is small and shallow
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 0; i < work->position_count; i++) {
+            for (uint32_t s = work->successor_start[i]; s < work->successor_start[i + 1]; s++) {
+                uint8_t next = work->distance[work->successors[s]];
+                if (next < UNSOLVED - 1 && next + 1 < work->distance[i]) {
+                    work->distance[i] = (uint8_t)(next + 1);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < work->position_count; i++) {
+        keys[i] = work->positions[i].hash;
+        values[i] = work->distance[i];
+    }
+    return true;
+}
+
+static void group_work_free(GroupWork* work) {
+    free(work->positions);
+    free(work->index);
+    free(work->successor_start);
+    free(work->successors);
+    free(work->distance);
+}
+
+static bool group_work_init(GroupWork* work, uint64_t max_group_size) {
+    memset(work, 0, sizeof(*work));
+    uint64_t slots = 1;
+    while (slots < max_group_size * 2) {
+        slots *= 2;
+    }
+    work->index_mask = slots - 1;
+    work->successor_capacity = (size_t)max_group_size * 8 + 64;
+    work->positions = (GameState*)malloc((size_t)max_group_size * sizeof(GameState));
+    work->index = (uint32_t*)malloc((size_t)slots * sizeof(uint32_t));
+    work->successor_start = (uint32_t*)malloc((size_t)(max_group_size + 1) * sizeof(uint32_t));
+    work->successors = (uint32_t*)malloc(work->successor_capacity * sizeof(uint32_t));
+    work->distance = (uint8_t*)malloc((size_t)max_group_size);
+    if (work->positions == NULL || work->index == NULL || work->successor_start == NULL ||
+        work->successors == NULL || work->distance == NULL) {
+        group_work_free(work);
+        return false;
+    }
+    return true;
+}
+
+typedef struct BuildWorker {
+    BuildJob* job;
+    GroupWork work;
+} BuildWorker;
+
+static void build_worker(void* argument) {
+    BuildWorker* worker = (BuildWorker*)argument;
+    BuildJob* job = worker->job;
+    for (;;) {
+        int group = atomic_fetch_add(&job->next_group, 1);
+        if (group >= job->group_count || atomic_load(&job->failed)) {
+            break;
+        }
+        uint64_t offset = (uint64_t)group * job->group_size;
+        if (!solve_group(job, &worker->work, job->groups[group], &job->keys[offset], &job->values[offset])) {
+            atomic_store(&job->failed, true);
+        }
+    }
+}
+
+typedef struct SortedEntry {
+    uint64_t key;
+    uint8_t value;
+} SortedEntry;
+
+static int compare_entries(const void* a, const void* b) {
+    uint64_t left = ((const SortedEntry*)a)->key;
+    uint64_t right = ((const SortedEntry*)b)->key;
+    return left < right ? -1 : left > right;
+}
+
+static bool write_tablebase(const char* path, int max_cards, SortedEntry* entries, uint64_t count) {
+    qsort(entries, (size_t)count, sizeof(SortedEntry), compare_entries);
+
+    uint8_t header[TABLEBASE_HEADER_SIZE] = { 0 };
+    uint64_t keys = keys_offset();
+    uint64_t values = keys + count * 8;
+    memcpy(header, "YKTB", 4);
+    put_u16(header + 4, TABLEBASE_FORMAT_VERSION);
+    put_u16(header + 6, YUKON_RULES_VERSION);
+    put_u32(header + 8, (uint32_t)max_cards);
+    put_u64(header + 16, count);
+    put_u64(header + 24, TABLEBASE_HEADER_SIZE);
+    put_u64(header + 32, keys);
+    put_u64(header + 40, values);
+
+    uint8_t* buckets = (uint8_t*)calloc(keys - TABLEBASE_HEADER_SIZE, 1);
+    uint8_t* buffer = (uint8_t*)malloc(1 << 16);
+    FILE* file = fopen(path, "wb");
+    bool ok = buckets != NULL && buffer != NULL && file != NULL;
+    if (ok) {
+        uint64_t entry = 0;
+        for (uint32_t bucket = 0; bucket <= BUCKET_COUNT; bucket++) {
+            while (entry < count && (entries[entry].key >> (64 - TABLEBASE_BUCKET_BITS)) < bucket) {
+                entry++;
+            }
+            put_u32(buckets + bucket * 4, (uint32_t)entry);
+        }
+        ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+             fwrite(buckets, (size_t)(keys - TABLEBASE_HEADER_SIZE), 1, file) == 1;
+    }
+
+    // Keys, then values, through a 64 KB buffer
+    size_t used = 0;
+    for (uint64_t i = 0; ok && i < count; i++) {
+        put_u64(buffer + used, entries[i].key);
+        used += 8;
+        if (used == (1 << 16)) {
+            ok = fwrite(buffer, used, 1, file) == 1;
+            used = 0;
+        }
+    }
+    for (uint64_t i = 0; ok && i < count; i++) {
+        buffer[used++] = entries[i].value;
+        if (used == (1 << 16)) {
+            ok = fwrite(buffer, used, 1, file) == 1;
+            used = 0;
+        }
+    }
+    if (ok && used > 0) {
+        ok = fwrite(buffer, used, 1, file) == 1;
+    }
+    if (file != NULL && fclose(file) != 0) {
+        ok = false;
+    }
+    free(buffer);
+    free(buckets);
+    return ok;
+}
+
+bool tablebase_build(const char* path, int max_cards, int threads, TablebaseBuildStats* stats) {
+    if (max_cards < 1 || max_cards > TABLEBASE_MAX_CARDS) {
+        return false;
+    }
+    threads = threads < 1 ? 1 : threads;
+    uint64_t total = tablebase_position_count(max_cards);
+    uint64_t max_group_size = layout_count(max_cards);
+    int max_groups = foundation_groups(max_cards, NULL, 0);
+    memset(stats, 0, sizeof(*stats));
+
+    static BuildJob job;
+    memset(&job, 0, sizeof(job));
+    uint64_t slots = 1;
+    while (slots < total * 2) {
+        slots *= 2;
+    }
+    job.solved.mask = slots - 1;
+    job.solved.keys = (uint64_t*)calloc((size_t)slots, sizeof(uint64_t));
+    job.solved.values = (uint8_t*)malloc((size_t)slots);
+    job.groups = malloc((size_t)max_groups * sizeof(*job.groups));
+    job.keys = (uint64_t*)malloc((size_t)(max_groups * max_group_size) * sizeof(uint64_t));
+    job.values = (uint8_t*)malloc((size_t)(max_groups * max_group_size));
+    SortedEntry* entries = (SortedEntry*)malloc((size_t)total * sizeof(SortedEntry));
+    BuildWorker* workers = (BuildWorker*)calloc((size_t)threads, sizeof(BuildWorker));
+    PlatformThread* handles = (PlatformThread*)calloc((size_t)threads, sizeof(PlatformThread));
+    int ready = 0;
+    bool ok = job.solved.keys != NULL && job.solved.values != NULL && job.groups != NULL && job.keys != NULL &&
+              job.values != NULL && entries != NULL && workers != NULL && handles != NULL;
+    for (; ok && ready < threads; ready++) {
+        workers[ready].job = &job;
+        if (!group_work_init(&workers[ready].work, max_group_size)) {
+            ok = false;
+            break;
+        }
+    }
+
+    uint64_t entry_count = 0;
+    for (int cards = 1; ok && cards <= max_cards; cards++) {
+        job.cards = cards;
+        job.group_size = layout_count(cards);
+        job.group_count = foundation_groups(cards, job.groups, max_groups);
+        atomic_store(&job.next_group, 0);
+
+        int started = 0;
+        for (int i = 1; i < threads; i++) {
+            if (platform_thread_start(&handles[started], build_worker, &workers[i])) {
+                started++;
+            }
+        }
+        build_worker(&workers[0]);
+        for (int i = 0; i < started; i++) {
+            platform_thread_join(&handles[i]);
+        }
+        if (atomic_load(&job.failed)) {
+            ok = false;
+            break;
+        }
+
+        // Only now may the next size look these up
+        uint64_t produced = (uint64_t)job.group_count * job.group_size;
+        for (uint64_t i = 0; i < produced; i++) {
+            solved_insert(&job.solved, job.keys[i], job.values[i]);
+            entries[entry_count].key = job.keys[i];
+            entries[entry_count].value = job.values[i];
+            entry_count++;
+            if (job.values[i] == TABLEBASE_LOST) {
+                stats->lost++;
+            }
+            else if (job.values[i] > stats->longest) {
+                stats->longest = job.values[i];
+            }
+        }
+    }
+    stats->positions = entry_count;
+    ok = ok && write_tablebase(path, max_cards, entries, entry_count);
+
+    for (int i = 0; i < ready; i++) {
+        group_work_free(&workers[i].work);
+    }
+    free(handles);
+    free(workers);
+    free(entries);
+    free(job.values);
+    free(job.keys);
+    free(job.groups);
+    free(job.solved.values);
+    free(job.solved.keys);
+    return ok;
+}
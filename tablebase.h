@@ -0,0 +1,71 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+// Endgame tablebase: exact results for every position with all cards face up and at most
+// max_cards cards left in the tableau, built offline by yukon_tablebase and memory mapped.
+//
+// File:    64 byte header | bucket index | keys | values
+// Header:  "YKTB" | format (u16) | rules version (u16) | max cards (u32) | reserved (u32)
+//          | entry count (u64) | section offsets (3 x u64) | reserved
+// Buckets: (1 << 16) + 1 u32, the first entry whose key starts with each 16 bit prefix
+// Keys:    position hashes (u64), sorted
+// Values:  one byte per key, the moves needed to win with best play or TABLEBASE_LOST
+// All integers are little endian.
+//
+// Positions are keyed by their Zobrist hash, which does not depend on the order of the
+// columns, so each arrangement is stored once. A probe is one bucket lookup followed by a
+// binary search over a few dozen keys.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game_state.h"
+#include "platform.h"
+
+#define TABLEBASE_FORMAT_VERSION 1
+#define TABLEBASE_HEADER_SIZE 64
+#define TABLEBASE_BUCKET_BITS 16
+#define TABLEBASE_MAX_CARDS 8    // 8 cards is already about 65 million positions
+#define TABLEBASE_LOST 255
+#define TABLEBASE_NOT_FOUND (-1)
+
+typedef struct Tablebase {
+    PlatformMappedFile file;
+    uint32_t max_cards;
+    uint16_t rules_version;
+    uint64_t entry_count;
+    const uint8_t* buckets;
+    const uint8_t* keys;
+    const uint8_t* values;
+} Tablebase;
+
+bool tablebase_open(Tablebase* tablebase, const char* path);
+void tablebase_close(Tablebase* tablebase);
+
+// True when the position has no face down card and few enough tableau cards
+bool tablebase_covers(const Tablebase* tablebase, const GameState* state);
+
+// Moves to win with best play, TABLEBASE_LOST, or TABLEBASE_NOT_FOUND when the position
+// is not covered. A won game is 0 moves away.
+int tablebase_probe(const Tablebase* tablebase, const GameState* state);
+
+// Writes a shortest winning line from a covered position, returns its length or -1 if
+// the position is lost, not covered, or the line does not fit
+int tablebase_line(const Tablebase* tablebase, const GameState* state, Move* line, int max_length);
+
+// Number of positions a tablebase for max_cards holds
+uint64_t tablebase_position_count(int max_cards);
+
+typedef struct TablebaseBuildStats {
+    uint64_t positions;
+    uint64_t lost;
+    int longest;           // Most moves any won position needs
+} TablebaseBuildStats;
+
+// Enumerates every position by tableau size, smallest first, and solves each group of
+// positions sharing the same foundations by value iteration on its move graph: a
+// foundation move leads into the group below, which is already solved. Groups of the
+// same size are independent and solved on threads worker threads.
+bool tablebase_build(const char* path, int max_cards, int threads, TablebaseBuildStats* stats);
+
+#endif
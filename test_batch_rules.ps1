@@ -0,0 +1,47 @@
+# PowerShell script to check the terminal game's move rules in batch mode
+# Build output\yukon_terminal.exe first (build_yukon_terminal.ps1)
+
+$TERMINAL = "output\yukon_terminal.exe"
+
+# Deal 2 up to the point where 2D is on top of C5 and AD can go up from C1
+$DEAL_2_SETUP = "C2:9S->C5 C2:TD->C7 C3:AD->C1 C7:7H->C4 C7:8C->C6 C1:6D->C3"
+
+# Each case plays its commands on a deal; Rejected is the one command that must not be
+# allowed, or empty when every command must be
+$CASES = @(
+    @{ Name = "empty pocket takes no card but an ace"; Deal = 2; Commands = "C1->F1"; Rejected = "C1->F1" },
+    @{ Name = "empty pocket takes no suit another pocket holds"; Deal = 2; Commands = "$DEAL_2_SETUP C1->F1 C5->F2"; Rejected = "C5->F2" },
+    @{ Name = "pocket builds up its own suit"; Deal = 2; Commands = "$DEAL_2_SETUP C1->F1 C5->F1"; Rejected = "" }
+)
+
+if (-not (Test-Path $TERMINAL)) {
+    Write-Host "$TERMINAL not found, run build_yukon_terminal.ps1 first."
+    exit 1
+}
+
+$failed = 0
+foreach ($case in $CASES) {
+    $output = ($case.Commands | & $TERMINAL --batch - --deal $case.Deal) -join "`n"
+    $expected_exit = if ($case.Rejected -eq "") { 0 } else { 1 }
+    $passed = $LASTEXITCODE -eq $expected_exit
+    if ($case.Rejected -ne "") {
+        $passed = $passed -and $output.Contains("$($case.Rejected) not allowed") -and $output.Contains("not allowed 1")
+    }
+    if ($passed) {
+        Write-Host "ok      $($case.Name)"
+    }
+    else {
+        Write-Host "FAILED  $($case.Name)"
+        Write-Host $output
+        $failed++
+    }
+}
+
+Write-Host ""
+if ($failed -eq 0) {
+    Write-Host "All $($CASES.Count) batch rule tests passed."
+}
+else {
+    Write-Host "$failed of $($CASES.Count) batch rule tests failed."
+    exit 1
+}
@@ -0,0 +1,187 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include "trace.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int64_t value;
+    uint32_t thread_id;     // Of the thread that recorded it, a buffer has one owner after another
+} TraceEvent;
+
+// Only the owning thread writes events. count is the number of events ever written, event
+// i lives at i % TRACE_BUFFER_EVENTS, and the owner publishes each one by storing count
+// with release order. A reader that loads count with acquire order sees complete events
+// below it, and copies each one before checking count again: an event the owner may have
+// started to overwrite in the meantime is skipped.
+// Buffers are never freed, ones released by ended threads are taken over by new ones.
+typedef struct TraceBuffer {
+    struct TraceBuffer* next;
+    uint32_t thread_id;     // Current owner, only used by the owner
+    _Atomic bool in_use;
+    _Atomic uint64_t count;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+// Names given with trace_thread_name, never freed
+typedef struct TraceThreadName {
+    struct TraceThreadName* next;
+    uint32_t thread_id;
+    const char* name;
+} TraceThreadName;
+
+static _Atomic bool enabled;
+static _Atomic uint64_t origin_ns;
+static _Atomic(TraceBuffer*) buffers;
+static _Atomic(TraceThreadName*) thread_names;
+static _Atomic uint32_t thread_count;
+static THREAD_LOCAL TraceBuffer* local_buffer;
+
+void trace_enable(bool enable) {
+    uint64_t unset = 0;
+    atomic_compare_exchange_strong(&origin_ns, &unset, platform_time_ns());
+    atomic_store(&enabled, enable);
+}
+
+bool trace_is_enabled() {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+uint64_t trace_begin() {
+    return trace_is_enabled() ? platform_time_ns() : 0;
+}
+
+static TraceBuffer* thread_buffer() {
+    if (local_buffer != NULL) {
+        return local_buffer;
+    }
+    for (TraceBuffer* buffer = atomic_load(&buffers); buffer != NULL; buffer = buffer->next) {
+        bool free_buffer = false;
+        if (atomic_compare_exchange_strong(&buffer->in_use, &free_buffer, true)) {
+            buffer->thread_id = atomic_fetch_add(&thread_count, 1) + 1;
+            local_buffer = buffer;
+            return buffer;
+        }
+    }
+
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->thread_id = atomic_fetch_add(&thread_count, 1) + 1;
+    atomic_store(&buffer->in_use, true);
+    buffer->next = atomic_load(&buffers);
+    while (!atomic_compare_exchange_weak(&buffers, &buffer->next, buffer)) {
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+void trace_end_value(const char* name, const char* category, uint64_t start, int64_t value) {
+    if (start == 0) {
+        return;
+    }
+    uint64_t now = platform_time_ns();
+    TraceBuffer* buffer = thread_buffer();
+    if (buffer == NULL) {
+        return;
+    }
+    uint64_t index = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    TraceEvent* event = &buffer->events[index & (TRACE_BUFFER_EVENTS - 1)];
+    event->name = name;
+    event->category = category;
+    event->start_ns = start;
+    event->duration_ns = now - start;
+    event->value = value;
+    event->thread_id = buffer->thread_id;
+    atomic_store_explicit(&buffer->count, index + 1, memory_order_release);
+}
+
+void trace_end(const char* name, const char* category, uint64_t start) {
+    trace_end_value(name, category, start, TRACE_NO_VALUE);
+}
+
+void trace_thread_name(const char* name) {
+    if (!trace_is_enabled()) {
+        return;
+    }
+    TraceBuffer* buffer = thread_buffer();
+    TraceThreadName* entry = (TraceThreadName*)malloc(sizeof(TraceThreadName));
+    if (buffer == NULL || entry == NULL) {
+        free(entry);
+        return;
+    }
+    entry->thread_id = buffer->thread_id;
+    entry->name = name;
+    entry->next = atomic_load(&thread_names);
+    while (!atomic_compare_exchange_weak(&thread_names, &entry->next, entry)) {
+    }
+}
+
+void trace_thread_release() {
+    if (local_buffer != NULL) {
+        atomic_store(&local_buffer->in_use, false);
+        local_buffer = NULL;
+    }
+}
+
+bool trace_write_json(const char* path, uint64_t* event_count, uint64_t* dropped_count) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    uint64_t origin = atomic_load(&origin_ns);
+    uint64_t events = 0;
+    uint64_t dropped = 0;
+    const char* separator = "\n";
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (TraceThreadName* entry = atomic_load(&thread_names); entry != NULL; entry = entry->next) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                separator, entry->thread_id, entry->name);
+        separator = ",\n";
+    }
+    for (TraceBuffer* buffer = atomic_load(&buffers); buffer != NULL; buffer = buffer->next) {
+        uint64_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+        uint64_t first = count > TRACE_BUFFER_EVENTS ? count - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = first; i < count; i++) {
+            TraceEvent event = buffer->events[i & (TRACE_BUFFER_EVENTS - 1)];
+            // The owner starts overwriting event i once it has published i + TRACE_BUFFER_EVENTS
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&buffer->count, memory_order_relaxed) >= i + TRACE_BUFFER_EVENTS) {
+                dropped++;
+                continue;
+            }
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                    separator, event.name, event.category, event.thread_id,
+                    (double)(event.start_ns - origin) / 1000.0, (double)event.duration_ns / 1000.0);
+            if (event.value != TRACE_NO_VALUE) {
+                fprintf(file, ",\"args\":{\"value\":%lld}", (long long)event.value);
+            }
+            fprintf(file, "}");
+            separator = ",\n";
+            events++;
+        }
+        dropped += first;
+    }
+    fprintf(file, "\n]}\n");
+
+    if (event_count != NULL) {
+        *event_count = events;
+    }
+    if (dropped_count != NULL) {
+        *dropped_count = dropped;
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+//
+// Code marks a scope with
+//
+//     uint64_t trace_start = trace_begin();
+//     ...
+//     trace_end("solve", "solver", trace_start);
+//
+// which records one complete event with its start and duration. Every thread writes
+// into its own buffer, so recording takes no lock and no atomic read-modify-write;
+// trace_write_json can run at any time and writes the events finished so far. While
+// tracing is off trace_begin returns 0 and trace_end returns at once.
+//
+// Each buffer is a ring that keeps the newest TRACE_BUFFER_EVENTS events of its threads
+// and overwrites older ones, which are counted as dropped. A trace of a long session
+// therefore covers its end: the GUI's main thread records about 3 events per frame, so at
+// 60 fps it keeps the last 3 minutes or so, and quieter threads keep far more.
+//
+// Names and categories are not copied, pass string literals. A thread that ends calls
+// trace_thread_release so a later thread can take over its buffer; the later thread gets a
+// thread id of its own, so the two show as separate rows.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_BUFFER_EVENTS (1 << 15) // Per buffer, a power of two; older events are overwritten
+#define TRACE_NO_VALUE INT64_MIN
+
+void trace_enable(bool enabled);
+bool trace_is_enabled();
+
+uint64_t trace_begin();
+void trace_end(const char* name, const char* category, uint64_t start);
+// Same, with a number shown in the event's arguments (nodes, a bound, a move)
+void trace_end_value(const char* name, const char* category, uint64_t start, int64_t value);
+
+// Names the calling thread's row in the timeline
+void trace_thread_name(const char* name);
+void trace_thread_release();
+
+// Writes the events still in the buffers; returns false if the file could not be written.
+// dropped_count is the number of older events overwritten so far.
+bool trace_write_json(const char* path, uint64_t* event_count, uint64_t* dropped_count);
+
+#endif
@@ -0,0 +1,290 @@
+#include "transposition_table.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TT_BUCKET_SLOTS 4
+#define TT_COUNTER_STRIPES 16
+#define TT_GENERATION_MASK 0x3F
+
+typedef struct TTSlot {
+    _Atomic uint64_t check; // key ^ data
+    _Atomic uint64_t data;
+} TTSlot;
+
+typedef struct TTBucket {
+    TTSlot slots[TT_BUCKET_SLOTS];
+} TTBucket;
+
+// Counters are striped per thread so parallel searches don't fight over one cache line
+typedef struct TTCounters {
+    _Atomic uint64_t probes;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t stores;
+    _Atomic uint64_t collisions;
+    char padding[PLATFORM_CACHE_LINE - 4 * sizeof(uint64_t)];
+} TTCounters;
+
+struct TranspositionTable {
+    TTBucket* buckets;
+    size_t bucket_count;
+    size_t size_bytes;
+    uint64_t mask;
+    TTReplacePolicy policy;
+    bool huge_pages;
+    _Atomic unsigned generation;
+    TTCounters counters[TT_COUNTER_STRIPES];
+};
+
+// Payload layout: value (32) | move (16) | depth (8) | bound (2) | generation (6)
+static uint64_t pack_data(const TTEntry* entry, unsigned generation) {
+    return (uint64_t)(uint32_t)entry->value |
+           ((uint64_t)entry->move << 32) |
+           ((uint64_t)entry->depth << 48) |
+           ((uint64_t)(entry->bound & 3) << 56) |
+           ((uint64_t)(generation & TT_GENERATION_MASK) << 58);
+}
+
+static void unpack_data(uint64_t data, TTEntry* entry) {
+    entry->value = (int32_t)(uint32_t)data;
+    entry->move = (uint16_t)(data >> 32);
+    entry->depth = (uint8_t)(data >> 48);
+    entry->bound = (TTBound)((data >> 56) & 3);
+}
+
+static int data_depth(uint64_t data) {
+    return (int)((data >> 48) & 0xFF);
+}
+
+static TTBound data_bound(uint64_t data) {
+    return (TTBound)((data >> 56) & 3);
+}
+
+static unsigned data_generation(uint64_t data) {
+    return (unsigned)(data >> 58) & TT_GENERATION_MASK;
+}
+
+static TTCounters* thread_counters(TranspositionTable* tt) {
+    static _Atomic unsigned next_stripe = 0;
+    static _Thread_local unsigned stripe = 0;
+    static _Thread_local bool has_stripe = false;
+    if (!has_stripe) {
+        stripe = atomic_fetch_add_explicit(&next_stripe, 1, memory_order_relaxed) % TT_COUNTER_STRIPES;
+        has_stripe = true;
+    }
+    return &tt->counters[stripe];
+}
+
+static void count(_Atomic uint64_t* counter) {
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+TranspositionTable* tt_create(size_t size_mb, TTReplacePolicy policy, bool huge_pages) {
+    TranspositionTable* tt = (TranspositionTable*)calloc(1, sizeof(TranspositionTable));
+    if (tt == NULL) {
+        return NULL;
+    }
+
+    // Largest power of two bucket count that fits in the requested size
+    size_t bytes = size_mb << 20;
+    size_t bucket_count = 1;
+    while (bucket_count * 2 * sizeof(TTBucket) <= bytes) {
+        bucket_count *= 2;
+    }
+
+    tt->bucket_count = bucket_count;
+    tt->size_bytes = bucket_count * sizeof(TTBucket);
+    tt->mask = (uint64_t)bucket_count - 1;
+    tt->policy = policy;
+    tt->buckets = (TTBucket*)platform_alloc_large(tt->size_bytes, huge_pages, &tt->huge_pages);
+    if (tt->buckets == NULL) {
+        free(tt);
+        return NULL;
+    }
+    return tt;
+}
+
+void tt_destroy(TranspositionTable* tt) {
+    if (tt) {
+        platform_free_large(tt->buckets, tt->size_bytes, tt->huge_pages);
+        free(tt);
+    }
+}
+
+void tt_clear(TranspositionTable* tt) {
+    memset(tt->buckets, 0, tt->size_bytes);
+    atomic_store(&tt->generation, 0);
+    for (int i = 0; i < TT_COUNTER_STRIPES; i++) {
+        atomic_store(&tt->counters[i].probes, 0);
+        atomic_store(&tt->counters[i].hits, 0);
+        atomic_store(&tt->counters[i].stores, 0);
+        atomic_store(&tt->counters[i].collisions, 0);
+    }
+}
+
+void tt_new_search(TranspositionTable* tt) {
+    atomic_fetch_add_explicit(&tt->generation, 1, memory_order_relaxed);
+}
+
+// Looks the key up in its bucket, returns the raw payload and slot index or -1
+static int find_slot(TTBucket* bucket, uint64_t key, uint64_t* data_out) {
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        uint64_t data = atomic_load_explicit(&bucket->slots[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&bucket->slots[i].check, memory_order_relaxed);
+        if (data_bound(data) != TTBoundNone && (check ^ data) == key) {
+            *data_out = data;
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool tt_probe(TranspositionTable* tt, uint64_t key, TTEntry* out) {
+    TTCounters* counters = thread_counters(tt);
+    TTBucket* bucket = &tt->buckets[key & tt->mask];
+    uint64_t data;
+
+    count(&counters->probes);
+    if (find_slot(bucket, key, &data) < 0) {
+        return false;
+    }
+    count(&counters->hits);
+    unpack_data(data, out);
+    return true;
+}
+
+// Lower score means a better eviction candidate
+static int replacement_score(const TranspositionTable* tt, uint64_t data, unsigned generation) {
+    if (data_bound(data) == TTBoundNone) {
+        return -1000; // Empty slots first
+    }
+    int score = data_depth(data);
+    if (tt->policy == TTReplaceAging) {
+        int age = (int)((generation - data_generation(data)) & TT_GENERATION_MASK);
+        score -= age * 16;
+    }
+    return score;
+}
+
+static void write_slot(TTSlot* slot, uint64_t key, uint64_t data) {
+    atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+    atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+}
+
+void tt_store(TranspositionTable* tt, uint64_t key, const TTEntry* entry) {
+    TTCounters* counters = thread_counters(tt);
+    TTBucket* bucket = &tt->buckets[key & tt->mask];
+    unsigned generation = atomic_load_explicit(&tt->generation, memory_order_relaxed);
+    uint64_t data = pack_data(entry, generation);
+    uint64_t existing;
+
+    count(&counters->stores);
+
+    // Same key: always refresh it in place
+    int index = find_slot(bucket, key, &existing);
+    if (index >= 0) {
+        write_slot(&bucket->slots[index], key, data);
+        return;
+    }
+
+    int victim = 0;
+    int best_score = 0;
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        uint64_t slot_data = atomic_load_explicit(&bucket->slots[i].data, memory_order_relaxed);
+        int score = replacement_score(tt, slot_data, generation);
+        if (i == 0 || score < best_score) {
+            victim = i;
+            best_score = score;
+        }
+    }
+
+    uint64_t victim_data = atomic_load_explicit(&bucket->slots[victim].data, memory_order_relaxed);
+    if (data_bound(victim_data) != TTBoundNone) {
+        count(&counters->collisions);
+    }
+    write_slot(&bucket->slots[victim], key, data);
+}
+
+bool tt_check_and_mark(TranspositionTable* tt, uint64_t key, int depth) {
+    TTEntry entry;
+    if (depth < 0) {
+        depth = 0;
+    }
+    if (depth > 255) {
+        depth = 255;
+    }
+    if (tt_probe(tt, key, &entry) && entry.depth >= depth) {
+        return true;
+    }
+    entry.value = 0;
+    entry.move = 0;
+    entry.depth = (uint8_t)depth;
+    entry.bound = TTBoundExact;
+    tt_store(tt, key, &entry);
+    return false;
+}
+
+void tt_get_stats(TranspositionTable* tt, TTStats* out, bool count_used) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < TT_COUNTER_STRIPES; i++) {
+        out->probes += atomic_load_explicit(&tt->counters[i].probes, memory_order_relaxed);
+        out->hits += atomic_load_explicit(&tt->counters[i].hits, memory_order_relaxed);
+        out->stores += atomic_load_explicit(&tt->counters[i].stores, memory_order_relaxed);
+        out->collisions += atomic_load_explicit(&tt->counters[i].collisions, memory_order_relaxed);
+    }
+    out->misses = out->probes - out->hits;
+    out->size_bytes = tt->size_bytes;
+    out->slots = tt->bucket_count * TT_BUCKET_SLOTS;
+    out->huge_pages = tt->huge_pages;
+
+    if (count_used) {
+        for (size_t b = 0; b < tt->bucket_count; b++) {
+            for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+                uint64_t data = atomic_load_explicit(&tt->buckets[b].slots[i].data, memory_order_relaxed);
+                if (data_bound(data) != TTBoundNone) {
+                    out->used_slots++;
+                }
+            }
+        }
+    }
+}
+
+size_t tt_image_size(const TranspositionTable* tt) {
+    return tt->size_bytes;
+}
+
+// Slot by slot with relaxed atomics, as searches may be storing at the same time
+void tt_read_image(TranspositionTable* tt, size_t offset, void* out, size_t size) {
+    TTSlot* slots = (TTSlot*)((uint8_t*)tt->buckets + offset);
+    uint64_t* words = (uint64_t*)out;
+    for (size_t i = 0; i < size / sizeof(TTSlot); i++) {
+        words[2 * i] = atomic_load_explicit(&slots[i].check, memory_order_relaxed);
+        words[2 * i + 1] = atomic_load_explicit(&slots[i].data, memory_order_relaxed);
+    }
+}
+
+void tt_write_image(TranspositionTable* tt, size_t offset, const void* in, size_t size) {
+    TTSlot* slots = (TTSlot*)((uint8_t*)tt->buckets + offset);
+    const uint64_t* words = (const uint64_t*)in;
+    for (size_t i = 0; i < size / sizeof(TTSlot); i++) {
+        atomic_store_explicit(&slots[i].check, words[2 * i], memory_order_relaxed);
+        atomic_store_explicit(&slots[i].data, words[2 * i + 1], memory_order_relaxed);
+    }
+}
+
+void tt_retain(TranspositionTable* tt, bool (*keep)(const TTEntry* entry, void* context), void* context) {
+    for (size_t b = 0; b < tt->bucket_count; b++) {
+        for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+            TTSlot* slot = &tt->buckets[b].slots[i];
+            uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+            if (data_bound(data) == TTBoundNone) {
+                continue;
+            }
+            TTEntry entry;
+            unpack_data(data, &entry);
+            if (!keep(&entry, context)) {
+                write_slot(slot, 0, 0);
+            }
+        }
+    }
+}
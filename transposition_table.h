@@ -0,0 +1,75 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+// Fixed-memory, lock-free hash table for 64-bit state keys.
+//
+// Every slot is two 64-bit words: the packed payload and key ^ payload. Readers and
+// writers never lock; a torn write simply fails the xor check and reads as a miss.
+// Buckets hold four slots and fill exactly one cache line.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    TTBoundNone,  // Empty slot
+    TTBoundExact,
+    TTBoundLower,
+    TTBoundUpper
+} TTBound;
+
+typedef enum {
+    TTReplaceDepthPreferred, // Evict the shallowest entry in the bucket
+    TTReplaceAging           // Evict entries from old searches first, then the shallowest
+} TTReplacePolicy;
+
+typedef struct TTEntry {
+    int32_t value;
+    uint16_t move;
+    uint8_t depth; // 0-255, larger means more valuable to keep
+    TTBound bound;
+} TTEntry;
+
+typedef struct TTStats {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t collisions; // Stores that evicted a live entry belonging to another key
+    size_t size_bytes;
+    size_t slots;
+    size_t used_slots;   // Only filled in by tt_get_stats when count_used is true
+    bool huge_pages;
+} TTStats;
+
+typedef struct TranspositionTable TranspositionTable;
+
+// size_mb is rounded down to a power of two number of buckets (at least one)
+TranspositionTable* tt_create(size_t size_mb, TTReplacePolicy policy, bool huge_pages);
+void tt_destroy(TranspositionTable* tt);
+void tt_clear(TranspositionTable* tt);
+
+// Starts a new search generation, used by TTReplaceAging to prefer evicting stale entries
+void tt_new_search(TranspositionTable* tt);
+
+bool tt_probe(TranspositionTable* tt, uint64_t key, TTEntry* out);
+void tt_store(TranspositionTable* tt, uint64_t key, const TTEntry* entry);
+
+// Duplicate detection for searches: returns true when the key was already stored with
+// at least this depth, otherwise records it with the given depth and returns false.
+bool tt_check_and_mark(TranspositionTable* tt, uint64_t key, int depth);
+
+void tt_get_stats(TranspositionTable* tt, TTStats* out, bool count_used);
+
+// Raw table contents, for saving a table to disk and loading it back into one of the same
+// size. Reading is safe while other threads store: a slot torn by a store fails its xor
+// check once loaded, like any other. offset and size are multiples of TT_IMAGE_ALIGN.
+#define TT_IMAGE_ALIGN 64
+size_t tt_image_size(const TranspositionTable* tt);
+void tt_read_image(TranspositionTable* tt, size_t offset, void* out, size_t size);
+void tt_write_image(TranspositionTable* tt, size_t offset, const void* in, size_t size);
+
+// Empties every slot keep returns false for, e.g. the entries a loaded image is too new for
+void tt_retain(TranspositionTable* tt, bool (*keep)(const TTEntry* entry, void* context), void* context);
+
+#endif
@@ -0,0 +1,231 @@
+#include "visited_filter.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FILTER_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
+#define BLOCK_WORDS 8
+#define BLOCK_BYTES (BLOCK_WORDS * sizeof(uint32_t))
+#define MAX_BLOCKS (1ull << 32) // The block index is the high 32 bits of the key scaled down
+
+struct VisitedFilter {
+    uint32_t* words;
+    uint64_t blocks;
+    size_t size_bytes;
+    uint64_t expected_keys;
+    double target_rate;
+    uint64_t probes;
+    uint64_t added;
+    bool avx2;
+    bool huge_pages;
+};
+
+// Odd constants whose products with a key spread its bits over the top of each word
+static const uint32_t SALTS[BLOCK_WORDS] = {
+    0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu, 0xA2B7289Du, 0x705495C7u, 0x2DF1424Bu, 0x9EFC4947u, 0x5C6BFB31u
+};
+
+// Keys are Zobrist hashes, already uniform: no further mixing
+static uint32_t* block_of(const VisitedFilter* filter, uint64_t key) {
+    return filter->words + (size_t)(((key >> 32) * filter->blocks) >> 32) * BLOCK_WORDS;
+}
+
+static bool check_and_add_scalar(uint32_t* block, uint32_t key) {
+    bool present = true;
+    for (int i = 0; i < BLOCK_WORDS; i++) {
+        uint32_t bit = 1u << ((key * SALTS[i]) >> 27);
+        present = present && (block[i] & bit) != 0;
+        block[i] |= bit;
+    }
+    return present;
+}
+
+static bool contains_scalar(const uint32_t* block, uint32_t key) {
+    for (int i = 0; i < BLOCK_WORDS; i++) {
+        if ((block[i] & (1u << ((key * SALTS[i]) >> 27))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef FILTER_X86
+
+TARGET_AVX2 static __m256i key_bits_avx2(uint32_t key) {
+    __m256i salts = _mm256_loadu_si256((const __m256i*)SALTS);
+    __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)key), salts), 27);
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+}
+
+// Blocks are 32 byte aligned: the filter is cache line aligned and blocks are 32 bytes
+TARGET_AVX2 static bool check_and_add_avx2(uint32_t* block, uint32_t key) {
+    __m256i bits = key_bits_avx2(key);
+    __m256i words = _mm256_load_si256((const __m256i*)block);
+    if (_mm256_testc_si256(words, bits)) {
+        return true;
+    }
+    _mm256_store_si256((__m256i*)block, _mm256_or_si256(words, bits));
+    return false;
+}
+
+TARGET_AVX2 static bool contains_avx2(const uint32_t* block, uint32_t key) {
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i*)block), key_bits_avx2(key)) != 0;
+}
+
+#endif
+
+// With keys spread at random the keys in a block are Poisson distributed, and with j of them
+// a given bit of a word is set with probability 1 - (31/32)^j; a key is a false positive
+// when the bits it picks in all eight words are set
+static double rate_at(double keys_per_block) {
+    double poisson = exp(-keys_per_block);
+    double clear = 1.0;
+    double rate = 0.0;
+    for (int j = 0; j < 100000; j++) {
+        if (j > 0) {
+            poisson *= keys_per_block / j;
+            clear *= 31.0 / 32.0;
+        }
+        double set = 1.0 - clear;
+        set *= set;
+        set *= set;
+        rate += poisson * set * set;
+        if (j > keys_per_block && poisson < 1e-15) {
+            break;
+        }
+    }
+    return rate;
+}
+
+double visited_filter_rate(uint64_t keys, size_t size_bytes) {
+    uint64_t blocks = size_bytes / BLOCK_BYTES;
+    return blocks == 0 ? 1.0 : rate_at((double)keys / (double)blocks);
+}
+
+static uint64_t blocks_for(uint64_t expected_keys, double false_positive_rate) {
+    // The keys per block that give the rate, by bisection: the rate grows with the load
+    double low = 0.0;
+    double high = 1000.0;
+    for (int i = 0; i < 64; i++) {
+        double middle = (low + high) / 2;
+        if (rate_at(middle) <= false_positive_rate) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+    double blocks = low > 0.0 ? ceil((double)expected_keys / low) : (double)MAX_BLOCKS;
+    return blocks < 1.0 ? 1 : blocks > (double)MAX_BLOCKS ? MAX_BLOCKS : (uint64_t)blocks;
+}
+
+size_t visited_filter_bytes(uint64_t expected_keys, double false_positive_rate) {
+    return (size_t)blocks_for(expected_keys, false_positive_rate) * BLOCK_BYTES;
+}
+
+VisitedFilter* visited_filter_create(uint64_t expected_keys, double false_positive_rate, bool huge_pages) {
+    VisitedFilter* filter = (VisitedFilter*)calloc(1, sizeof(VisitedFilter));
+    if (filter == NULL) {
+        return NULL;
+    }
+    filter->blocks = blocks_for(expected_keys, false_positive_rate);
+    filter->size_bytes = (size_t)filter->blocks * BLOCK_BYTES;
+    filter->expected_keys = expected_keys;
+    filter->target_rate = false_positive_rate;
+    filter->words = (uint32_t*)platform_alloc_large(filter->size_bytes, huge_pages, &filter->huge_pages);
+    if (filter->words == NULL) {
+        free(filter);
+        return NULL;
+    }
+    visited_filter_use_avx2(filter, true);
+    return filter;
+}
+
+void visited_filter_destroy(VisitedFilter* filter) {
+    if (filter) {
+        platform_free_large(filter->words, filter->size_bytes, filter->huge_pages);
+        free(filter);
+    }
+}
+
+void visited_filter_clear(VisitedFilter* filter) {
+    memset(filter->words, 0, filter->size_bytes);
+    filter->probes = 0;
+    filter->added = 0;
+}
+
+bool visited_filter_check_and_add(VisitedFilter* filter, uint64_t key) {
+    uint32_t* block = block_of(filter, key);
+    bool present;
+    filter->probes++;
+#ifdef FILTER_X86
+    if (filter->avx2) {
+        present = check_and_add_avx2(block, (uint32_t)key);
+    }
+    else
+#endif
+    {
+        present = check_and_add_scalar(block, (uint32_t)key);
+    }
+    filter->added += present ? 0 : 1;
+    return present;
+}
+
+bool visited_filter_contains(const VisitedFilter* filter, uint64_t key) {
+    const uint32_t* block = block_of(filter, key);
+#ifdef FILTER_X86
+    if (filter->avx2) {
+        return contains_avx2(block, (uint32_t)key);
+    }
+#endif
+    return contains_scalar(block, (uint32_t)key);
+}
+
+bool visited_filter_use_avx2(VisitedFilter* filter, bool enable) {
+#ifdef FILTER_X86
+    filter->avx2 = enable && platform_cpu_has_avx2();
+#else
+    (void)enable;
+    filter->avx2 = false;
+#endif
+    return filter->avx2;
+}
+
+static int count_bits(uint32_t word) {
+    word -= (word >> 1) & 0x55555555u;
+    word = (word & 0x33333333u) + ((word >> 2) & 0x33333333u);
+    return (int)((((word + (word >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+void visited_filter_get_stats(const VisitedFilter* filter, VisitedFilterStats* out) {
+    out->probes = filter->probes;
+    out->added = filter->added;
+    out->size_bytes = filter->size_bytes;
+    out->blocks = filter->blocks;
+    out->target_rate = filter->target_rate;
+    out->expected_keys = filter->expected_keys;
+    out->avx2 = filter->avx2;
+    out->huge_pages = filter->huge_pages;
+
+    // A random key hits each word's set bits with their share of the 32
+    double sum = 0.0;
+    for (uint64_t block = 0; block < filter->blocks; block++) {
+        const uint32_t* words = filter->words + block * BLOCK_WORDS;
+        double hit = 1.0;
+        for (int i = 0; i < BLOCK_WORDS && hit > 0.0; i++) {
+            hit *= count_bits(words[i]) / 32.0;
+        }
+        sum += hit;
+    }
+    out->rate = sum / (double)filter->blocks;
+}
@@ -0,0 +1,715 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_state.h"
+#include "solver.h"
+#include "portfolio.h"
+#include "mcts.h"
+#include "platform.h"
+#include "batch_engine.h"
+#include "bitboard.h"
+#include "trace.h"
+#include "deadlock.h"
+
+// Benchmarks for the engine modules, all on the same seeded deals so runs compare.
+//
+//   yukon_bench solver [--first N] [--deals N] [--nodes N] [--algorithm dfs|ida|wastar|pns|beam|restart] [--weight W] [--beam W] [--tt MB] [--filter N] [--fpr P] [--pruning on|off|both] [--tablebase FILE] [--trace FILE]
+//   yukon_bench portfolio [--first N] [--deals N] [--nodes N] [--weight W] [--beam W] [--tt MB] [--tablebase FILE] [--trace FILE]
+//   yukon_bench mcts [--first N] [--deals N] [--playouts N] [--threads N] [--trees N]
+//   yukon_bench batch [--first N] [--games N] [--rounds N]
+//   yukon_bench state [--first N] [--games N] [--rounds N]
+//   yukon_bench deadlock [--first N] [--games N]
+
+typedef struct BenchOptions {
+    uint32_t first_deal;
+    uint32_t deal_count;
+    uint64_t node_limit;
+    size_t tt_mb;
+    uint64_t filter_states;  // Depth first visited filter sized for this many positions, 0 for none
+    double filter_rate;
+    double weight;
+    int beam_width;
+    int algorithm;           // -1 runs every algorithm
+    int pruning;             // 0 off, 1 on, 2 runs each algorithm both ways
+    const Tablebase* tablebase;
+    uint32_t game_count;
+    uint32_t rounds;
+    uint32_t playouts;       // MCTS playouts per move
+    int threads;             // MCTS threads, 0 for one per core
+    int trees;               // MCTS independent trees
+    const char* trace_path;  // Timeline of the run in Chrome trace format
+} BenchOptions;
+
+static void parse_options(int argc, char* argv[], BenchOptions* options) {
+    options->first_deal = 0;
+    options->deal_count = 100;
+    options->node_limit = 1000000;
+    options->tt_mb = 64;
+    options->filter_states = 0;
+    options->filter_rate = 0.01;
+    options->weight = 2.0;
+    options->beam_width = 256;
+    options->algorithm = -1;
+    options->pruning = 2;
+    options->tablebase = NULL;
+    options->game_count = 65536;
+    options->rounds = 200;
+    options->playouts = 2000;
+    options->threads = 0;
+    options->trees = 1;
+    options->trace_path = NULL;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--first") == 0) {
+            options->first_deal = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--deals") == 0) {
+            options->deal_count = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--nodes") == 0) {
+            options->node_limit = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--games") == 0) {
+            options->game_count = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--rounds") == 0) {
+            options->rounds = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--playouts") == 0) {
+            options->playouts = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            options->threads = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--trees") == 0) {
+            options->trees = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0) {
+            options->trace_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--tt") == 0) {
+            options->tt_mb = (size_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--filter") == 0) {
+            options->filter_states = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--fpr") == 0) {
+            options->filter_rate = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--weight") == 0) {
+            options->weight = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--beam") == 0) {
+            options->beam_width = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--pruning") == 0) {
+            options->pruning = strcmp(argv[i + 1], "off") == 0 ? 0 : strcmp(argv[i + 1], "on") == 0 ? 1 : 2;
+        }
+        else if (strcmp(argv[i], "--tablebase") == 0) {
+            static Tablebase tablebase;
+            if (tablebase_open(&tablebase, argv[i + 1])) {
+                options->tablebase = &tablebase;
+            }
+            else {
+                printf("Could not open tablebase %s\n", argv[i + 1]);
+            }
+        }
+        else if (strcmp(argv[i], "--algorithm") == 0) {
+            SolverAlgorithm algorithm;
+            if (solver_algorithm_from_string(argv[i + 1], &algorithm)) {
+                options->algorithm = (int)algorithm;
+            }
+            else {
+                printf("Unknown algorithm %s\n", argv[i + 1]);
+            }
+        }
+    }
+}
+
+static void bench_solver_algorithm(const BenchOptions* options, SolverAlgorithm algorithm, bool pruning) {
+    SolverConfig config;
+    solver_default_config(&config);
+    config.algorithm = algorithm;
+    config.pruning = pruning;
+    config.weight = options->weight;
+    config.beam_width = options->beam_width;
+    config.node_limit = options->node_limit;
+    config.tt_mb = options->tt_mb;
+    config.tablebase = options->tablebase;
+    config.filter_states = options->filter_states;
+    config.filter_rate = options->filter_rate;
+
+    Solver* solver = solver_create(&config);
+    SolveResult* result = (SolveResult*)malloc(sizeof(SolveResult));
+    if (solver == NULL || result == NULL) {
+        printf("Out of memory\n");
+        solver_destroy(solver);
+        free(result);
+        return;
+    }
+
+    uint32_t won = 0;
+    uint32_t unsolvable = 0;
+    uint64_t total_length = 0;
+    uint64_t total_nodes = 0;
+    uint32_t shortest = UINT32_MAX;
+    uint32_t longest = 0;
+    VisitedFilterStats filter = {0};
+    uint64_t most_added = 0;
+    double worst_rate = 0.0;
+    uint64_t filter_ns = 0;
+    uint64_t start = platform_time_ns();
+    for (uint32_t i = 0; i < options->deal_count; i++) {
+        GameState state;
+        state_deal(&state, options->first_deal + i);
+        solver_solve(solver, &state, result);
+        total_nodes += result->nodes;
+        // The rate is measured by reading the whole filter, which is left out of the time
+        uint64_t filter_start = platform_time_ns();
+        if (solver_filter_stats(solver, &filter)) {
+            most_added = filter.added > most_added ? filter.added : most_added;
+            worst_rate = filter.rate > worst_rate ? filter.rate : worst_rate;
+        }
+        filter_ns += platform_time_ns() - filter_start;
+        if (result->status == SolveWon) {
+            won++;
+            total_length += result->length;
+            shortest = result->length < shortest ? result->length : shortest;
+            longest = result->length > longest ? result->length : longest;
+        }
+        else if (result->status == SolveUnsolvable) {
+            unsolvable++;
+        }
+    }
+    double seconds = (double)(platform_time_ns() - start - filter_ns) / 1e9;
+
+    printf("%-7s %5s %6u %6u %6u %8.1f %5u %5u %12.0f %10.2f %8.2f\n", solver_algorithm_name(algorithm), pruning ? "on" : "off", won, unsolvable,
+           options->deal_count - won - unsolvable, won ? (double)total_length / won : 0.0, won ? shortest : 0, longest,
+           options->deal_count ? (double)total_nodes / options->deal_count : 0.0,
+           seconds > 0 ? total_nodes / seconds / 1e6 : 0.0, seconds);
+    if (filter.size_bytes > 0 && algorithm == SolverDepthFirst) {
+        printf("        filter %.1f MB%s%s, up to %llu positions in a deal, false positive rate up to %.3f%%\n",
+               filter.size_bytes / (1024.0 * 1024.0), filter.avx2 ? ", AVX2" : "", filter.huge_pages ? ", huge pages" : "",
+               (unsigned long long)most_added, worst_rate * 100.0);
+    }
+
+    free(result);
+    solver_destroy(solver);
+}
+
+static int bench_solver(const BenchOptions* options) {
+    printf("Deals %u-%u, %llu nodes per deal, weight %.2f, %s\n", options->first_deal,
+           options->first_deal + options->deal_count - 1, (unsigned long long)options->node_limit, options->weight,
+           options->tablebase ? "with tablebase" : "no tablebase");
+    if (options->filter_states > 0) {
+        printf("Depth first search with a visited filter for %llu positions at %.3f%% false positives, %zu MB table\n",
+               (unsigned long long)options->filter_states, options->filter_rate * 100.0, options->tt_mb);
+    }
+    printf("%-7s %5s %6s %6s %6s %8s %5s %5s %12s %10s %8s\n", "solver", "prune", "won", "unsolv", "unknwn", "avg len", "min",
+           "max", "nodes/deal", "Mnodes/s", "seconds");
+    for (int algorithm = SolverDepthFirst; algorithm <= SolverRestarts; algorithm++) {
+        if (options->algorithm >= 0 && options->algorithm != algorithm) {
+            continue;
+        }
+        if (options->pruning != 1) {
+            bench_solver_algorithm(options, (SolverAlgorithm)algorithm, false);
+        }
+        if (options->pruning != 0) {
+            bench_solver_algorithm(options, (SolverAlgorithm)algorithm, true);
+        }
+    }
+    return 0;
+}
+
+static int compare_times(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sorts times and prints the row of one solver
+static void print_latency(const char* name, uint64_t* times, uint32_t count, uint32_t won, uint32_t unsolvable) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += times[i];
+    }
+    qsort(times, count, sizeof(uint64_t), compare_times);
+    printf("%-9s %6u %6u %6u %9.2f %9.2f %9.2f %9.2f\n", name, won, unsolvable, count - won - unsolvable,
+           times[count / 2] / 1e6, times[count * 9 / 10] / 1e6, times[count - 1] / 1e6, total / 1e9);
+}
+
+// Time per deal of each portfolio strategy on its own, then of the portfolio racing them,
+// and whether any definite answers disagree
+static int bench_portfolio(const BenchOptions* options) {
+    PortfolioConfig config;
+    portfolio_default_config(&config);
+    config.node_limit = options->node_limit;
+    config.tt_mb = options->tt_mb;
+    config.weight = options->weight;
+    config.beam_width = options->beam_width;
+    config.tablebase = options->tablebase;
+
+    uint32_t count = options->deal_count;
+    uint64_t* times = (uint64_t*)malloc(sizeof(uint64_t) * (count ? count : 1));
+    uint8_t* verdicts = (uint8_t*)calloc((size_t)(count ? count : 1) * config.strategy_count, 1);
+    SolveResult* result = (SolveResult*)malloc(sizeof(SolveResult));
+    if (count == 0 || times == NULL || verdicts == NULL || result == NULL) {
+        free(times);
+        free(verdicts);
+        free(result);
+        return 1;
+    }
+    printf("Deals %u-%u, %llu nodes per deal and strategy, weight %.2f, beam %d, %s\n", options->first_deal,
+           options->first_deal + count - 1, (unsigned long long)options->node_limit, options->weight,
+           options->beam_width, options->tablebase ? "with tablebase" : "no tablebase");
+    printf("%-9s %6s %6s %6s %9s %9s %9s %9s\n", "solver", "won", "unsolv", "unknwn", "p50 ms", "p90 ms", "max ms", "seconds");
+
+    for (int s = 0; s < config.strategy_count; s++) {
+        SolverConfig solver_config;
+        solver_default_config(&solver_config);
+        solver_config.algorithm = config.strategies[s];
+        solver_config.node_limit = config.node_limit;
+        solver_config.tt_mb = config.tt_mb;
+        solver_config.weight = config.weight;
+        solver_config.beam_width = config.beam_width;
+        solver_config.seed = config.seed + (uint64_t)s;
+        solver_config.tablebase = config.tablebase;
+        Solver* solver = solver_create(&solver_config);
+        if (solver == NULL) {
+            printf("Out of memory\n");
+            continue;
+        }
+        uint32_t won = 0;
+        uint32_t unsolvable = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            GameState state;
+            state_deal(&state, options->first_deal + i);
+            uint64_t start = platform_time_ns();
+            SolveStatus status = solver_solve(solver, &state, result);
+            times[i] = platform_time_ns() - start;
+            verdicts[(size_t)s * count + i] = (uint8_t)status;
+            won += status == SolveWon;
+            unsolvable += status == SolveUnsolvable;
+        }
+        print_latency(solver_algorithm_name(config.strategies[s]), times, count, won, unsolvable);
+        solver_destroy(solver);
+    }
+
+    Portfolio* portfolio = portfolio_create(&config);
+    if (portfolio == NULL) {
+        printf("Out of memory\n");
+        free(times);
+        free(verdicts);
+        free(result);
+        return 1;
+    }
+    uint32_t won = 0;
+    uint32_t unsolvable = 0;
+    uint32_t disagreements = 0;
+    uint32_t answered[PORTFOLIO_MAX_STRATEGIES] = { 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        GameState state;
+        state_deal(&state, options->first_deal + i);
+        int winner;
+        uint64_t start = platform_time_ns();
+        SolveStatus status = portfolio_solve(portfolio, &state, result, &winner);
+        times[i] = platform_time_ns() - start;
+        won += status == SolveWon;
+        unsolvable += status == SolveUnsolvable;
+        if (winner >= 0) {
+            answered[winner]++;
+        }
+        for (int s = 0; s < config.strategy_count && status != SolveUnknown; s++) {
+            uint8_t verdict = verdicts[(size_t)s * count + i];
+            disagreements += verdict != SolveUnknown && verdict != status;
+        }
+    }
+    print_latency("portfolio", times, count, won, unsolvable);
+    printf("Answered first:");
+    for (int s = 0; s < config.strategy_count; s++) {
+        printf(" %s %u", solver_algorithm_name(config.strategies[s]), answered[s]);
+    }
+    printf(", %u disagreements with the single runs\n", disagreements);
+
+    portfolio_destroy(portfolio);
+    free(times);
+    free(verdicts);
+    free(result);
+    return disagreements == 0 ? 0 : 1;
+}
+
+#define MCTS_GAME_MOVES 500 // A game the player goes round in circles in ends here
+
+// Whole games played by the MCTS player, which never sees the face down cards, with one
+// thread and then twice as many up to --threads: wins, cards on the foundations and the
+// playout throughput, which shows how the engine scales with every core searching
+static int bench_mcts(const BenchOptions* options) {
+    int max_threads = options->threads > 0 ? options->threads : platform_cpu_count();
+    printf("Deals %u-%u, %u playouts per move, %d tree%s\n", options->first_deal,
+           options->first_deal + options->deal_count - 1, options->playouts, options->trees, options->trees == 1 ? "" : "s");
+    printf("%-7s %6s %9s %9s %12s %12s %8s\n", "threads", "won", "avg cards", "moves", "playouts/s", "Mmoves/s", "seconds");
+    for (int threads = 1;; threads *= 2) {
+        threads = threads < max_threads ? threads : max_threads;
+        MctsConfig config;
+        mcts_default_config(&config);
+        config.playouts = options->playouts;
+        config.threads = threads;
+        config.trees = options->trees;
+        MctsPlayer* player = mcts_create(&config);
+        if (player == NULL) {
+            printf("Out of memory\n");
+            return 1;
+        }
+
+        uint32_t won = 0;
+        uint64_t cards = 0;
+        uint64_t moves = 0;
+        uint64_t playouts = 0;
+        uint64_t playout_moves = 0;
+        uint64_t start = platform_time_ns();
+        for (uint32_t i = 0; i < options->deal_count; i++) {
+            GameState state;
+            state_deal(&state, options->first_deal + i);
+            for (int move = 0; move < MCTS_GAME_MOVES && !state_is_won(&state); move++) {
+                MctsResult result;
+                mcts_choose(player, &state, &result);
+                if (result.move == MOVE_NONE) {
+                    break;
+                }
+                state_apply_move(&state, result.move);
+                moves++;
+                playouts += result.playouts;
+                playout_moves += result.playout_moves;
+            }
+            won += state_is_won(&state);
+            cards += (uint64_t)state_foundation_count(&state);
+        }
+        double seconds = (double)(platform_time_ns() - start) / 1e9;
+        printf("%-7d %6u %9.1f %9.1f %12.0f %12.2f %8.2f\n", threads, won,
+               options->deal_count ? (double)cards / options->deal_count : 0.0,
+               options->deal_count ? (double)moves / options->deal_count : 0.0, seconds > 0 ? playouts / seconds : 0.0,
+               seconds > 0 ? playout_moves / seconds / 1e6 : 0.0, seconds);
+        mcts_destroy(player);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    return 0;
+}
+
+// The same top card checks the batch kernels run, read straight from each GameState
+static uint64_t count_moves_per_state(const GameState* states, uint32_t count) {
+    uint64_t total = 0;
+    for (uint32_t game = 0; game < count; game++) {
+        const GameState* state = &states[game];
+        uint8_t top[YUKON_COLUMNS];
+        int first_empty = -1;
+        for (int column = 0; column < YUKON_COLUMNS; column++) {
+            top[column] = state_top_card(state, column);
+            if (top[column] == NO_CARD && first_empty < 0) {
+                first_empty = column;
+            }
+        }
+        for (int from = 0; from < YUKON_COLUMNS; from++) {
+            uint8_t card = top[from];
+            if (card == NO_CARD) {
+                continue;
+            }
+            for (int to = 0; to < YUKON_COLUMNS; to++) {
+                if (to == from) {
+                    continue;
+                }
+                if (top[to] == NO_CARD) {
+                    total += to == first_empty && CARD_RANK(card) == YUKON_RANKS - 1 && state->column_length[from] > 1;
+                }
+                else {
+                    total += CARD_RANK(card) + 1 == CARD_RANK(top[to]) && CARD_IS_RED(card) != CARD_IS_RED(top[to]);
+                }
+            }
+            total += CARD_RANK(card) == state->foundation[CARD_SUIT(card)];
+        }
+    }
+    return total;
+}
+
+static uint64_t count_batch_moves(const GameBatch* batch) {
+    uint64_t total = 0;
+    for (uint32_t game = 0; game < batch->count; game++) {
+        total += batch->legal_count[game];
+    }
+    return total;
+}
+
+static int bench_batch(const BenchOptions* options) {
+    GameBatch batch;
+    if (options->game_count == 0 || !batch_init(&batch, options->game_count)) {
+        printf("Could not allocate %u games\n", options->game_count);
+        return 1;
+    }
+
+    // Spread the games over the phases of play, so the checks see varied boards
+    uint64_t rng = 0x42415443484553ull; // "BATCHES"
+    for (uint32_t game = 0; game < batch.count; game++) {
+        GameState state;
+        state_deal(&state, options->first_deal + game);
+        batch_load(&batch, game, &state);
+    }
+    for (int round = 0; round < 20; round++) {
+        batch_step(&batch, BatchScalar, &rng);
+    }
+
+    uint64_t checks = (uint64_t)batch.count * YUKON_COLUMNS * YUKON_COLUMNS * options->rounds;
+    printf("%u games, %u rounds, %.1f MB of batch arrays%s\n", batch.count, options->rounds,
+           batch.block_size / (1024.0 * 1024.0), batch.huge_pages ? " on huge pages" : "");
+    printf("%-10s %12s %10s %8s\n", "kernel", "Mchecks/s", "speedup", "moves");
+
+    uint64_t expected = 0;
+    uint64_t start = platform_time_ns();
+    for (uint32_t round = 0; round < options->rounds; round++) {
+        expected = count_moves_per_state(batch.states, batch.count);
+    }
+    double baseline = (double)(platform_time_ns() - start) / 1e9;
+    printf("%-10s %12.1f %9.2fx %8llu\n", "per state", checks / baseline / 1e6, 1.0, (unsigned long long)expected);
+
+    int status = 0;
+    uint32_t words = batch.capacity / BATCH_LANES;
+    uint32_t* reference = (uint32_t*)malloc((size_t)BATCH_PAIRS * words * sizeof(uint32_t));
+    for (int kernel = BatchScalar; kernel <= BatchAvx2 && reference != NULL; kernel++) {
+        if (!batch_kernel_supported((BatchKernel)kernel)) {
+            printf("%-10s %12s\n", batch_kernel_name((BatchKernel)kernel), "unsupported");
+            continue;
+        }
+        start = platform_time_ns();
+        for (uint32_t round = 0; round < options->rounds; round++) {
+            batch_find_moves(&batch, (BatchKernel)kernel);
+        }
+        double seconds = (double)(platform_time_ns() - start) / 1e9;
+
+        // Every kernel must agree with the per state checks and with each other
+        uint64_t found = count_batch_moves(&batch);
+        if (kernel == BatchScalar) {
+            memcpy(reference, batch.legal, (size_t)BATCH_PAIRS * words * sizeof(uint32_t));
+        }
+        else if (memcmp(reference, batch.legal, (size_t)BATCH_PAIRS * words * sizeof(uint32_t)) != 0) {
+            found = UINT64_MAX;
+        }
+        printf("%-10s %12.1f %9.2fx %8llu%s\n", batch_kernel_name((BatchKernel)kernel), checks / seconds / 1e6,
+               baseline / seconds, (unsigned long long)found, found == expected ? "" : "  MISMATCH");
+        status |= found != expected;
+    }
+    free(reference);
+
+    // Lockstep random playouts from fresh deals
+    BatchKernel best = batch_best_kernel();
+    for (uint32_t game = 0; game < batch.count; game++) {
+        GameState state;
+        state_deal(&state, options->first_deal + game);
+        batch_load(&batch, game, &state);
+    }
+    uint64_t moves = 0;
+    start = platform_time_ns();
+    for (uint32_t round = 0; round < options->rounds; round++) {
+        uint32_t moved = batch_step(&batch, best, &rng);
+        moves += moved;
+        if (moved == 0) {
+            break;
+        }
+    }
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+    uint32_t won = 0;
+    for (uint32_t game = 0; game < batch.count; game++) {
+        won += state_is_won(&batch.states[game]);
+    }
+    printf("Playouts with %s: %.2f M moves/s, %u of %u games won\n", batch_kernel_name(best),
+           seconds > 0 ? moves / seconds / 1e6 : 0.0, won, batch.count);
+
+    batch_free(&batch);
+    return status;
+}
+
+static int compare_moves(const void* a, const void* b) {
+    return (int)*(const Move*)a - (int)*(const Move*)b;
+}
+
+// Both representations must find the same moves, and agree after every apply and undo
+static bool check_bitboard(const GameState* state) {
+    BitboardState board;
+    Move list_moves[YUKON_MAX_MOVES];
+    Move bit_moves[YUKON_MAX_MOVES];
+    bitboard_from_state(&board, state);
+    int count = state_generate_moves(state, list_moves);
+    if (bitboard_generate_moves(&board, bit_moves) != count) {
+        return false;
+    }
+    qsort(list_moves, (size_t)count, sizeof(Move), compare_moves);
+    qsort(bit_moves, (size_t)count, sizeof(Move), compare_moves);
+    if (memcmp(list_moves, bit_moves, (size_t)count * sizeof(Move)) != 0) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        GameState after = *state;
+        BitboardState expected;
+        BitboardState moved = board;
+        Move done = state_apply_move(&after, list_moves[i]);
+        bitboard_from_state(&expected, &after);
+        if (bitboard_apply_move(&moved, list_moves[i]) != done || memcmp(&moved, &expected, sizeof(moved)) != 0 ||
+            !bitboard_is_move_legal(&board, list_moves[i])) {
+            return false;
+        }
+        bitboard_undo_move(&moved, done);
+        if (memcmp(&moved, &board, sizeof(moved)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_state(const BenchOptions* options) {
+    // Positions from random playouts, from the deal to a few dozen moves in
+    uint32_t count = options->game_count;
+    GameState* states = (GameState*)malloc((size_t)count * sizeof(GameState));
+    BitboardState* boards = (BitboardState*)malloc((size_t)count * sizeof(BitboardState));
+    if (count == 0 || states == NULL || boards == NULL) {
+        printf("Could not allocate %u positions\n", count);
+        free(states);
+        free(boards);
+        return 1;
+    }
+    uint64_t rng = 0x4249544241524453ull; // "BITBARDS"
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Move moves[YUKON_MAX_MOVES];
+        state_deal(&states[i], options->first_deal + i);
+        for (uint32_t steps = rng_below(&rng, 60); steps > 0; steps--) {
+            int move_count = state_generate_moves(&states[i], moves);
+            if (move_count == 0) {
+                break;
+            }
+            state_apply_move(&states[i], moves[rng_below(&rng, (uint32_t)move_count)]);
+        }
+        bitboard_from_state(&boards[i], &states[i]);
+        mismatches += !check_bitboard(&states[i]);
+    }
+    printf("%u positions, %u rounds, %u mismatches between the representations\n", count, options->rounds, mismatches);
+    printf("%-10s %14s %14s\n", "form", "Mgen/s", "Mapply+undo/s");
+
+    Move moves[YUKON_MAX_MOVES];
+    uint64_t generated[2] = { 0, 0 };
+    double generate_seconds[2];
+    double apply_seconds[2];
+    uint64_t applied[2] = { 0, 0 };
+    for (int bitboard = 0; bitboard < 2; bitboard++) {
+        uint64_t start = platform_time_ns();
+        for (uint32_t round = 0; round < options->rounds; round++) {
+            for (uint32_t i = 0; i < count; i++) {
+                generated[bitboard] += bitboard ? bitboard_generate_moves(&boards[i], moves) : state_generate_moves(&states[i], moves);
+            }
+        }
+        generate_seconds[bitboard] = (double)(platform_time_ns() - start) / 1e9;
+
+        start = platform_time_ns();
+        for (uint32_t round = 0; round < options->rounds; round++) {
+            for (uint32_t i = 0; i < count; i++) {
+                if (bitboard) {
+                    int move_count = bitboard_generate_moves(&boards[i], moves);
+                    for (int m = 0; m < move_count; m++) {
+                        bitboard_undo_move(&boards[i], bitboard_apply_move(&boards[i], moves[m]));
+                    }
+                    applied[bitboard] += (uint64_t)move_count;
+                }
+                else {
+                    int move_count = state_generate_moves(&states[i], moves);
+                    for (int m = 0; m < move_count; m++) {
+                        state_undo_move(&states[i], state_apply_move(&states[i], moves[m]));
+                    }
+                    applied[bitboard] += (uint64_t)move_count;
+                }
+            }
+        }
+        apply_seconds[bitboard] = (double)(platform_time_ns() - start) / 1e9;
+        printf("%-10s %14.2f %14.2f\n", bitboard ? "bitboard" : "list", count * (double)options->rounds / generate_seconds[bitboard] / 1e6,
+               applied[bitboard] / apply_seconds[bitboard] / 1e6);
+    }
+    printf("Move generation: bitboard %.2fx the list walk, %.1f moves per position\n",
+           generate_seconds[0] / generate_seconds[1], (double)generated[0] / ((double)count * options->rounds));
+
+    free(states);
+    free(boards);
+    return generated[0] == generated[1] && mismatches == 0 ? 0 : 1;
+}
+
+// Static dead deal detection over a range of fresh deals
+static int bench_deadlock(const BenchOptions* options) {
+    GameState* states = (GameState*)malloc((size_t)options->game_count * sizeof(GameState));
+    if (states == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < options->game_count; i++) {
+        state_deal(&states[i], options->first_deal + i);
+    }
+
+    uint32_t dead = 0;
+    uint32_t locked_cards = 0;
+    uint64_t start = platform_time_ns();
+    for (uint32_t i = 0; i < options->game_count; i++) {
+        uint64_t locked;
+        if (deadlock_find(&states[i], &locked)) {
+            dead++;
+            for (; locked != 0; locked &= locked - 1) {
+                locked_cards++;
+            }
+        }
+    }
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+    printf("Deals %u to %u: %u proven dead (%.2f%%), %.1f locked cards each, %.0f ns per deal\n", options->first_deal,
+           options->first_deal + options->game_count - 1, dead, 100.0 * dead / options->game_count,
+           dead > 0 ? (double)locked_cards / dead : 0.0, seconds * 1e9 / options->game_count);
+    free(states);
+    return 0;
+}
+
+static void print_usage() {
+    printf("Usage: yukon_bench solver [--first N] [--deals N] [--nodes N] [--algorithm dfs|ida|wastar|pns|beam|restart] [--weight W] [--beam W] [--tt MB] [--filter N] [--fpr P] [--pruning on|off|both] [--tablebase FILE] [--trace FILE]\n");
+    printf("       yukon_bench portfolio [--first N] [--deals N] [--nodes N] [--weight W] [--beam W] [--tt MB] [--tablebase FILE] [--trace FILE]\n");
+    printf("       yukon_bench mcts [--first N] [--deals N] [--playouts N] [--threads N] [--trees N]\n");
+    printf("       yukon_bench batch [--first N] [--games N] [--rounds N]\n");
+    printf("       yukon_bench state [--first N] [--games N] [--rounds N]\n");
+    printf("       yukon_bench deadlock [--first N] [--games N]\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    parse_options(argc, argv, &options);
+    if (strcmp(argv[1], "solver") == 0 || strcmp(argv[1], "portfolio") == 0 || strcmp(argv[1], "mcts") == 0) {
+        if (options.trace_path != NULL) {
+            trace_enable(true);
+            trace_thread_name("bench");
+        }
+        int status = strcmp(argv[1], "solver") == 0      ? bench_solver(&options)
+                     : strcmp(argv[1], "portfolio") == 0 ? bench_portfolio(&options)
+                                                         : bench_mcts(&options);
+        uint64_t events;
+        uint64_t dropped;
+        if (options.trace_path != NULL && trace_write_json(options.trace_path, &events, &dropped)) {
+            printf("Wrote %llu trace events to %s (%llu dropped)\n", (unsigned long long)events, options.trace_path,
+                   (unsigned long long)dropped);
+        }
+        return status;
+    }
+    if (strcmp(argv[1], "batch") == 0) {
+        return bench_batch(&options);
+    }
+    if (strcmp(argv[1], "state") == 0) {
+        return bench_state(&options);
+    }
+    if (strcmp(argv[1], "deadlock") == 0) {
+        return bench_deadlock(&options);
+    }
+    printf("Unknown benchmark %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,451 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include "game_state.h"
+#include "solver.h"
+#include "checkpoint.h"
+#include "external_search.h"
+#include "deal_database.h"
+#include "platform.h"
+
+// Builds and inspects deal databases.
+//
+//   yukon_deals build FILE FIRST COUNT [--threads N] [--nodes N] [--tt MB] [--filter N] [--fpr P] [--algorithm dfs|wastar|pns|restart] [--weight W] [--tablebase FILE]
+//   yukon_deals show FILE DEAL
+//   yukon_deals stats FILE
+//   yukon_deals solve DEAL [--nodes N] [--tt MB] [--checkpoint FILE] [--every N] [--table]
+//   yukon_deals explore DEAL DIR [--memory MB] [--states N] [--pruning on|off] [--keep]
+
+typedef struct BuildJob {
+    DealDbBuilder* builder;
+    SolverConfig config;
+    _Atomic uint32_t next;     // Next deal index to solve
+    _Atomic uint32_t done;
+    _Atomic uint32_t won;
+    _Atomic uint32_t unsolvable;
+    _Atomic uint32_t rejected;  // Proven dead without a search
+    _Atomic bool failed;
+} BuildJob;
+
+static void build_worker(void* argument) {
+    BuildJob* job = (BuildJob*)argument;
+    Solver* solver = solver_create(&job->config);
+    SolveResult* result = (SolveResult*)malloc(sizeof(SolveResult));
+    if (solver == NULL || result == NULL) {
+        atomic_store(&job->failed, true);
+        solver_destroy(solver);
+        free(result);
+        return;
+    }
+    for (;;) {
+        uint32_t index = atomic_fetch_add(&job->next, 1);
+        if (index >= job->builder->deal_count) {
+            break;
+        }
+        GameState state;
+        uint32_t deal_number = job->builder->first_deal + index;
+        state_deal(&state, deal_number);
+        solver_solve(solver, &state, result);
+        if (!deal_db_builder_add(job->builder, deal_number, result)) {
+            atomic_store(&job->failed, true);
+        }
+        if (result->status == SolveWon) {
+            atomic_fetch_add(&job->won, 1);
+        }
+        else if (result->status == SolveUnsolvable) {
+            atomic_fetch_add(&job->unsolvable, 1);
+            if (result->nodes == 0) {
+                atomic_fetch_add(&job->rejected, 1);
+            }
+        }
+        atomic_fetch_add(&job->done, 1);
+    }
+    free(result);
+    solver_destroy(solver);
+}
+
+static int build(int argc, char* argv[]) {
+    if (argc < 5) {
+        printf("Usage: yukon_deals build FILE FIRST COUNT [--threads N] [--nodes N] [--tt MB] [--filter N] [--fpr P] [--algorithm dfs|wastar|pns|restart] [--weight W] [--tablebase FILE]\n");
+        return 1;
+    }
+    const char* path = argv[2];
+    uint32_t first = (uint32_t)strtoul(argv[3], NULL, 10);
+    uint32_t count = (uint32_t)strtoul(argv[4], NULL, 10);
+    int thread_count = platform_cpu_count();
+
+    static BuildJob job;
+    static Tablebase tablebase;
+    solver_default_config(&job.config);
+    for (int i = 5; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            thread_count = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--nodes") == 0) {
+            job.config.node_limit = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--tt") == 0) {
+            job.config.tt_mb = (size_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--filter") == 0) {
+            job.config.filter_states = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--fpr") == 0) {
+            job.config.filter_rate = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--algorithm") == 0 && !solver_algorithm_from_string(argv[i + 1], &job.config.algorithm)) {
+            printf("Unknown algorithm %s\n", argv[i + 1]);
+            return 1;
+        }
+        else if (strcmp(argv[i], "--weight") == 0) {
+            job.config.weight = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--tablebase") == 0) {
+            if (!tablebase_open(&tablebase, argv[i + 1])) {
+                printf("Could not open tablebase %s\n", argv[i + 1]);
+                return 1;
+            }
+            job.config.tablebase = &tablebase;
+        }
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    DealDbBuilder builder;
+    if (!deal_db_builder_init(&builder, first, count, job.config.node_limit)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    job.builder = &builder;
+
+    printf("Solving deals %u to %u on %d threads with %s, %llu nodes per deal\n", first, first + count - 1, thread_count,
+           solver_algorithm_name(job.config.algorithm), (unsigned long long)job.config.node_limit);
+    if (job.config.filter_states > 0) {
+        // Each thread has its own filter; a deal that runs out of positions to try is unknown
+        printf("Visited filter for %llu positions at %.3f%% false positives, %.1f MB per thread\n",
+               (unsigned long long)job.config.filter_states, job.config.filter_rate * 100.0,
+               visited_filter_bytes(job.config.filter_states, job.config.filter_rate) / (1024.0 * 1024.0));
+    }
+    uint64_t start = platform_time_ns();
+    PlatformThread* threads = (PlatformThread*)calloc((size_t)thread_count, sizeof(PlatformThread));
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        if (platform_thread_start(&threads[i], build_worker, &job)) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        build_worker(&job);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        platform_thread_join(&threads[i]);
+    }
+    free(threads);
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+
+    uint32_t won = atomic_load(&job.won);
+    uint32_t unsolvable = atomic_load(&job.unsolvable);
+    printf("%u won, %u unsolvable (%u rejected before searching), %u unknown in %.1f s (%.1f deals/s)\n", won, unsolvable,
+           atomic_load(&job.rejected), count - won - unsolvable, seconds, seconds > 0 ? count / seconds : 0.0);
+
+    bool ok = !atomic_load(&job.failed) && deal_db_builder_write(&builder, path);
+    deal_db_builder_free(&builder);
+    if (job.config.tablebase != NULL) {
+        tablebase_close(&tablebase);
+    }
+    if (!ok) {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    printf("Wrote %s\n", path);
+    return 0;
+}
+
+static _Atomic bool interrupted = false;
+
+static void on_interrupt(int signal_number) {
+    (void)signal_number;
+    atomic_store(&interrupted, true);
+}
+
+// One long depth first solve. With --checkpoint it saves its progress every --every nodes,
+// and on Ctrl+C, and the same command goes on from the last checkpoint.
+static int solve(int argc, char* argv[]) {
+    uint32_t deal_number = (uint32_t)strtoul(argv[2], NULL, 10);
+    const char* path = NULL;
+    bool save_table = false;
+    SolverConfig config;
+    solver_default_config(&config);
+    config.node_limit = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--table") == 0) {
+            save_table = true;
+        }
+        else if (i + 1 >= argc) {
+            break;
+        }
+        else if (strcmp(argv[i], "--nodes") == 0) {
+            config.node_limit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--tt") == 0) {
+            config.tt_mb = (size_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0) {
+            path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--every") == 0) {
+            config.checkpoint_nodes = strtoull(argv[++i], NULL, 10);
+        }
+    }
+
+    CheckpointWriter* writer = NULL;
+    if (path != NULL) {
+        writer = checkpoint_writer_create(path);
+        if (writer == NULL) {
+            printf("Out of memory\n");
+            return 1;
+        }
+        config.checkpoint = checkpoint_save;
+        config.checkpoint_context = writer;
+    }
+    config.stop = &interrupted;
+    Solver* solver = solver_create(&config);
+    SolveResult* result = (SolveResult*)malloc(sizeof(SolveResult));
+    if (solver == NULL || result == NULL) {
+        printf("Out of memory\n");
+        checkpoint_writer_destroy(writer);
+        solver_destroy(solver);
+        free(result);
+        return 1;
+    }
+
+    GameState state;
+    state_deal(&state, deal_number);
+    Checkpoint checkpoint;
+    bool resumed = path != NULL && checkpoint_load(path, save_table ? solver_table(solver) : NULL, &checkpoint);
+    if (resumed && checkpoint.progress.start_hash != state.hash) {
+        printf("%s is a checkpoint of another deal\n", path);
+        checkpoint_free(&checkpoint);
+        checkpoint_writer_destroy(writer);
+        solver_destroy(solver);
+        free(result);
+        return 1;
+    }
+    if (resumed) {
+        printf("Resuming deal #%u from %s: %llu nodes in %.1f s, checkpoint %u, table %s", deal_number, path,
+               (unsigned long long)checkpoint.header.nodes, (double)checkpoint.header.elapsed_ns / 1e9,
+               checkpoint.header.saves, checkpoint.table_loaded ? "loaded" : "not saved");
+        if (checkpoint.chunks_dropped > 0) {
+            printf(" (%u MB torn, dropped)", checkpoint.chunks_dropped * (CHECKPOINT_CHUNK_BYTES >> 20));
+        }
+        printf("\n");
+    }
+    else {
+        printf("Solving deal #%u", deal_number);
+        if (config.node_limit != 0) {
+            printf(", %llu nodes", (unsigned long long)config.node_limit);
+        }
+        printf("\n");
+    }
+    if (writer != NULL && !checkpoint_writer_start(writer, save_table ? solver_table(solver) : NULL, resumed ? &checkpoint : NULL)) {
+        printf("Could not write %s\n", path);
+    }
+
+    signal(SIGINT, on_interrupt);
+    uint64_t start = platform_time_ns();
+    if (!resumed || !solver_resume(solver, &state, &checkpoint.progress, checkpoint.table_loaded, result)) {
+        if (resumed) {
+            printf("The checkpoint does not fit this solver, starting over\n");
+        }
+        solver_solve(solver, &state, result);
+    }
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+    double total = seconds + (resumed ? (double)checkpoint.header.elapsed_ns / 1e9 : 0.0);
+    if (resumed) {
+        checkpoint_free(&checkpoint);
+    }
+
+    printf("Deal #%u: %s, %u moves, %llu nodes in %.1f s (%.1f s this run)\n", deal_number, solve_status_name(result->status),
+           result->length, (unsigned long long)result->nodes, total, seconds);
+    if (writer != NULL) {
+        CheckpointStats stats;
+        checkpoint_writer_stats(writer, &stats);
+        checkpoint_writer_destroy(writer);
+        printf("%u checkpoints (%u skipped, %u failed), %.1f MB of table written, %.2f s writing in the background\n",
+               stats.saves, stats.skipped, stats.failures, (double)stats.table_bytes_written / (1 << 20),
+               (double)stats.write_ns / 1e9);
+        if (result->status != SolveUnknown) {
+            checkpoint_remove(path);
+        }
+        else {
+            printf("Progress saved in %s, run the same command to go on\n", path);
+        }
+    }
+    free(result);
+    solver_destroy(solver);
+    return 0;
+}
+
+static void print_layer(const ExternalSearchStats* stats, void* context) {
+    uint64_t start = *(const uint64_t*)context;
+    printf("Layer %3u: %12llu positions, %13llu in all, %6.1f MB written, %6.1f MB read, %.1f s\n", stats->layers - 1,
+           (unsigned long long)stats->last_layer, (unsigned long long)stats->states, (double)stats->bytes_written / (1 << 20),
+           (double)stats->bytes_read / (1 << 20), (double)(platform_time_ns() - start) / 1e9);
+    fflush(stdout);
+}
+
+// Exhaustive breadth first search of one deal with the positions on disk in DIR
+static int explore(int argc, char* argv[]) {
+    uint32_t deal_number = (uint32_t)strtoul(argv[2], NULL, 10);
+    ExternalSearchConfig config;
+    external_search_default_config(&config);
+    config.directory = argv[3];
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--keep") == 0) {
+            config.keep_files = true;
+        }
+        else if (i + 1 >= argc) {
+            break;
+        }
+        else if (strcmp(argv[i], "--memory") == 0) {
+            config.memory_mb = (size_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--states") == 0) {
+            config.state_limit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--pruning") == 0) {
+            config.pruning = strcmp(argv[++i], "off") != 0;
+        }
+    }
+    uint64_t start = platform_time_ns();
+    config.stop = &interrupted;
+    config.on_layer = print_layer;
+    config.context = &start;
+    SolveResult* result = (SolveResult*)malloc(sizeof(SolveResult));
+    if (result == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    GameState state;
+    state_deal(&state, deal_number);
+    printf("Exploring deal #%u in %s with a %zu MB sort buffer\n", deal_number, config.directory, config.memory_mb);
+    signal(SIGINT, on_interrupt);
+    ExternalSearchStats stats;
+    external_search(&config, &state, result, &stats);
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+    if (stats.failed) {
+        printf("Could not write or read the files in %s\n", config.directory);
+    }
+    printf("Deal #%u: %s, %u moves, %llu positions in %u layers, %llu successors in %.1f s\n", deal_number,
+           solve_status_name(result->status), result->length, (unsigned long long)stats.states, stats.layers,
+           (unsigned long long)stats.generated, seconds);
+    printf("Duplicates: %llu within runs, %llu merged away; %u runs, front coding %.1f%% of %d byte records\n",
+           (unsigned long long)stats.run_duplicates, (unsigned long long)stats.merge_duplicates, stats.runs,
+           stats.record_bytes ? 100.0 * (double)stats.bytes_written / (double)stats.record_bytes : 0.0, EXTERNAL_RECORD_BYTES);
+    printf("I/O: %.1f MB written, %.1f MB read\n", (double)stats.bytes_written / (1 << 20), (double)stats.bytes_read / (1 << 20));
+    free(result);
+    return stats.failed ? 1 : 0;
+}
+
+static int show(const DealDatabase* db, uint32_t deal_number) {
+    DealInfo info;
+    if (!deal_db_lookup(db, deal_number, &info)) {
+        printf("Deal #%u is not in the database\n", deal_number);
+        return 1;
+    }
+    printf("Deal #%u: %s, %u moves, %u nodes searched\n", deal_number, solve_status_name(info.status),
+           info.length, info.nodes);
+    if (info.status != SolveWon) {
+        return 0;
+    }
+
+    Move line[SOLVER_MAX_LINE];
+    uint32_t length = deal_db_line(db, &info, line, SOLVER_MAX_LINE);
+    GameState state;
+    state_deal(&state, deal_number);
+    for (uint32_t i = 0; i < length; i++) {
+        char text[16];
+        if (!state_is_move_legal(&state, line[i])) {
+            printf("\nMove %u is illegal, the database was built with other rules\n", i + 1);
+            return 1;
+        }
+        move_to_string(&state, line[i], text);
+        printf("%s%s", i % 10 == 0 ? "\n" : " ", text);
+        state_apply_move(&state, line[i]);
+    }
+    printf("\n");
+    return 0;
+}
+
+static int stats(const DealDatabase* db) {
+    uint32_t unsolvable = 0;
+    uint64_t nodes = 0;
+    for (uint32_t i = 0; i < db->deal_count; i++) {
+        DealInfo info;
+        deal_db_lookup(db, db->first_deal + i, &info);
+        unsolvable += info.status == SolveUnsolvable;
+        nodes += info.nodes;
+    }
+    printf("Deals %u to %u, rules version %u, %llu nodes per deal\n", db->first_deal,
+           db->first_deal + db->deal_count - 1, db->rules_version, (unsigned long long)db->node_limit);
+    printf("Won:        %u (%.1f%%)\n", db->won_count, db->deal_count ? 100.0 * db->won_count / db->deal_count : 0.0);
+    printf("Unsolvable: %u\n", unsolvable);
+    printf("Unknown:    %u\n", db->deal_count - db->won_count - unsolvable);
+    printf("Nodes:      %llu\n", (unsigned long long)nodes);
+
+    if (db->won_count > 0) {
+        DealInfo info;
+        const int percentiles[] = { 0, 10, 33, 50, 67, 90, 100 };
+        printf("Solution length percentiles:");
+        for (int i = 0; i < 7; i++) {
+            uint32_t rank = (uint32_t)((uint64_t)(db->won_count - 1) * (uint64_t)percentiles[i] / 100);
+            deal_db_won_by_rank(db, rank, &info);
+            printf(" p%d=%u", percentiles[i], info.length);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "build") == 0) {
+        return build(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "solve") == 0) {
+        return solve(argc, argv);
+    }
+    if (argc >= 4 && strcmp(argv[1], "explore") == 0) {
+        return explore(argc, argv);
+    }
+    if (argc < 3 || (strcmp(argv[1], "show") != 0 && strcmp(argv[1], "stats") != 0)) {
+        printf("Usage: yukon_deals build FILE FIRST COUNT [--threads N] [--nodes N] [--tt MB] [--filter N] [--fpr P] [--algorithm dfs|wastar|pns|restart] [--weight W] [--tablebase FILE]\n");
+        printf("       yukon_deals show FILE DEAL\n");
+        printf("       yukon_deals stats FILE\n");
+        printf("       yukon_deals solve DEAL [--nodes N] [--tt MB] [--checkpoint FILE] [--every N] [--table]\n");
+        printf("       yukon_deals explore DEAL DIR [--memory MB] [--states N] [--pruning on|off] [--keep]\n");
+        return 1;
+    }
+
+    DealDatabase db;
+    if (!deal_db_open(&db, argv[2])) {
+        printf("%s is not a deal database\n", argv[2]);
+        return 1;
+    }
+    if (db.rules_version != YUKON_RULES_VERSION) {
+        printf("Warning: built with rules version %u, current rules are version %u\n", db.rules_version, YUKON_RULES_VERSION);
+    }
+    int status;
+    if (strcmp(argv[1], "show") == 0 && argc >= 4) {
+        status = show(&db, (uint32_t)strtoul(argv[3], NULL, 10));
+    }
+    else {
+        status = stats(&db);
+    }
+    deal_db_close(&db);
+    return status;
+}
@@ -0,0 +1,112 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_state.h"
+#include "move_journal.h"
+#include "replay.h"
+#include "platform.h"
+
+// Replays every game in a replay file and reports what it found.
+//
+//   yukon_replay FILE                 check and summarise all games
+//   yukon_replay FILE --print N       also print the final board of the first N games
+//   yukon_replay --generate COUNT FILE   write COUNT random games (for testing the reader)
+
+#define SCRATCH_CAPACITY 65536
+
+static int generate_games(const char* path, uint32_t count) {
+    ReplayWriter writer;
+    uint64_t rng = 12345;
+
+    if (!replay_writer_open(&writer, path, false)) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    for (uint32_t game = 0; game < count; game++) {
+        GameState state;
+        Move moves[YUKON_MAX_MOVES];
+        state_deal(&state, game);
+        replay_writer_begin_game(&writer, game);
+
+        // Random play, preferring foundation moves, for at most 200 moves
+        for (int step = 0; step < 200 && !state_is_won(&state); step++) {
+            int count_moves = state_generate_moves(&state, moves);
+            if (count_moves == 0) {
+                break;
+            }
+            Move move = PILE_IS_FOUNDATION(MOVE_TO(moves[0])) ? moves[0] : moves[rng_below(&rng, (uint32_t)count_moves)];
+            state_apply_move(&state, move);
+            replay_writer_add_move(&writer, move);
+        }
+        replay_writer_end_game(&writer, state_is_won(&state));
+    }
+    replay_writer_close(&writer);
+    printf("Wrote %u games to %s\n", count, path);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+        return generate_games(argv[3], (uint32_t)strtoul(argv[2], NULL, 10));
+    }
+    if (argc < 2) {
+        printf("Usage: yukon_replay FILE [--print N] | --generate COUNT FILE\n");
+        return 1;
+    }
+    int print_count = 0;
+    if (argc >= 4 && strcmp(argv[2], "--print") == 0) {
+        print_count = atoi(argv[3]);
+    }
+
+    ReplayReader reader;
+    if (!replay_reader_open(&reader, argv[1])) {
+        printf("%s is not a replay file\n", argv[1]);
+        return 1;
+    }
+    if (reader.rules_version != YUKON_RULES_VERSION) {
+        printf("Warning: recorded with rules version %u, replaying with %u\n", reader.rules_version, YUKON_RULES_VERSION);
+    }
+
+    static Move scratch_storage[SCRATCH_CAPACITY];
+    MoveJournal scratch;
+    journal_init(&scratch, scratch_storage, SCRATCH_CAPACITY);
+
+    uint64_t games = 0;
+    uint64_t moves = 0;
+    uint64_t wins = 0;
+    uint64_t illegal = 0;
+    uint64_t bytes = 0;
+    ReplayGame game;
+    GameState state;
+
+    uint64_t start = platform_time_ns();
+    while (replay_reader_next(&reader, &game)) {
+        games++;
+        moves += game.move_count;
+        bytes += game.length;
+        if (!replay_play_game(&game, &state, &scratch)) {
+            illegal++;
+            continue;
+        }
+        if (state_is_won(&state)) {
+            wins++;
+        }
+        if (print_count > 0) {
+            print_count--;
+            printf("Deal #%u, %u moves%s\n", game.deal_number, game.move_count, state_is_won(&state) ? ", won" : "");
+            state_print(&state, stdout);
+        }
+    }
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+
+    printf("Games:          %llu (%llu won, %llu with illegal moves)\n",
+           (unsigned long long)games, (unsigned long long)wins, (unsigned long long)illegal);
+    printf("Moves:          %llu, %.2f bytes per move\n",
+           (unsigned long long)moves, moves ? (double)bytes / (double)moves : 0.0);
+    printf("Time:           %.3f s, %.0f games/s, %.0f moves/s\n",
+           seconds, seconds > 0 ? games / seconds : 0.0, seconds > 0 ? moves / seconds : 0.0);
+
+    replay_reader_close(&reader);
+    return illegal ? 2 : 0;
+}
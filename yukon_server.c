@@ -0,0 +1,624 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_server.h"
+#include "game_state.h"
+#include "platform.h"
+
+// Hosts many Yukon games behind the line protocol of game_server.h, and a load generator
+// that plays random legal games against it.
+//
+//   yukon_server serve (--unix PATH | --tcp PORT) [--workers N] [--sessions N]
+//   yukon_server load (--unix PATH | --tcp PORT) [--threads N] [--connections N] [--sessions N] [--requests N]
+//
+// serve runs one epoll loop per worker thread; each accepts its own connections and keeps
+// them, so a session is only ever touched by one thread. Ctrl+C stops it and prints the
+// request latency percentiles. The socket side is Linux only.
+
+typedef struct ServerOptions {
+    const char* unix_path;
+    int tcp_port;
+    int workers;
+    uint32_t sessions;        // serve: arena size, load: sessions per connection
+    int threads;
+    int connections;          // Per load thread
+    uint64_t requests;        // Per load thread
+} ServerOptions;
+
+static void parse_options(int argc, char* argv[], ServerOptions* options) {
+    options->unix_path = NULL;
+    options->tcp_port = 0;
+    options->workers = platform_cpu_count();
+    options->sessions = 0;
+    options->threads = 1;
+    options->connections = 4;
+    options->requests = 1000000;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--unix") == 0) {
+            options->unix_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--tcp") == 0) {
+            options->tcp_port = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--workers") == 0) {
+            options->workers = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--sessions") == 0) {
+            options->sessions = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            options->threads = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--connections") == 0) {
+            options->connections = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--requests") == 0) {
+            options->requests = strtoull(argv[i + 1], NULL, 10);
+        }
+    }
+    if (options->workers < 1) {
+        options->workers = 1;
+    }
+    if (options->workers > SERVER_MAX_WORKERS) {
+        options->workers = SERVER_MAX_WORKERS;
+    }
+}
+
+static void print_usage() {
+    printf("Usage:\n");
+    printf("  yukon_server serve (--unix PATH | --tcp PORT) [--workers N] [--sessions N]\n");
+    printf("  yukon_server load (--unix PATH | --tcp PORT) [--threads N] [--connections N] [--sessions N] [--requests N]\n");
+}
+
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define INPUT_CAPACITY (SERVER_MAX_LINE * 4)
+#define OUTPUT_LIMIT (256 * 1024)   // Stop reading from a client that does not read its responses
+#define EPOLL_EVENTS 256
+
+static volatile sig_atomic_t stop_requested;
+static _Atomic uint64_t next_connection_id = 1;
+
+static void on_signal(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+typedef struct Client {
+    int fd;
+    ServerConnection connection;
+    uint32_t events;            // Registered with epoll
+    uint32_t input_length;
+    char input[INPUT_CAPACITY];
+    char* output;
+    size_t output_length;
+    size_t output_sent;
+    size_t output_capacity;
+} Client;
+
+typedef struct Worker {
+    GameServer* server;
+    int index;
+    int listen_fd;
+    PlatformThread thread;
+} Worker;
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Socket address from the options, for both bind and connect
+static int open_socket(const ServerOptions* options, bool listening) {
+    int fd;
+    if (options->unix_path != NULL) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(options->unix_path) >= sizeof(address.sun_path)) {
+            printf("Socket path %s is too long\n", options->unix_path);
+            return -1;
+        }
+        strcpy(address.sun_path, options->unix_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (listening) {
+            unlink(options->unix_path);
+        }
+        if ((listening ? bind(fd, (struct sockaddr*)&address, sizeof(address))
+                       : connect(fd, (struct sockaddr*)&address, sizeof(address))) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)options->tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        if ((listening ? bind(fd, (struct sockaddr*)&address, sizeof(address))
+                       : connect(fd, (struct sockaddr*)&address, sizeof(address))) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listening && (listen(fd, SOMAXCONN) != 0 || !set_nonblocking(fd))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void close_client(Worker* worker, int epoll_fd, Client* client) {
+    game_server_disconnect(worker->server, &client->connection);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    free(client->output);
+    free(client);
+}
+
+static bool append_output(Client* client, const char* data, size_t length) {
+    if (client->output_length + length > client->output_capacity) {
+        size_t capacity = client->output_capacity < 4096 ? 4096 : client->output_capacity * 2;
+        while (capacity < client->output_length + length) {
+            capacity *= 2;
+        }
+        char* output = (char*)realloc(client->output, capacity);
+        if (output == NULL) {
+            return false;
+        }
+        client->output = output;
+        client->output_capacity = capacity;
+    }
+    memcpy(client->output + client->output_length, data, length);
+    client->output_length += length;
+    return true;
+}
+
+// Writes what the socket takes; false when the client is gone
+static bool flush_output(Client* client) {
+    while (client->output_sent < client->output_length) {
+        ssize_t written = send(client->fd, client->output + client->output_sent,
+                               client->output_length - client->output_sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client->output_sent += (size_t)written;
+    }
+    client->output_length = 0;
+    client->output_sent = 0;
+    return true;
+}
+
+static void update_events(int epoll_fd, Client* client) {
+    size_t pending = client->output_length - client->output_sent;
+    uint32_t events = (pending < OUTPUT_LIMIT ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (events != client->events) {
+        struct epoll_event event = { .events = events, .data.ptr = client };
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+        client->events = events;
+    }
+}
+
+// Answers every complete line in the input; false to close the connection
+static bool process_input(Worker* worker, Client* client, uint64_t read_ns) {
+    char response[SERVER_MAX_LINE];
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < client->input_length; i++) {
+        if (client->input[i] != '\n') {
+            continue;
+        }
+        client->input[i] = '\0';
+        int length = game_server_handle(worker->server, &client->connection, client->input + start, response);
+        if (length == SERVER_QUIT) {
+            flush_output(client);
+            return false;
+        }
+        if (!append_output(client, response, (size_t)length)) {
+            return false;
+        }
+        game_server_record_latency(worker->server, worker->index, platform_time_ns() - read_ns);
+        start = i + 1;
+    }
+    memmove(client->input, client->input + start, client->input_length - start);
+    client->input_length -= start;
+    // A full buffer without a newline can never become a request
+    if (client->input_length == INPUT_CAPACITY) {
+        append_output(client, "ERR line too long\n", 18);
+        flush_output(client);
+        return false;
+    }
+    return true;
+}
+
+static void accept_clients(Worker* worker, int epoll_fd) {
+    for (;;) {
+        int fd = accept4(worker->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0) {
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        Client* client = (Client*)calloc(1, sizeof(Client));
+        if (client == NULL) {
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        client->events = EPOLLIN;
+        game_server_connect(worker->server, &client->connection, atomic_fetch_add(&next_connection_id, 1), worker->index);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            free(client);
+        }
+    }
+}
+
+static void worker_loop(void* argument) {
+    Worker* worker = (Worker*)argument;
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        return;
+    }
+    // Every worker waits on the listening socket, EPOLLEXCLUSIVE wakes only one of them
+    struct epoll_event listen_event = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &listen_event);
+
+    struct epoll_event events[EPOLL_EVENTS];
+    while (!stop_requested) {
+        int count = epoll_wait(epoll_fd, events, EPOLL_EVENTS, 200);
+        for (int e = 0; e < count; e++) {
+            Client* client = (Client*)events[e].data.ptr;
+            if (client == NULL) {
+                accept_clients(worker, epoll_fd);
+                continue;
+            }
+            bool open = (events[e].events & (EPOLLERR | EPOLLHUP)) == 0 || (events[e].events & EPOLLIN) != 0;
+            if (open && (events[e].events & EPOLLIN) != 0) {
+                ssize_t received = recv(client->fd, client->input + client->input_length,
+                                        INPUT_CAPACITY - client->input_length, 0);
+                if (received > 0) {
+                    client->input_length += (uint32_t)received;
+                    open = process_input(worker, client, platform_time_ns());
+                }
+                else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    open = false;
+                }
+            }
+            if (open) {
+                open = flush_output(client);
+            }
+            if (!open) {
+                close_client(worker, epoll_fd, client);
+                continue;
+            }
+            update_events(epoll_fd, client);
+        }
+    }
+    // Connections still open at shutdown are simply dropped with the process
+    close(epoll_fd);
+}
+
+static int serve(const ServerOptions* options) {
+    uint32_t sessions = options->sessions != 0 ? options->sessions : 65536 * (uint32_t)options->workers;
+    GameServer* server = game_server_create(sessions, options->workers, platform_time_ns());
+    if (server == NULL) {
+        printf("Could not allocate %u sessions\n", sessions);
+        return 1;
+    }
+    int listen_fd = open_socket(options, true);
+    if (listen_fd < 0) {
+        printf("Could not listen: %s\n", strerror(errno));
+        game_server_destroy(server);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    Worker workers[SERVER_MAX_WORKERS];
+    for (int w = 0; w < options->workers; w++) {
+        workers[w].server = server;
+        workers[w].index = w;
+        workers[w].listen_fd = listen_fd;
+        platform_thread_start(&workers[w].thread, worker_loop, &workers[w]);
+    }
+    char address[128];
+    if (options->unix_path != NULL) {
+        snprintf(address, sizeof(address), "%s", options->unix_path);
+    }
+    else {
+        snprintf(address, sizeof(address), "127.0.0.1:%d", options->tcp_port);
+    }
+    printf("Serving %u sessions with %d workers on %s (%.1f MB%s), Ctrl+C to stop\n", sessions, options->workers,
+           address, server->block_size / (1024.0 * 1024.0), server->huge_pages ? ", huge pages" : "");
+    fflush(stdout);
+    for (int w = 0; w < options->workers; w++) {
+        platform_thread_join(&workers[w].thread);
+    }
+
+    ServerStats stats;
+    game_server_stats(server, &stats);
+    printf("%llu requests, latency p50 %.1f us, p99 %.1f us, max %.1f us\n", (unsigned long long)stats.requests,
+           stats.p50_us, stats.p99_us, stats.max_us);
+    close(listen_fd);
+    if (options->unix_path != NULL) {
+        unlink(options->unix_path);
+    }
+    game_server_destroy(server);
+    return 0;
+}
+
+// Load generator: every connection keeps its sessions in step with local engine states
+// and sends one legal random move per session per round, all pipelined.
+
+typedef struct LoadSession {
+    uint32_t id;
+    GameState state;
+    int moves;
+} LoadSession;
+
+typedef struct LoadThread {
+    const ServerOptions* options;
+    uint64_t seed;
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t games;
+    PlatformThread thread;
+} LoadThread;
+
+typedef struct LoadConnection {
+    int fd;
+    char input[1 << 16];
+    size_t input_length;
+    size_t input_start;
+} LoadConnection;
+
+static bool send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Next response line, without its newline, or NULL when the server went away
+static const char* read_line(LoadConnection* connection) {
+    for (;;) {
+        char* begin = connection->input + connection->input_start;
+        char* newline = (char*)memchr(begin, '\n', connection->input_length - connection->input_start);
+        if (newline != NULL) {
+            *newline = '\0';
+            connection->input_start = (size_t)(newline + 1 - connection->input);
+            return begin;
+        }
+        memmove(connection->input, begin, connection->input_length - connection->input_start);
+        connection->input_length -= connection->input_start;
+        connection->input_start = 0;
+        ssize_t received = recv(connection->fd, connection->input + connection->input_length,
+                                sizeof(connection->input) - connection->input_length, 0);
+        if (received <= 0) {
+            return NULL;
+        }
+        connection->input_length += (size_t)received;
+    }
+}
+
+static void load_loop(void* argument) {
+    LoadThread* load = (LoadThread*)argument;
+    const ServerOptions* options = load->options;
+    uint32_t session_count = options->sessions != 0 ? options->sessions : 1000;
+    int connection_count = options->connections;
+    LoadConnection* connections = (LoadConnection*)calloc((size_t)connection_count, sizeof(LoadConnection));
+    LoadSession* sessions = (LoadSession*)calloc((size_t)connection_count * session_count, sizeof(LoadSession));
+    char* batch = (char*)malloc((size_t)session_count * 48);
+    bool* reset = (bool*)calloc(session_count, sizeof(bool));
+    uint64_t rng = load->seed;
+    if (connections == NULL || sessions == NULL || batch == NULL || reset == NULL) {
+        load->errors++;
+        goto done;
+    }
+    for (int c = 0; c < connection_count; c++) {
+        connections[c].fd = open_socket(options, false);
+        if (connections[c].fd < 0) {
+            printf("Could not connect: %s\n", strerror(errno));
+            load->errors++;
+            connection_count = c;
+            goto done;
+        }
+    }
+
+    // Open the sessions, one pipelined batch per connection
+    for (int c = 0; c < connection_count; c++) {
+        size_t length = 0;
+        LoadSession* own = sessions + (size_t)c * session_count;
+        for (uint32_t s = 0; s < session_count; s++) {
+            length += (size_t)sprintf(batch + length, "NEW\n");
+        }
+        send_all(connections[c].fd, batch, length);
+        for (uint32_t s = 0; s < session_count; s++) {
+            const char* line = read_line(&connections[c]);
+            uint32_t deal;
+            if (line == NULL || sscanf(line, "OK %u %u", &own[s].id, &deal) != 2) {
+                load->errors++;
+                goto done;
+            }
+            state_deal(&own[s].state, deal);
+        }
+        load->requests += session_count;
+    }
+
+    while (load->requests < options->requests) {
+        for (int c = 0; c < connection_count && load->requests < options->requests; c++) {
+            LoadSession* own = sessions + (size_t)c * session_count;
+            size_t length = 0;
+            uint32_t expected = 0;
+            for (uint32_t s = 0; s < session_count; s++) {
+                Move moves[YUKON_MAX_MOVES];
+                int count = state_is_won(&own[s].state) || own[s].moves >= 200 ? 0
+                          : state_generate_moves(&own[s].state, moves);
+                reset[s] = count == 0;
+                if (reset[s]) {
+                    // Stuck, won or long enough: start a fresh deal in its place
+                    length += (size_t)sprintf(batch + length, "CLOSE %u\nNEW %u\n", own[s].id, (uint32_t)rng_next(&rng));
+                    expected += 2;
+                    continue;
+                }
+                char text[16];
+                Move move = moves[rng_below(&rng, (uint32_t)count)];
+                move_to_string(&own[s].state, move, text);
+                state_apply_move(&own[s].state, move);
+                own[s].moves++;
+                length += (size_t)sprintf(batch + length, "MOVE %u %s\n", own[s].id, text);
+                expected++;
+            }
+            if (!send_all(connections[c].fd, batch, length)) {
+                load->errors++;
+                goto done;
+            }
+            for (uint32_t s = 0; s < session_count; s++) {
+                const char* line = read_line(&connections[c]);
+                if (line == NULL) {
+                    load->errors++;
+                    goto done;
+                }
+                if (reset[s]) {
+                    line = line[0] == 'O' ? read_line(&connections[c]) : NULL;
+                    uint32_t deal;
+                    if (line == NULL || sscanf(line, "OK %u %u", &own[s].id, &deal) != 2) {
+                        load->errors++;
+                        goto done;
+                    }
+                    state_deal(&own[s].state, deal);
+                    own[s].moves = 0;
+                    load->games++;
+                }
+                else if (line[0] != 'O') {
+                    load->errors++;
+                }
+            }
+            load->requests += expected;
+        }
+    }
+
+done:
+    for (int c = 0; c < connection_count; c++) {
+        close(connections[c].fd);
+    }
+    free(connections);
+    free(sessions);
+    free(batch);
+    free(reset);
+}
+
+static int load(const ServerOptions* options) {
+    if (options->threads < 1 || options->connections < 1) {
+        print_usage();
+        return 1;
+    }
+    LoadThread* threads = (LoadThread*)calloc((size_t)options->threads, sizeof(LoadThread));
+    if (threads == NULL) {
+        return 1;
+    }
+    uint64_t start = platform_time_ns();
+    for (int t = 0; t < options->threads; t++) {
+        threads[t].options = options;
+        threads[t].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(t + 1);
+        platform_thread_start(&threads[t].thread, load_loop, &threads[t]);
+    }
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t games = 0;
+    for (int t = 0; t < options->threads; t++) {
+        platform_thread_join(&threads[t].thread);
+        requests += threads[t].requests;
+        errors += threads[t].errors;
+        games += threads[t].games;
+    }
+    double seconds = (platform_time_ns() - start) / 1e9;
+    printf("%llu requests in %.2f s, %.0f requests/s, %llu games finished, %llu errors\n", (unsigned long long)requests,
+           seconds, requests / seconds, (unsigned long long)games, (unsigned long long)errors);
+
+    // The server's own view of the run
+    LoadConnection* connection = (LoadConnection*)calloc(1, sizeof(LoadConnection));
+    if (connection != NULL) {
+        connection->fd = open_socket(options, false);
+        const char* line = NULL;
+        if (connection->fd >= 0 && send_all(connection->fd, "STATS\n", 6)) {
+            line = read_line(connection);
+        }
+        if (line != NULL) {
+            printf("Server: %s\n", line);
+        }
+        if (connection->fd >= 0) {
+            close(connection->fd);
+        }
+        free(connection);
+    }
+    free(threads);
+    return errors == 0 ? 0 : 1;
+}
+
+#else
+
+static int serve(const ServerOptions* options) {
+    (void)options;
+    printf("yukon_server needs epoll and is only supported on Linux\n");
+    return 1;
+}
+
+static int load(const ServerOptions* options) {
+    return serve(options);
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    parse_options(argc, argv, &options);
+    if (options.unix_path == NULL && options.tcp_port == 0) {
+        print_usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "serve") == 0) {
+        return serve(&options);
+    }
+    if (strcmp(argv[1], "load") == 0) {
+        return load(&options);
+    }
+    print_usage();
+    return 1;
+}
@@ -0,0 +1,81 @@
+#define _CRT_SECURE_NO_WARNINGS 1 // To allow unsafe code
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_state.h"
+#include "tablebase.h"
+#include "platform.h"
+
+// Builds and inspects endgame tablebases.
+//
+//   yukon_tablebase build FILE MAX_CARDS [--threads N]
+//   yukon_tablebase stats FILE
+
+static int build(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: yukon_tablebase build FILE MAX_CARDS [--threads N]\n");
+        return 1;
+    }
+    const char* path = argv[2];
+    int max_cards = atoi(argv[3]);
+    int thread_count = platform_cpu_count();
+    for (int i = 4; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            thread_count = atoi(argv[i + 1]);
+        }
+    }
+    if (max_cards < 1 || max_cards > TABLEBASE_MAX_CARDS) {
+        printf("MAX_CARDS must be 1 to %d\n", TABLEBASE_MAX_CARDS);
+        return 1;
+    }
+
+    uint64_t positions = tablebase_position_count(max_cards);
+    printf("Solving %llu positions with up to %d tableau cards on %d threads (%.1f MB file)\n",
+           (unsigned long long)positions, max_cards, thread_count, positions * 9.0 / (1 << 20));
+    TablebaseBuildStats stats;
+    uint64_t start = platform_time_ns();
+    if (!tablebase_build(path, max_cards, thread_count, &stats)) {
+        printf("Could not build %s\n", path);
+        return 1;
+    }
+    double seconds = (double)(platform_time_ns() - start) / 1e9;
+    printf("%llu won, %llu lost, longest win %d moves, %.1f s\n", (unsigned long long)(stats.positions - stats.lost),
+           (unsigned long long)stats.lost, stats.longest, seconds);
+    printf("Wrote %s\n", path);
+    return 0;
+}
+
+static int stats(const Tablebase* tablebase) {
+    uint64_t by_distance[256] = { 0 };
+    for (uint64_t i = 0; i < tablebase->entry_count; i++) {
+        by_distance[tablebase->values[i]]++;
+    }
+    printf("Up to %u tableau cards, rules version %u, %llu positions\n", tablebase->max_cards,
+           tablebase->rules_version, (unsigned long long)tablebase->entry_count);
+    printf("Lost: %llu\n", (unsigned long long)by_distance[TABLEBASE_LOST]);
+    for (int distance = 1; distance < TABLEBASE_LOST; distance++) {
+        if (by_distance[distance] > 0) {
+            printf("Won in %3d: %llu\n", distance, (unsigned long long)by_distance[distance]);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "build") == 0) {
+        return build(argc, argv);
+    }
+    if (argc < 3 || strcmp(argv[1], "stats") != 0) {
+        printf("Usage: yukon_tablebase build FILE MAX_CARDS [--threads N]\n");
+        printf("       yukon_tablebase stats FILE\n");
+        return 1;
+    }
+    Tablebase tablebase;
+    if (!tablebase_open(&tablebase, argv[2])) {
+        printf("%s is not a tablebase for the current rules\n", argv[2]);
+        return 1;
+    }
+    int status = stats(&tablebase);
+    tablebase_close(&tablebase);
+    return status;
+}
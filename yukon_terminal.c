@@ -5,12 +5,20 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include "game_state.h"
+#include "move_journal.h"
+#include "replay.h"
+#include "deal_database.h"
+#include "snapshot.h"
+#include "determinize.h"
+#include "trace.h"
+#include "platform.h"
 
 
 typedef struct Card {
 	int value; // 1-13 (Ace, 2, 3..., Jack, Queen, King)
 	int suit; // (1-4, Hearts, Diamonds, Clubs, Spades)
-	bool is_hidden; // TODO implement in deal_cards logic and in print_seven_rows logic, and remember to set last card visible when all are hidden
+	bool is_hidden; // Face down, the last card of a row is turned up when it is uncovered
 	struct Card* next;
 } Card;
 
@@ -55,6 +63,7 @@ Card* create_deck() {
 			new_card = (Card*)malloc(sizeof(Card)); // malloc is used to allocate memory dynamically.
 			new_card->value = newValue;
 			new_card->suit = suit;
+			new_card->is_hidden = false;
 			new_card->next = deck;
 			deck = new_card;
 		}
@@ -62,6 +71,24 @@ Card* create_deck() {
 	return deck;
 }
 
+// Builds the deck in the order the engine shuffles it for this deal number, so a deal
+// number always gives the same game (replays rely on that)
+Card* create_deck_for_deal(uint32_t deal_number) {
+	uint8_t order[YUKON_CARDS];
+	deal_order(deal_number, order);
+
+	Card* deck = NULL;
+	for (int i = YUKON_CARDS - 1; i >= 0; i--) {
+		Card* new_card = (Card*)malloc(sizeof(Card));
+		new_card->value = CARD_VALUE(order[i]);
+		new_card->suit = CARD_SUIT_NUMBER(order[i]);
+		new_card->is_hidden = false;
+		new_card->next = deck;
+		deck = new_card;
+	}
+	return deck;
+}
+
 Card* get_card_by_index(Card* deck, int deckIndex) {
 	if (deckIndex < 0) {
 		return NULL;
@@ -171,6 +198,15 @@ void deal_cards(Card** deck, Card** seven_rows) {
 			card_counter++;
 		}
 	}
+
+	// Row i starts with i cards face down
+	for (int i = 1; i < 7; i++) {
+		Card* card = seven_rows[i];
+		for (int ii = 0; ii < i && card != NULL; ii++) {
+			card->is_hidden = true;
+			card = card->next;
+		}
+	}
 }
 
 void print_deck(Card* deck) {
@@ -220,7 +256,10 @@ void print_seven_rows(Card** seven_rows, Card** four_pockets) {
 				current_card = current_card->next;
 				k++;
 			}
-			if (current_card != NULL) {
+			if (current_card != NULL && current_card->is_hidden) {
+				printf("  []");
+			}
+			else if (current_card != NULL) {
 				printf("%2s%-2s", values[current_card->value - 1], suits[current_card->suit - 1]);
 			}
 			else {
@@ -260,6 +299,9 @@ char convert_to_char(int value) {
 	else if (value == 13) {
 		return 'K';
 	}
+	else if (value == 10) {
+		return 'T';
+	}
 	else {
 		return value <= 9 ? (value + '0') : 0;
 	}
@@ -338,8 +380,21 @@ Card* get_card(LocationTranslator* lt, Card* seven_rows[7], GetCardType type, bo
 				}
 			}
 		}
-		// If card_str is empty, return the top card of the row, 
+		// If card_str is empty, take the last card of the row (the one that can be played)
 		else {
+			Card* prevCard = NULL;
+			while (current_row != NULL && current_row->next != NULL) {
+				prevCard = current_row;
+				current_row = current_row->next;
+			}
+			if (set_prev_to_null && current_row != NULL) {
+				if (prevCard != NULL) {
+					prevCard->next = NULL;
+				}
+				else {
+					seven_rows[index - 1] = NULL;
+				}
+			}
 			return current_row;
 		}
 	}
@@ -354,8 +409,8 @@ bool is_move_allowed_to_seven_rows(Card* from, Card* to) {
         is_allowed = false;
     }
 
-    // Kuløren må ikke være den samme
-    if (from->suit == to->suit) {
+    // Farven må ikke være den samme (Hearts/Diamonds are red, Clubs/Spades black)
+    if ((from->suit <= 2) == (to->suit <= 2)) {
         is_allowed = false;
     }
 
@@ -369,10 +424,11 @@ bool is_move_allowed_to_four_pockets(Card* from, Card* to) {
 	}
 	else {
 		if (to != NULL) {
-			if ((from->value + 1) != to->value) {
+			// Foundations are built up in the same suit
+			if (from->value != (to->value + 1)) {
 				is_allowed = false;
 			}
-			if (from->suit == to->suit) {
+			if (from->suit != to->suit) {
 				is_allowed = false;
 			}
 		}
@@ -408,6 +464,431 @@ void cleanup_resources(Card* deck, Card* seven_rows[7], Card* four_pockets[4]) {
 
 
 
+int count_cards(Card* list) {
+	int count = 0;
+	while (list != NULL) {
+		count++;
+		list = list->next;
+	}
+	return count;
+}
+
+Card* get_last_card(Card* list) {
+	while (list != NULL && list->next != NULL) {
+		list = list->next;
+	}
+	return list;
+}
+
+void append_cards(Card** pile, Card* cards) {
+	if (*pile == NULL) {
+		*pile = cards;
+	}
+	else {
+		get_last_card(*pile)->next = cards;
+	}
+}
+
+// Unlinks the last count cards of a pile and returns them
+Card* detach_last_cards(Card** pile, int count) {
+	int keep = count_cards(*pile) - count;
+	if (keep <= 0) {
+		Card* cards = *pile;
+		*pile = NULL;
+		return cards;
+	}
+	Card* last_kept = get_card_by_index(*pile, keep - 1);
+	Card* cards = last_kept->next;
+	last_kept->next = NULL;
+	return cards;
+}
+
+// Piles are numbered like in the move journal: 0-6 the seven rows, 7-10 the four pockets
+Card** get_pile(int pile, Card* seven_rows[7], Card* four_pockets[4]) {
+	if (PILE_IS_FOUNDATION(pile)) {
+		return &four_pockets[pile - PILE_FOUNDATION];
+	}
+	return &seven_rows[pile];
+}
+
+void move_pile_cards(int from, int to, int count, Card* seven_rows[7], Card* four_pockets[4]) {
+	Card* cards = detach_last_cards(get_pile(from, seven_rows, four_pockets), count);
+	append_cards(get_pile(to, seven_rows, four_pockets), cards);
+}
+
+// Turns the last card of a row face up once the cards on top of it are gone
+bool reveal_top_card(Card* seven_rows[7], int row) {
+	Card* top = get_last_card(seven_rows[row]);
+	if (top != NULL && top->is_hidden) {
+		top->is_hidden = false;
+		return true;
+	}
+	return false;
+}
+
+Move undo_move(MoveJournal* journal, Card* seven_rows[7], Card* four_pockets[4]) {
+	Move move = journal_undo(journal);
+	if (move == MOVE_NONE) {
+		printf("Nothing to undo\n");
+		return move;
+	}
+	if (move & MOVE_REVEAL) {
+		get_last_card(seven_rows[MOVE_FROM(move)])->is_hidden = true;
+	}
+	move_pile_cards(MOVE_TO(move), MOVE_FROM(move), MOVE_COUNT(move), seven_rows, four_pockets);
+	return move;
+}
+
+Move redo_move(MoveJournal* journal, Card* seven_rows[7], Card* four_pockets[4]) {
+	Move move = journal_redo(journal);
+	if (move == MOVE_NONE) {
+		printf("Nothing to redo\n");
+		return move;
+	}
+	move_pile_cards(MOVE_FROM(move), MOVE_TO(move), MOVE_COUNT(move), seven_rows, four_pockets);
+	reveal_top_card(seven_rows, MOVE_FROM(move));
+	return move;
+}
+
+// Replays use the engine pile numbers, where a foundation belongs to a suit instead of a pocket.
+// Call it after the move was made.
+Move to_engine_move(Move move, Card* four_pockets[4]) {
+	int to = MOVE_TO(move);
+	if (PILE_IS_FOUNDATION(to)) {
+		Card* pocket = four_pockets[to - PILE_FOUNDATION];
+		return MOVE_MAKE(MOVE_FROM(move), PILE_FOUNDATION + pocket->suit - 1, 1);
+	}
+	return MOVE_WITHOUT_FLAGS(move);
+}
+
+// Flat engine copy of the board. pocket_suit tells which suit each pocket holds,
+// since a pocket takes whatever suit is put there first.
+void board_to_state(Card* seven_rows[7], Card* four_pockets[4], GameState* state, uint8_t pocket_suit[4]) {
+	memset(state, 0, sizeof(*state));
+	int position = 0;
+	for (int column = 0; column < 7; column++) {
+		bool hidden_prefix = true;
+		for (Card* card = seven_rows[column]; card != NULL; card = card->next) {
+			state->cards[position++] = CARD_CODE(card->value, card->suit);
+			state->column_length[column]++;
+			hidden_prefix = hidden_prefix && card->is_hidden;
+			if (hidden_prefix) {
+				state->hidden_count[column]++;
+			}
+		}
+	}
+	for (int pocket = 0; pocket < 4; pocket++) {
+		pocket_suit[pocket] = SNAPSHOT_NO_SUIT;
+		if (four_pockets[pocket] != NULL) {
+			pocket_suit[pocket] = (uint8_t)(four_pockets[pocket]->suit - 1);
+			state->foundation[pocket_suit[pocket]] = (uint8_t)count_cards(four_pockets[pocket]);
+		}
+	}
+	state_rehash(state);
+}
+
+Card* make_card(uint8_t code, bool is_hidden) {
+	Card* card = (Card*)malloc(sizeof(Card));
+	card->value = CARD_VALUE(code);
+	card->suit = CARD_SUIT_NUMBER(code);
+	card->is_hidden = is_hidden;
+	card->next = NULL;
+	return card;
+}
+
+// Replaces the board with the given state
+void state_to_board(const GameState* state, const uint8_t pocket_suit[4], Card* seven_rows[7], Card* four_pockets[4]) {
+	int position = 0;
+	for (int column = 0; column < 7; column++) {
+		free_card_list(seven_rows[column]);
+		seven_rows[column] = NULL;
+		for (int i = 0; i < state->column_length[column]; i++) {
+			append_cards(&seven_rows[column], make_card(state->cards[position++], i < state->hidden_count[column]));
+		}
+	}
+	for (int pocket = 0; pocket < 4; pocket++) {
+		free_card_list(four_pockets[pocket]);
+		four_pockets[pocket] = NULL;
+		if (pocket_suit[pocket] == SNAPSHOT_NO_SUIT) {
+			continue;
+		}
+		for (int rank = 0; rank < state->foundation[pocket_suit[pocket]]; rank++) {
+			append_cards(&four_pockets[pocket], make_card((uint8_t)(pocket_suit[pocket] * YUKON_RANKS + rank), false));
+		}
+	}
+}
+
+bool save_game(const char* path, uint32_t deal_number, uint32_t move_count, Card* seven_rows[7], Card* four_pockets[4]) {
+	GameState state;
+	uint8_t pocket_suit[4];
+	Snapshot snapshot;
+	board_to_state(seven_rows, four_pockets, &state, pocket_suit);
+	snapshot_capture(&snapshot, &state, deal_number, move_count, pocket_suit);
+	return snapshot_save(&snapshot, path);
+}
+
+bool load_game(const char* path, uint32_t* deal_number, Card* seven_rows[7], Card* four_pockets[4]) {
+	GameState state;
+	Snapshot snapshot;
+	if (!snapshot_load(&snapshot, path) || !snapshot_restore(&snapshot, &state)) {
+		return false;
+	}
+	state_to_board(&state, snapshot.pocket_suit, seven_rows, four_pockets);
+	*deal_number = snapshot.deal_number;
+	return true;
+}
+
+// Prints the move that wins the most deals of the face down cards, as a command
+void print_hint(FairHinter* hinter, Card* seven_rows[7], Card* four_pockets[4]) {
+	GameState state;
+	uint8_t pocket_suit[4];
+	FairHint hint;
+	board_to_state(seven_rows, four_pockets, &state, pocket_suit);
+	if (!fair_hinter_run(hinter, &state, &hint) || hint.move == MOVE_NONE) {
+		printf("No move\n");
+		return;
+	}
+
+	int from = MOVE_FROM(hint.move);
+	int to = MOVE_TO(hint.move);
+	Card* card = get_card_by_index(seven_rows[from], count_cards(seven_rows[from]) - MOVE_COUNT(hint.move));
+	char command[20];
+	if (PILE_IS_FOUNDATION(to)) {
+		// The pocket that already holds the suit, or the first empty one
+		int pocket = -1;
+		for (int i = 0; i < 4 && pocket < 0; i++) {
+			if (pocket_suit[i] == to - PILE_FOUNDATION) {
+				pocket = i;
+			}
+		}
+		for (int i = 0; i < 4 && pocket < 0; i++) {
+			if (pocket_suit[i] == SNAPSHOT_NO_SUIT) {
+				pocket = i;
+			}
+		}
+		sprintf(command, "C%d->F%d", from + 1, pocket + 1);
+	}
+	else {
+		sprintf(command, "C%d:%c%c->C%d", from + 1, convert_to_char(card->value), "HDCS"[card->suit - 1], to + 1);
+	}
+	printf("Hint: %s, wins %.0f%% of %u deals of the face down cards\n", command, 100.0 * hint.win_rate, hint.samples);
+}
+
+void write_trace(const char* path) {
+	uint64_t events;
+	uint64_t dropped;
+	if (trace_write_json(path, &events, &dropped)) {
+		printf("Wrote %llu trace events to %s (%llu dropped)\n", (unsigned long long)events, path, (unsigned long long)dropped);
+	}
+	else {
+		printf("Could not write the trace to %s\n", path);
+	}
+}
+
+// Batch mode (--batch FILE): the commands of FILE, or of stdin for "-", are played on the
+// engine state without building the board or printing it after each move, and only the
+// final position and counts are printed. The file is read in large chunks and split on
+// white space like the interactive prompt does. Moves follow the engine's rules.
+
+#define BATCH_CHUNK (1 << 20)
+#define BATCH_JOURNAL_CAPACITY (1 << 16)
+#define BATCH_MAX_REPORTED 10
+
+typedef struct BatchStats {
+	uint64_t commands;
+	uint64_t moves;
+	uint64_t undos;
+	uint64_t redos;
+	uint64_t skipped; // Hint, save, load and trace commands mean nothing here
+	uint64_t rejected;
+} BatchStats;
+
+// C2:5H->C5, C1->C4 or C1->F1 as an engine move. Pockets take the suit of the ace put
+// there first, so *pocket is set to the pocket a foundation move goes to.
+bool parse_batch_move(const char* text, const GameState* state, const uint8_t pocket_suit[4], Move* move, int* pocket) {
+	if (text[0] != 'C' || text[1] < '1' || text[1] > '7') {
+		return false;
+	}
+	int from = text[1] - '1';
+	int length = state->column_length[from];
+	int start = state_column_start(state, from);
+	int count = 1;
+	const char* arrow = strstr(text, "->");
+	if (arrow == NULL || length == 0) {
+		return false;
+	}
+	if (text[2] == ':') {
+		char card_text[4] = { 0 };
+		uint8_t card;
+		if (arrow - text - 3 < 2 || arrow - text - 3 > 3) {
+			return false;
+		}
+		memcpy(card_text, text + 3, (size_t)(arrow - text - 3));
+		if (!card_from_string(card_text, &card)) {
+			return false;
+		}
+		count = 0;
+		for (int i = state->hidden_count[from]; i < length && count == 0; i++) {
+			if (state->cards[start + i] == card) {
+				count = length - i;
+			}
+		}
+		if (count == 0) {
+			return false;
+		}
+	}
+	else if (arrow != text + 2) {
+		return false;
+	}
+
+	char target = arrow[2];
+	int index = arrow[3] - '1';
+	if (arrow[4] != '\0') {
+		return false;
+	}
+	if (target == 'C' && index >= 0 && index < YUKON_COLUMNS) {
+		*move = MOVE_MAKE(from, index, count);
+		*pocket = -1;
+		return state_is_move_legal(state, *move);
+	}
+	if (target == 'F' && index >= 0 && index < YUKON_FOUNDATIONS && count == 1) {
+		uint8_t card = state->cards[start + length - 1];
+		int suit = CARD_SUIT(card);
+		if (pocket_suit[index] == SNAPSHOT_NO_SUIT) {
+			// Like is_move_allowed_to_four_pockets: an empty pocket only takes an ace, and
+			// never of a suit another pocket holds
+			if (CARD_RANK(card) != 0) {
+				return false;
+			}
+			for (int i = 0; i < YUKON_FOUNDATIONS; i++) {
+				if (pocket_suit[i] == suit) {
+					return false;
+				}
+			}
+		}
+		else if (pocket_suit[index] != suit) {
+			return false;
+		}
+		*move = MOVE_MAKE(from, PILE_FOUNDATION + suit, 1);
+		*pocket = index;
+		return state_is_move_legal(state, *move);
+	}
+	return false;
+}
+
+int run_batch(uint32_t deal_number, const char* path) {
+	FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+	char* chunk = (char*)malloc(BATCH_CHUNK);
+	Move* journal_storage = (Move*)malloc(BATCH_JOURNAL_CAPACITY * sizeof(Move));
+	if (in == NULL || chunk == NULL || journal_storage == NULL) {
+		printf("Could not read %s\n", path);
+		free(chunk);
+		free(journal_storage);
+		return 1;
+	}
+
+	GameState state;
+	MoveJournal journal;
+	BatchStats stats = { 0 };
+	uint8_t pocket_suit[4] = { SNAPSHOT_NO_SUIT, SNAPSHOT_NO_SUIT, SNAPSHOT_NO_SUIT, SNAPSHOT_NO_SUIT };
+	uint8_t last_pocket[4] = { 0 }; // Where redo puts an ace back
+	char token[32];
+	int token_length = 0;
+	uint64_t line = 1;
+	state_deal(&state, deal_number);
+	journal_init(&journal, journal_storage, BATCH_JOURNAL_CAPACITY);
+
+	uint64_t start = platform_time_ns();
+	for (;;) {
+		size_t read = fread(chunk, 1, BATCH_CHUNK, in);
+		// At the end of the input a final blank flushes the last token
+		if (read == 0) {
+			chunk[0] = '\n';
+		}
+		for (size_t i = 0; i < (read == 0 ? 1 : read); i++) {
+			char c = chunk[i];
+			if (!isspace((unsigned char)c)) {
+				if (token_length < (int)sizeof(token) - 1) {
+					token[token_length] = (char)toupper((unsigned char)c);
+				}
+				token_length++;
+				continue;
+			}
+			if (token_length > 0) {
+				token[token_length < (int)sizeof(token) ? token_length : (int)sizeof(token) - 1] = '\0';
+				stats.commands++;
+
+				Move move;
+				int pocket;
+				if (strcmp(token, "U") == 0) {
+					move = journal_undo(&journal);
+					if (move != MOVE_NONE) {
+						state_undo_move(&state, move);
+						stats.undos++;
+						int suit = MOVE_TO(move) - PILE_FOUNDATION;
+						for (int p = 0; p < 4 && suit >= 0 && state.foundation[suit] == 0; p++) {
+							if (pocket_suit[p] == suit) {
+								pocket_suit[p] = SNAPSHOT_NO_SUIT;
+								last_pocket[suit] = (uint8_t)p;
+							}
+						}
+					}
+				}
+				else if (strcmp(token, "R") == 0) {
+					move = journal_redo(&journal);
+					if (move != MOVE_NONE) {
+						state_apply_move(&state, move);
+						stats.redos++;
+						int suit = MOVE_TO(move) - PILE_FOUNDATION;
+						if (suit >= 0 && state.foundation[suit] == 1) {
+							pocket_suit[last_pocket[suit]] = (uint8_t)suit;
+						}
+					}
+				}
+				else if (strcmp(token, "H") == 0 || strcmp(token, "S") == 0 || strcmp(token, "L") == 0 || strcmp(token, "T") == 0) {
+					stats.skipped++;
+				}
+				else if (token_length < (int)sizeof(token) && parse_batch_move(token, &state, pocket_suit, &move, &pocket)) {
+					journal_apply(&journal, &state, move);
+					if (pocket >= 0) {
+						pocket_suit[pocket] = (uint8_t)(MOVE_TO(move) - PILE_FOUNDATION);
+					}
+					stats.moves++;
+				}
+				else {
+					if (stats.rejected < BATCH_MAX_REPORTED) {
+						printf("Line %llu: %s not allowed\n", (unsigned long long)line, token);
+					}
+					stats.rejected++;
+				}
+				token_length = 0;
+			}
+			if (c == '\n') {
+				line++;
+			}
+		}
+		if (read == 0) {
+			break;
+		}
+	}
+	double seconds = (double)(platform_time_ns() - start) / 1e9;
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	printf("Deal #%u after %llu commands\n", deal_number, (unsigned long long)stats.commands);
+	state_print_pockets(&state, pocket_suit, stdout);
+	printf("%s, %d cards on the foundations\n", state_is_won(&state) ? "Won" : "Not won", state_foundation_count(&state));
+	printf("Moves %llu, undos %llu, redos %llu, skipped %llu, not allowed %llu\n", (unsigned long long)stats.moves,
+		(unsigned long long)stats.undos, (unsigned long long)stats.redos, (unsigned long long)stats.skipped,
+		(unsigned long long)stats.rejected);
+	printf("%.3f s, %.2f million commands per second\n", seconds, seconds > 0 ? stats.commands / seconds / 1e6 : 0.0);
+
+	free(chunk);
+	free(journal_storage);
+	return stats.rejected > 0 ? 1 : 0;
+}
+
 void cleanup_location_translator(LocationTranslator* lt) {
 	if (lt) {
 		free(lt);
@@ -425,35 +906,218 @@ bool is_seven_rows_empty(Card* seven_rows[7]) {
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	srand(time(NULL));
-	Card* deck = create_deck();
+	uint32_t deal_number = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+	const char* record_path = NULL;
+	const char* db_path = NULL;
+	DealDifficulty difficulty = DealAnyWinnable;
+	bool deal_chosen = false;
+	const char* save_path = "yukon.sav";
+	bool autosave = false;
+	bool resume = false;
+	Tablebase tablebase;
+	bool tablebase_loaded = false;
+	const char* trace_path = NULL;
+	const char* batch_path = NULL;
+
+	// --deal N plays a given deal, --record FILE appends the game to a replay file
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--deal") == 0 && i + 1 < argc) {
+			deal_number = (uint32_t)strtoul(argv[++i], NULL, 10);
+			deal_chosen = true;
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+			db_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+			tablebase_loaded = tablebase_open(&tablebase, argv[++i]);
+			if (!tablebase_loaded) {
+				printf("Could not open tablebase %s\n", argv[i]);
+			}
+		}
+		else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batch_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			// A timeline of the session, T writes it (and so does exiting)
+			trace_path = argv[++i];
+			trace_enable(true);
+			trace_thread_name("main");
+		}
+		else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+			save_path = argv[++i];
+			autosave = true;
+		}
+		else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			save_path = argv[++i];
+			resume = true;
+		}
+		else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+			if (!deal_difficulty_from_string(argv[++i], &difficulty)) {
+				printf("Unknown difficulty %s, use any, easy, medium or hard\n", argv[i]);
+			}
+		}
+	}
+
+	// --db FILE deals only winnable games from a deal database, graded by --difficulty
+	if (db_path != NULL && !deal_chosen) {
+		if (!deal_db_choose(db_path, difficulty, ((uint64_t)time(NULL) << 20) ^ deal_number, &deal_number)) {
+			printf("Could not pick a deal from %s, playing a random deal\n", db_path);
+		}
+	}
+
+	if (batch_path != NULL) {
+		return run_batch(deal_number, batch_path);
+	}
+
+	uint64_t trace_start = trace_begin();
+	Card* deck = create_deck_for_deal(deal_number);
 	Card* seven_rows[7] = { NULL };
 	Card* four_pockets[4] = { NULL };
 
-	//print_deck(deck);
-	shuffle_card(&deck);
-	//print_deck(deck);
-	 
 	deal_cards(&deck, seven_rows);
+	trace_end_value("deal", "game", trace_start, deal_number);
+	if (resume && !load_game(save_path, &deal_number, seven_rows, four_pockets)) {
+		printf("Could not load %s, starting a new game\n", save_path);
+		resume = false;
+	}
+	printf("Deal #%u\n", deal_number);
+
+	ReplayWriter recorder;
+	bool recording = false;
+	if (record_path != NULL && resume) {
+		printf("A loaded game can not be recorded, it does not start from the deal\n");
+	}
+	else if (record_path != NULL) {
+		recording = replay_writer_open(&recorder, record_path, true);
+		if (recording) {
+			replay_writer_begin_game(&recorder, deal_number);
+		}
+		else {
+			printf("Could not open %s for recording\n", record_path);
+		}
+	}
 
 
+	// Undo/redo history, U and R walk through it
+	Move journal_storage[JOURNAL_DEFAULT_CAPACITY];
+	MoveJournal journal;
+	journal_init(&journal, journal_storage, JOURNAL_DEFAULT_CAPACITY);
+
+	// Created on the first H, it only ever sees the face up cards
+	FairHinter* hinter = NULL;
+
 	print_seven_rows(seven_rows, four_pockets);
 	while (is_seven_rows_empty(seven_rows)==false) {
 		char read_from_console[20];
 		printf("Enter command:");
-		scanf("%s", read_from_console);
+		if (scanf("%19s", read_from_console) != 1) {
+			break;
+		}
+
+		if (strcmp(read_from_console, "U") == 0) {
+			if (undo_move(&journal, seven_rows, four_pockets) != MOVE_NONE && recording) {
+				replay_writer_add_undo(&recorder);
+			}
+			if (autosave) {
+				save_game(save_path, deal_number, journal_depth(&journal), seven_rows, four_pockets);
+			}
+			print_seven_rows(seven_rows, four_pockets);
+			continue;
+		}
+		if (strcmp(read_from_console, "R") == 0) {
+			Move move = redo_move(&journal, seven_rows, four_pockets);
+			if (move != MOVE_NONE && recording) {
+				replay_writer_add_move(&recorder, to_engine_move(move, four_pockets));
+			}
+			if (autosave) {
+				save_game(save_path, deal_number, journal_depth(&journal), seven_rows, four_pockets);
+			}
+			print_seven_rows(seven_rows, four_pockets);
+			continue;
+		}
+
+		if (strcmp(read_from_console, "H") == 0) {
+			if (hinter == NULL) {
+				FairHintConfig config;
+				fair_hint_default_config(&config);
+				config.tablebase = tablebase_loaded ? &tablebase : NULL;
+				hinter = fair_hinter_create(&config);
+			}
+			if (hinter != NULL) {
+				trace_start = trace_begin();
+				print_hint(hinter, seven_rows, four_pockets);
+				trace_end("hint", "hint", trace_start);
+			}
+			continue;
+		}
+		if (strcmp(read_from_console, "T") == 0) {
+			if (trace_path != NULL) {
+				write_trace(trace_path);
+			}
+			continue;
+		}
+		if (strcmp(read_from_console, "S") == 0) {
+			if (save_game(save_path, deal_number, journal_depth(&journal), seven_rows, four_pockets)) {
+				printf("Saved to %s\n", save_path);
+			}
+			else {
+				printf("Could not save to %s\n", save_path);
+			}
+			continue;
+		}
+		if (strcmp(read_from_console, "L") == 0) {
+			if (load_game(save_path, &deal_number, seven_rows, four_pockets)) {
+				journal_clear(&journal);
+				if (recording) {
+					// The loaded position does not follow from the recorded moves
+					replay_writer_close(&recorder);
+					recording = false;
+				}
+				printf("Loaded deal #%u from %s\n", deal_number, save_path);
+			}
+			else {
+				printf("Could not load %s\n", save_path);
+			}
+			print_seven_rows(seven_rows, four_pockets);
+			continue;
+		}
 
+		trace_start = trace_begin();
 		LocationTranslator* lt = translate_command(read_from_console);
+		trace_end("parse", "input", trace_start);
+		trace_start = trace_begin();
+		Move move = MOVE_NONE;
 		Card* card_to_move = get_card(lt, seven_rows, CardToMove, false);
 		Card* card_new_location = get_card(lt, seven_rows, CardNewLocation, false);
 		
-		if (card_new_location != NULL) {
+		if (card_to_move == NULL || card_to_move->is_hidden) {
+			printf("Move not allowed");
+			printf("\n");
+		}
+		else if (card_new_location != NULL) {
 			bool rulesPassed = is_move_allowed_to_seven_rows(card_to_move, card_new_location);
 			if (rulesPassed) {
 				card_to_move = get_card(lt, seven_rows, CardToMove, true); // set prev to null if rule passed
 				card_new_location->next = card_to_move;
+				move = MOVE_MAKE(lt->from_index - 1, lt->to_index - 1, count_cards(card_to_move));
+			}
+			else {
+				printf("Move not allowed");
+				printf("\n");
+			}
+		}
+		else if (lt->to_tab == 'C' && lt->to_index >= 1 && lt->to_index <= 7 && lt->to_index != lt->from_index) {
+			// The row is empty: only a King goes there, with the cards on it
+			if (card_to_move->value == 13) {
+				card_to_move = get_card(lt, seven_rows, CardToMove, true);
+				seven_rows[lt->to_index - 1] = card_to_move;
+				move = MOVE_MAKE(lt->from_index - 1, lt->to_index - 1, count_cards(card_to_move));
 			}
 			else {
 				printf("Move not allowed");
@@ -461,11 +1125,14 @@ int main()
 			}
 		}
 		else {
-			if (lt->to_tab == 'F') {
-				bool rulesPassed = is_move_allowed_to_four_pockets(card_to_move, card_new_location);
+			if (lt->to_tab == 'F' && lt->to_index >= 1 && lt->to_index <= 4) {
+				// Only the last card of a row can go to a pocket
+				Card* pocket_top = get_last_card(four_pockets[lt->to_index - 1]);
+				bool rulesPassed = card_to_move->next == NULL && is_move_allowed_to_four_pockets(card_to_move, pocket_top);
 				if (rulesPassed) {
 					card_to_move = get_card(lt, seven_rows, CardToMove, true); // set prev to null if rule passed
-					four_pockets[lt->to_index - 1] = card_to_move;
+					append_cards(&four_pockets[lt->to_index - 1], card_to_move);
+					move = MOVE_MAKE(lt->from_index - 1, PILE_FOUNDATION + lt->to_index - 1, 1);
 				}
 				else {
 					printf("Move not allowed");
@@ -473,15 +1140,38 @@ int main()
 				}
 			}
 		}
+		if (move != MOVE_NONE) {
+			if (reveal_top_card(seven_rows, lt->from_index - 1)) {
+				move |= MOVE_REVEAL;
+			}
+			journal_record(&journal, move);
+			if (recording) {
+				replay_writer_add_move(&recorder, to_engine_move(move, four_pockets));
+			}
+			if (autosave) {
+				save_game(save_path, deal_number, journal_depth(&journal), seven_rows, four_pockets);
+			}
+		}
+		trace_end_value("move", "game", trace_start, move);
 		print_seven_rows(seven_rows, four_pockets);
 		cleanup_location_translator(lt);
-
-		
-		
 	}
-	printf("\n You have won.");
-	printf("Press Enter to exit...");
-	getchar(); // Wait for Enter key
+	if (recording) {
+		replay_writer_end_game(&recorder, is_seven_rows_empty(seven_rows));
+		replay_writer_close(&recorder);
+	}
+	if (is_seven_rows_empty(seven_rows)) {
+		printf("\n You have won.");
+		printf("Press Enter to exit...");
+		getchar(); // Wait for Enter key
+	}
+	fair_hinter_destroy(hinter);
+	if (trace_path != NULL) {
+		write_trace(trace_path);
+	}
+	if (tablebase_loaded) {
+		tablebase_close(&tablebase);
+	}
 	cleanup_resources(deck, seven_rows, four_pockets);
     
 }